@@ -0,0 +1,161 @@
+#include "BakedTexture.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+size_t UBakedBlockBytes(BakedFormat format) {
+	return format == BAKED_FORMAT_BC3 ? 16 : 8;
+}
+
+size_t UBakedLevelBytes(BakedFormat format, uint32_t width, uint32_t height) {
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * UBakedBlockBytes(format);
+}
+
+string UBakedTexturePath(const string& sourcePath) {
+	const size_t slash = sourcePath.find_last_of("/\\");
+	const size_t dot = sourcePath.find_last_of('.');
+	if (dot == string::npos || (slash != string::npos && dot < slash))
+		return sourcePath + ".btx";
+	return sourcePath.substr(0, dot) + ".btx";
+}
+
+bool UValidateBakedTexture(const unsigned char* data, size_t size, const BakedTextureHeader*& header, const BakedTextureLevel*& levels,
+	string& error) {
+	if (size < sizeof(BakedTextureHeader)) {
+		error = "file is smaller than the header";
+		return false;
+	}
+
+	header = reinterpret_cast<const BakedTextureHeader*>(data);
+	if (header->magic != BAKED_TEXTURE_MAGIC) {
+		error = "not a baked texture";
+		return false;
+	}
+	if (header->format != BAKED_FORMAT_BC1 && header->format != BAKED_FORMAT_BC3) {
+		error = "unknown block format " + to_string(header->format);
+		return false;
+	}
+	if (header->width == 0 || header->height == 0 || header->levelCount == 0 || header->levelCount > BAKED_TEXTURE_MAX_LEVELS) {
+		error = "bad dimensions or level count";
+		return false;
+	}
+	if (size < sizeof(BakedTextureHeader) + header->levelCount * sizeof(BakedTextureLevel)) {
+		error = "level table is truncated";
+		return false;
+	}
+
+	//Each level must halve the previous one (rounding down, never below 1) and lie inside the file
+	levels = reinterpret_cast<const BakedTextureLevel*>(data + sizeof(BakedTextureHeader));
+	const BakedFormat format = static_cast<BakedFormat>(header->format);
+	uint32_t width = header->width;
+	uint32_t height = header->height;
+	for (uint32_t i = 0; i < header->levelCount; ++i) {
+		const BakedTextureLevel& level = levels[i];
+		if (level.width != width || level.height != height || level.size != UBakedLevelBytes(format, width, height)) {
+			error = "level " + to_string(i) + " has the wrong size";
+			return false;
+		}
+		if (level.offset > size || level.size > size - level.offset) {
+			error = "level " + to_string(i) + " runs past the end of the file";
+			return false;
+		}
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return true;
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const string& path) {
+	Close();
+
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		Close();
+		return false;
+	}
+
+	data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!data) {
+		Close();
+		return false;
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+	data = nullptr;
+	size = 0;
+	mapping = nullptr;
+	file = nullptr;
+}
+#else
+bool MappedFile::Open(const string& path) {
+	Close();
+
+	file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0) {
+		Close();
+		return false;
+	}
+
+	void* mapped = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	if (mapped == MAP_FAILED) {
+		Close();
+		return false;
+	}
+	//Levels are read front to back once, during upload
+	madvise(mapped, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+	data = static_cast<const unsigned char*>(mapped);
+	size = static_cast<size_t>(info.st_size);
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data)
+		munmap(const_cast<unsigned char*>(data), size);
+	if (file >= 0)
+		close(file);
+	data = nullptr;
+	size = 0;
+	file = -1;
+}
+#endif
@@ -0,0 +1,75 @@
+#ifndef BAKED_TEXTURE_H
+#define BAKED_TEXTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//Block-compressed layouts a baked texture can hold: BC1 (DXT1) for opaque images, BC3 (DXT5) when there is alpha
+enum BakedFormat : uint32_t {
+	BAKED_FORMAT_BC1 = 1,
+	BAKED_FORMAT_BC3 = 3
+};
+
+const uint32_t BAKED_TEXTURE_MAGIC = 0x31585442;	//"BTX1" read as a little endian word
+const uint32_t BAKED_TEXTURE_MAX_LEVELS = 16;
+
+//A .btx file is this header, levelCount level entries, then the compressed levels at 16-byte aligned offsets.
+//Rows are already bottom-up and every mip level is present, so a loader hands each level straight to GL
+struct BakedTextureHeader {
+	uint32_t magic = BAKED_TEXTURE_MAGIC;
+	uint32_t format = BAKED_FORMAT_BC1;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t levelCount = 0;
+	uint32_t sourceChannels = 0;	//Channels of the image it was baked from, for reporting
+};
+
+struct BakedTextureLevel {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint64_t offset = 0;	//From the start of the file
+	uint64_t size = 0;
+};
+
+static_assert(sizeof(BakedTextureHeader) == 24 && sizeof(BakedTextureLevel) == 24, "Baked texture header layout is part of the file format");
+
+//Bytes per 4x4 block: 8 for BC1, 16 for BC3
+size_t UBakedBlockBytes(BakedFormat format);
+
+//Size of one level; partial blocks at the right and top edges are stored whole
+size_t UBakedLevelBytes(BakedFormat format, uint32_t width, uint32_t height);
+
+//Where the baked copy of an image lives: next to it with the extension replaced by .btx
+std::string UBakedTexturePath(const std::string& sourcePath);
+
+//Checks the header and every level entry against the file size. On success header and levels point into data
+bool UValidateBakedTexture(const unsigned char* data, size_t size, const BakedTextureHeader*& header, const BakedTextureLevel*& levels,
+	std::string& error);
+
+//Read-only memory mapping of a whole file, released on Close() or destruction
+class MappedFile {
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	bool Open(const std::string& path);
+	void Close();
+
+	const unsigned char* Data() const { return data; }
+	size_t Size() const { return size; }
+
+private:
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int file = -1;
+#endif
+};
+
+#endif
@@ -0,0 +1,224 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+using namespace std;
+
+double UProcessCpuSeconds() {
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0.0;
+	//100 ns units
+	const auto ticks = [](const FILETIME& time) { return (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+	return (ticks(kernel) + ticks(user)) * 1e-7;
+#else
+	timespec time;
+	if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) != 0)
+		return 0.0;
+	return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+}
+
+void GpuFrameTimer::Create() {
+	glGenQueries(RING_SIZE, queries);
+	for (int i = 0; i < RING_SIZE; ++i)
+		pendingSample[i] = -1;
+	next = 0;
+}
+
+void GpuFrameTimer::Destroy() {
+	glDeleteQueries(RING_SIZE, queries);
+}
+
+void GpuFrameTimer::Begin(int sampleIndex) {
+	pendingSample[next] = sampleIndex;
+	glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+}
+
+void GpuFrameTimer::End() {
+	glEndQuery(GL_TIME_ELAPSED);
+	next = (next + 1) % RING_SIZE;
+}
+
+void GpuFrameTimer::Collect(vector<FrameSample>& samples, bool waitAll) {
+	for (int i = 0; i < RING_SIZE; ++i) {
+		if (pendingSample[i] < 0)
+			continue;
+
+		//The slot about to be reused is always drained, which also keeps the CPU from running too far ahead
+		if (!waitAll && i != next) {
+			GLint available = 0;
+			glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				continue;
+		}
+
+		GLuint64 elapsedNs = 0;
+		glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsedNs);
+		samples[pendingSample[i]].gpuMs = elapsedNs / 1.0e6;
+		pendingSample[i] = -1;
+	}
+}
+
+void UCameraPathPose(int frame, int frameCount, glm::vec3& position, float& yaw, float& pitch) {
+	const glm::vec3 target(0.5f, -0.6f, -0.2f);
+	const float t = frameCount > 0 ? static_cast<float>(frame) / frameCount : 0.0f;
+	const float angle = 2.0f * glm::pi<float>() * t;
+
+	//One full orbit per run, dipping closer and rising twice so near and far views are both covered
+	float radius = 3.0f + 0.75f * sin(2.0f * angle);
+	float height = 0.8f + 0.5f * sin(angle);
+	position = target + glm::vec3(radius * cos(angle), height, radius * sin(angle));
+
+	glm::vec3 direction = glm::normalize(target - position);
+	yaw = glm::degrees(atan2(direction.z, direction.x));
+	pitch = glm::degrees(asin(direction.y));
+}
+
+double UPercentile(vector<double> values, double p) {
+	if (values.empty())
+		return 0.0;
+
+	sort(values.begin(), values.end());
+	size_t rank = static_cast<size_t>(ceil(p / 100.0 * values.size()));
+	rank = max<size_t>(rank, 1);
+	return values[min(rank, values.size()) - 1];
+}
+
+namespace {
+	void WriteSummary(ostream& out, const char* name, const vector<double>& values) {
+		double mean = 0.0;
+		for (double v : values)
+			mean += v;
+		if (!values.empty())
+			mean /= values.size();
+
+		out << "    \"" << name << "\": {"
+			<< "\"min\": " << UPercentile(values, 0.0)
+			<< ", \"mean\": " << mean
+			<< ", \"p50\": " << UPercentile(values, 50.0)
+			<< ", \"p95\": " << UPercentile(values, 95.0)
+			<< ", \"p99\": " << UPercentile(values, 99.0)
+			<< ", \"max\": " << UPercentile(values, 100.0)
+			<< "}";
+	}
+
+	void WriteJsonString(ostream& out, const string& value) {
+		out << '"';
+		for (char c : value) {
+			if (c == '"' || c == '\\')
+				out << '\\';
+			out << c;
+		}
+		out << '"';
+	}
+}
+
+void UWriteBenchmarkJson(ostream& out, const BenchmarkInfo& info, const vector<FrameSample>& samples) {
+	vector<double> cpuTimes;
+	vector<double> gpuTimes;
+	vector<double> stateChanges;
+	vector<double> vertexRates;
+	vector<double> triangles;
+	vector<double> cullTimes;
+	vector<double> pickTimes;
+	for (const FrameSample& sample : samples) {
+		cpuTimes.push_back(sample.cpuMs);
+		stateChanges.push_back(sample.stateChanges);
+		triangles.push_back(static_cast<double>(sample.triangles));
+		cullTimes.push_back(sample.cullMs);
+		pickTimes.push_back(sample.pickMs);
+		if (sample.gpuMs >= 0.0)
+			gpuTimes.push_back(sample.gpuMs);
+		//Millions of vertices per second of GPU time
+		if (sample.gpuMs > 0.0)
+			vertexRates.push_back(sample.vertices / (sample.gpuMs * 1000.0));
+	}
+
+	out << fixed << setprecision(4);
+	out << "{\n";
+	out << "  \"renderer\": ";
+	WriteJsonString(out, info.renderer);
+	out << ",\n  \"version\": ";
+	WriteJsonString(out, info.version);
+	out << ",\n  \"width\": " << info.width << ",\n  \"height\": " << info.height << ",\n";
+	out << "  \"warmupFrames\": " << info.warmupFrames << ",\n";
+	out << "  \"normalMatrix\": ";
+	WriteJsonString(out, info.normalMatrix);
+	out << ",\n  \"vertexFormat\": ";
+	WriteJsonString(out, info.vertexFormat);
+	out << ",\n  \"submission\": ";
+	WriteJsonString(out, info.submission);
+	out << ",\n  \"culling\": ";
+	WriteJsonString(out, info.culling);
+	out << ",\n  \"occlusion\": " << (info.occlusion ? "true" : "false") << ",\n";
+	out << "  \"levelOfDetail\": " << (info.levelOfDetail ? "true" : "false") << ",\n";
+	out << "  \"shaderCache\": ";
+	WriteJsonString(out, info.shaderCache);
+	out << ",\n  \"shaderVariants\": ";
+	WriteJsonString(out, info.shaderVariants);
+	out << ",\n  \"shaderCompile\": ";
+	WriteJsonString(out, info.shaderCompile);
+	out << ",\n";
+	out << "  \"variants\": [";
+	for (size_t i = 0; i < info.variants.size(); ++i) {
+		const ShaderVariantTiming& variant = info.variants[i];
+		out << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+		WriteJsonString(out, variant.name);
+		out << ", \"compileMs\": " << variant.compileMs << ", \"cached\": " << (variant.cached ? "true" : "false")
+			<< ", \"ready\": " << (variant.ready ? "true" : "false") << "}";
+	}
+	out << "\n  ],\n";
+	const StartupTimes& startup = info.startup;
+	out << "  \"startup\": {\"totalMs\": " << startup.totalMs << ", \"meshMs\": " << startup.meshMs << ", \"shaderMs\": " << startup.shaderMs
+		<< ", \"textureWallMs\": " << startup.textureWallMs << ", \"textureWaitMs\": " << startup.textureWaitMs
+		<< ", \"textureDecodeMs\": " << startup.textureDecodeMs << ", \"textureFlipMs\": " << startup.textureFlipMs << ", \"textureUploadMs\": " << startup.textureUploadMs
+		<< ", \"textureMipmapMs\": " << startup.textureMipmapMs << ", \"textureArrayMs\": " << startup.textureArrayMs << ", \"textureThreads\": " << startup.textureThreads
+		<< ", \"textureBaked\": " << startup.textureBaked << ", \"textureMegabytes\": " << startup.textureMegabytes
+		<< ", \"bvhMs\": " << startup.bvhMs << ", \"bvhNodes\": " << startup.bvhNodes
+		<< ", \"programCacheHits\": " << startup.programCacheHits << ", \"programCacheMisses\": " << startup.programCacheMisses
+		<< ", \"programCacheLoadMs\": " << startup.programCacheLoadMs << ", \"programCacheStoreMs\": " << startup.programCacheStoreMs << "},\n";
+	out << "  \"frames\": " << samples.size() << ",\n";
+	out << "  \"summary\": {\n";
+	WriteSummary(out, "cpuMs", cpuTimes);
+	out << ",\n";
+	WriteSummary(out, "gpuMs", gpuTimes);
+	out << ",\n";
+	WriteSummary(out, "stateChanges", stateChanges);
+	out << ",\n";
+	WriteSummary(out, "gpuMVerticesPerSecond", vertexRates);
+	out << ",\n";
+	WriteSummary(out, "triangles", triangles);
+	out << ",\n";
+	WriteSummary(out, "cullMs", cullTimes);
+	out << ",\n";
+	WriteSummary(out, "pickMs", pickTimes);
+	out << "\n  },\n";
+
+	out << "  \"samples\": [\n";
+	for (size_t i = 0; i < samples.size(); ++i) {
+		const FrameSample& sample = samples[i];
+		out << "    {\"frame\": " << sample.frame << ", \"cpuMs\": " << sample.cpuMs << ", \"gpuMs\": ";
+		if (sample.gpuMs >= 0.0)
+			out << sample.gpuMs;
+		else
+			out << "null";
+		out << ", \"drawCalls\": " << sample.drawCalls << ", \"instances\": " << sample.instances << ", \"vertices\": " << sample.vertices << ", \"triangles\": " << sample.triangles << ", \"stateChanges\": " << sample.stateChanges
+			<< ", \"visible\": " << sample.visible << ", \"culled\": " << sample.culled << ", \"cullMs\": " << sample.cullMs << ", \"pickMs\": " << sample.pickMs;
+		if (sample.occluded >= 0)
+			out << ", \"occluded\": " << sample.occluded;
+		out << "}" << (i + 1 < samples.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
@@ -0,0 +1,110 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+//Timing of a single benchmark frame
+struct FrameSample {
+	int frame = 0;
+	double cpuMs = 0.0;		//Wall time spent on the CPU building and submitting the frame
+	double gpuMs = -1.0;	//GL_TIME_ELAPSED for the frame, negative until the query resolves
+	int drawCalls = 0;
+	int instances = 0;
+	long long vertices = 0;
+	long long triangles = 0;	//Submitted at the levels of detail chosen that frame
+	int stateChanges = 0;	//Program, texture and VAO binds issued by the render queue
+	int visible = 0;		//Draw items inside the view frustum
+	int culled = 0;
+	double cullMs = 0.0;	//Frustum test of every draw item's world box
+	int occluded = -1;		//Frustum-visible instances the Hi-Z test hid, a few frames late; -1 without --occlusion
+	double pickMs = 0.0;	//Ray pick through the screen centre
+};
+
+//Ring of GL_TIME_ELAPSED queries so GPU times can be read back a few frames late without stalling
+class GpuFrameTimer {
+public:
+	static const int RING_SIZE = 8;
+
+	void Create();
+	void Destroy();
+
+	void Begin(int sampleIndex);
+	void End();
+
+	//Writes resolved query results into samples; waitAll blocks until every pending query is done
+	void Collect(std::vector<FrameSample>& samples, bool waitAll);
+
+private:
+	GLuint queries[RING_SIZE] = {};
+	int pendingSample[RING_SIZE] = {};
+	int next = 0;
+};
+
+//Startup phases before the first frame, in milliseconds
+struct StartupTimes {
+	double totalMs = 0.0;		//Program start to the first frame
+	double meshMs = 0.0;
+	double shaderMs = 0.0;
+	double textureWallMs = 0.0;	//Texture decode start to the last upload, overlapping mesh and shader work
+	double textureWaitMs = 0.0;	//Part of that the GL thread spent waiting for decodes
+	double textureDecodeMs = 0.0;	//Summed over the decode threads
+	double textureFlipMs = 0.0;	//Part of decode spent flipping rows
+	double textureUploadMs = 0.0;
+	double textureMipmapMs = 0.0;
+	double textureArrayMs = 0.0;	//Packing the textures into the array texture
+	int textureThreads = 0;
+	int textureBaked = 0;		//Textures uploaded from baked files
+	double textureMegabytes = 0.0;
+	double bvhMs = 0.0;			//Building the draw item hierarchy
+	int bvhNodes = 0;
+	int programCacheHits = 0;	//Programs loaded from binaries an earlier run stored
+	int programCacheMisses = 0;	//Programs compiled from source, rejected binaries included
+	double programCacheLoadMs = 0.0;
+	double programCacheStoreMs = 0.0;	//Reading back and writing out the binaries of the misses
+};
+
+//How one shader variant's compile went
+struct ShaderVariantTiming {
+	std::string name;		//Manifest spelling
+	double compileMs = 0.0;	//Queued to ready, at frame granularity when compiled in the background
+	bool cached = false;	//Loaded from the program cache
+	bool ready = false;
+};
+
+//Information about the run written alongside the samples
+struct BenchmarkInfo {
+	std::string renderer;
+	std::string version;
+	int width = 0;
+	int height = 0;
+	int warmupFrames = 0;
+	std::string normalMatrix;	//Where normal matrices were computed: "cpu" or "shader"
+	std::string vertexFormat;	//"scene" (per-mesh choice of the scene file), "full" or "compact"
+	std::string submission;		//"instanced" (a draw per batch) or "multiDrawIndirect"
+	std::string culling;		//Frustum culling: "off", "scalar", "sse", "avx" or "bvh"
+	bool occlusion = false;		//Two-pass Hi-Z occlusion culling on the GPU
+	bool levelOfDetail = false;	//Round primitives drawn at a segment count chosen by screen size
+	std::string shaderCache;	//Program binary cache: "on", "rebuild" (cold, entries rewritten) or "off"
+	std::string shaderVariants;	//"specialized" (smallest variant per material) or "generic"
+	std::string shaderCompile;	//Where variants compiled: "driver" (KHR_parallel_shader_compile), "worker" or "main"
+	std::vector<ShaderVariantTiming> variants;
+	StartupTimes startup;
+};
+
+//CPU time the process has used so far, every thread included, in seconds
+double UProcessCpuSeconds();
+
+//Camera pose along the scripted benchmark path (an orbit with height and radius sweep around the desk)
+void UCameraPathPose(int frame, int frameCount, glm::vec3& position, float& yaw, float& pitch);
+
+//Nearest-rank percentile, p in [0, 100]
+double UPercentile(std::vector<double> values, double p);
+
+void UWriteBenchmarkJson(std::ostream& out, const BenchmarkInfo& info, const std::vector<FrameSample>& samples);
+
+#endif
@@ -0,0 +1,357 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace std;
+
+namespace {
+	const int SAH_BINS = 16;
+	const int MAX_STACK = 64;
+
+	struct Box {
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+
+		void Grow(const glm::vec3& point) {
+			min = glm::min(min, point);
+			max = glm::max(max, point);
+		}
+		void Grow(const Box& box) {
+			min = glm::min(min, box.min);
+			max = glm::max(max, box.max);
+		}
+		float HalfArea() const {
+			const glm::vec3 size = max - min;
+			return size.x < 0.0f ? 0.0f : size.x * size.y + size.y * size.z + size.z * size.x;
+		}
+	};
+
+	Box ItemBox(const CullingBounds& bounds, uint32_t item) {
+		const glm::vec3 center(bounds.centerX[item], bounds.centerY[item], bounds.centerZ[item]);
+		const glm::vec3 extent(bounds.extentX[item], bounds.extentY[item], bounds.extentZ[item]);
+		Box box;
+		box.min = center - extent;
+		box.max = center + extent;
+		return box;
+	}
+
+	struct Bin {
+		Box box;
+		uint32_t count = 0;
+	};
+
+	class Builder {
+	public:
+		Builder(const CullingBounds& bounds, Bvh& bvh) : bvh(bvh) {
+			boxes.resize(bounds.count);
+			centroids.resize(bounds.count);
+			for (uint32_t i = 0; i < bounds.count; ++i) {
+				boxes[i] = ItemBox(bounds, i);
+				centroids[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+			}
+		}
+
+		//Makes the node for items[first, first + count) and, depth first, its subtree
+		void Build(uint32_t parent, uint32_t first, uint32_t count, int depth) {
+			const uint32_t nodeIndex = static_cast<uint32_t>(bvh.nodes.size());
+			bvh.nodes.push_back(BvhNode());
+			bvh.parents.push_back(parent);
+			bvh.depth = max(bvh.depth, depth);
+
+			Box box;
+			Box centroidBox;
+			for (uint32_t i = first; i < first + count; ++i) {
+				box.Grow(boxes[bvh.items[i]]);
+				centroidBox.Grow(centroids[bvh.items[i]]);
+			}
+			bvh.nodes[nodeIndex].min = box.min;
+			bvh.nodes[nodeIndex].max = box.max;
+
+			uint32_t leftCount = count > 1 && depth < MAX_STACK - 2 ? Split(first, count, box, centroidBox) : 0;
+			if (leftCount == 0) {
+				bvh.nodes[nodeIndex].rightOrFirst = first;
+				bvh.nodes[nodeIndex].count = count;
+				for (uint32_t i = first; i < first + count; ++i)
+					bvh.leafOfItem[bvh.items[i]] = nodeIndex;
+				++bvh.leaves;
+				return;
+			}
+
+			Build(nodeIndex, first, leftCount, depth + 1);
+			bvh.nodes[nodeIndex].rightOrFirst = static_cast<uint32_t>(bvh.nodes.size());
+			bvh.nodes[nodeIndex].count = 0;
+			Build(nodeIndex, first + leftCount, count - leftCount, depth + 1);
+		}
+
+	private:
+		//Partitions the range by the cheapest binned split and returns the size of the left part, 0 to make a leaf
+		uint32_t Split(uint32_t first, uint32_t count, const Box& box, const Box& centroidBox) {
+			float bestCost = FLT_MAX;
+			int bestAxis = -1;
+			int bestBin = 0;
+
+			for (int axis = 0; axis < 3; ++axis) {
+				const float lo = centroidBox.min[axis];
+				const float extent = centroidBox.max[axis] - lo;
+				if (extent <= 0.0f)
+					continue;
+				const float scale = SAH_BINS / extent;
+
+				Bin bins[SAH_BINS];
+				for (uint32_t i = first; i < first + count; ++i) {
+					const uint32_t item = bvh.items[i];
+					const int bin = min(SAH_BINS - 1, static_cast<int>((centroids[item][axis] - lo) * scale));
+					bins[bin].box.Grow(boxes[item]);
+					++bins[bin].count;
+				}
+
+				//Sweep from the right collecting suffix areas, then from the left evaluating each split plane
+				float rightArea[SAH_BINS];
+				uint32_t rightCount[SAH_BINS];
+				Box right;
+				uint32_t rightSum = 0;
+				for (int b = SAH_BINS - 1; b > 0; --b) {
+					right.Grow(bins[b].box);
+					rightSum += bins[b].count;
+					rightArea[b] = right.HalfArea();
+					rightCount[b] = rightSum;
+				}
+				Box left;
+				uint32_t leftSum = 0;
+				for (int b = 1; b < SAH_BINS; ++b) {
+					left.Grow(bins[b - 1].box);
+					leftSum += bins[b - 1].count;
+					if (leftSum == 0 || rightCount[b] == 0)
+						continue;
+					const float cost = left.HalfArea() * leftSum + rightArea[b] * rightCount[b];
+					if (cost < bestCost) {
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = b;
+					}
+				}
+			}
+
+			//Every centroid in one spot: nothing to split on
+			if (bestAxis < 0)
+				return 0;
+
+			//A leaf costs one test per item; a split costs a node visit plus its children's share of the items
+			const float parentArea = box.HalfArea();
+			const float splitCost = 1.0f + (parentArea > 0.0f ? bestCost / parentArea : static_cast<float>(count));
+			if (count <= BVH_MAX_LEAF_ITEMS && splitCost >= static_cast<float>(count))
+				return 0;
+
+			const float bestLo = centroidBox.min[bestAxis];
+			const float bestScale = SAH_BINS / (centroidBox.max[bestAxis] - bestLo);
+			uint32_t* begin = bvh.items.data() + first;
+			uint32_t* middle = partition(begin, begin + count, [&](uint32_t item) {
+				return min(SAH_BINS - 1, static_cast<int>((centroids[item][bestAxis] - bestLo) * bestScale)) < bestBin;
+			});
+			return static_cast<uint32_t>(middle - begin);
+		}
+
+		Bvh& bvh;
+		vector<Box> boxes;
+		vector<glm::vec3> centroids;
+	};
+
+	//Box of a node from its items (leaf) or children (interior); returns whether it changed
+	bool FitNode(Bvh& bvh, const CullingBounds& bounds, uint32_t nodeIndex) {
+		BvhNode& node = bvh.nodes[nodeIndex];
+		Box box;
+		if (node.count > 0) {
+			for (uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; ++i)
+				box.Grow(ItemBox(bounds, bvh.items[i]));
+		}
+		else {
+			const BvhNode& left = bvh.nodes[nodeIndex + 1];
+			const BvhNode& right = bvh.nodes[node.rightOrFirst];
+			box.min = glm::min(left.min, right.min);
+			box.max = glm::max(left.max, right.max);
+		}
+
+		const bool changed = box.min != node.min || box.max != node.max;
+		node.min = box.min;
+		node.max = box.max;
+		return changed;
+	}
+
+	//Appends every item under a node, no tests needed
+	void AppendSubtree(const Bvh& bvh, uint32_t root, vector<uint32_t>& visible) {
+		uint32_t stack[MAX_STACK];
+		int top = 0;
+		stack[top++] = root;
+		while (top > 0) {
+			const BvhNode& node = bvh.nodes[stack[--top]];
+			if (node.count > 0) {
+				visible.insert(visible.end(), bvh.items.begin() + node.rightOrFirst, bvh.items.begin() + node.rightOrFirst + node.count);
+				continue;
+			}
+			stack[top++] = node.rightOrFirst;
+			stack[top++] = static_cast<uint32_t>(&node - bvh.nodes.data()) + 1;
+		}
+	}
+}
+
+void UBuildBvh(const CullingBounds& bounds, Bvh& bvh) {
+	bvh = Bvh();
+	if (bounds.count == 0)
+		return;
+
+	bvh.items.resize(bounds.count);
+	for (uint32_t i = 0; i < bounds.count; ++i)
+		bvh.items[i] = i;
+	bvh.leafOfItem.resize(bounds.count);
+	//A balanced tree with two-item leaves has about count nodes; reserving that avoids regrowth during the build
+	bvh.nodes.reserve(bounds.count);
+	bvh.parents.reserve(bounds.count);
+
+	Builder builder(bounds, bvh);
+	builder.Build(UINT32_MAX, 0, static_cast<uint32_t>(bounds.count), 1);
+}
+
+void URefitBvh(Bvh& bvh, const CullingBounds& bounds, const vector<uint32_t>& changedItems) {
+	for (uint32_t item : changedItems) {
+		uint32_t nodeIndex = bvh.leafOfItem[item];
+		while (nodeIndex != UINT32_MAX && FitNode(bvh, bounds, nodeIndex))
+			nodeIndex = bvh.parents[nodeIndex];
+	}
+}
+
+void UCullBvh(const Bvh& bvh, const CullingBounds& bounds, const Frustum& frustum, vector<uint32_t>& visible) {
+	if (bvh.nodes.empty())
+		return;
+
+	//Each stack entry carries the planes its box still straddles; planes the parent was wholly inside of are not retested
+	struct Entry {
+		uint32_t node;
+		uint32_t planes;
+	};
+	Entry stack[MAX_STACK];
+	int top = 0;
+	stack[top++] = { 0, 0x3F };
+
+	while (top > 0) {
+		const Entry entry = stack[--top];
+		const BvhNode& node = bvh.nodes[entry.node];
+		const glm::vec3 center = (node.min + node.max) * 0.5f;
+		const glm::vec3 extent = (node.max - node.min) * 0.5f;
+
+		uint32_t planes = entry.planes;
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; ++p) {
+			if ((planes & (1u << p)) == 0)
+				continue;
+			const glm::vec4& plane = frustum.planes[p];
+			const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			const float radius = fabs(plane.x) * extent.x + fabs(plane.y) * extent.y + fabs(plane.z) * extent.z;
+			if (distance + radius < 0.0f)
+				outside = true;
+			else if (distance - radius >= 0.0f)
+				planes &= ~(1u << p);
+		}
+		if (outside)
+			continue;
+
+		if (planes == 0) {
+			AppendSubtree(bvh, entry.node, visible);
+			continue;
+		}
+
+		if (node.count > 0) {
+			//Leaf boxes are loose around several items; each item is tested against the planes still in play
+			for (uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; ++i) {
+				const uint32_t item = bvh.items[i];
+				bool itemOutside = false;
+				for (int p = 0; p < 6 && !itemOutside; ++p) {
+					if ((planes & (1u << p)) == 0)
+						continue;
+					const glm::vec4& plane = frustum.planes[p];
+					const float distance = plane.x * bounds.centerX[item] + plane.y * bounds.centerY[item] + plane.z * bounds.centerZ[item] + plane.w;
+					const float radius = fabs(plane.x) * bounds.extentX[item] + fabs(plane.y) * bounds.extentY[item] + fabs(plane.z) * bounds.extentZ[item];
+					itemOutside = distance + radius < 0.0f;
+				}
+				if (!itemOutside)
+					visible.push_back(item);
+			}
+			continue;
+		}
+
+		stack[top++] = { node.rightOrFirst, planes };
+		stack[top++] = { entry.node + 1, planes };
+	}
+}
+
+float URayBox(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+	const glm::vec3 t0 = (boxMin - origin) * inverseDirection;
+	const glm::vec3 t1 = (boxMax - origin) * inverseDirection;
+	const glm::vec3 entries = glm::min(t0, t1);
+	const glm::vec3 exits = glm::max(t0, t1);
+	const float enter = max(max(entries.x, entries.y), max(entries.z, 0.0f));
+	const float exit = min(min(exits.x, exits.y), min(exits.z, maxDistance));
+	return enter <= exit ? enter : -1.0f;
+}
+
+int URaycastBvh(const Bvh& bvh, const CullingBounds& bounds, const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+	const function<float(uint32_t)>& hitDistance, float& distance) {
+	int hit = -1;
+	distance = maxDistance;
+	if (bvh.nodes.empty())
+		return hit;
+
+	//Infinite components for axis-parallel rays make the slab test treat that axis as always overlapping
+	const glm::vec3 inverseDirection = 1.0f / direction;
+
+	struct Entry {
+		uint32_t node;
+		float enter;
+	};
+	Entry stack[MAX_STACK];
+	int top = 0;
+	const float rootEnter = URayBox(bvh.nodes[0].min, bvh.nodes[0].max, origin, inverseDirection, distance);
+	if (rootEnter >= 0.0f)
+		stack[top++] = { 0, rootEnter };
+
+	while (top > 0) {
+		const Entry entry = stack[--top];
+		if (entry.enter > distance)
+			continue;
+
+		const BvhNode& node = bvh.nodes[entry.node];
+		if (node.count > 0) {
+			for (uint32_t i = node.rightOrFirst; i < node.rightOrFirst + node.count; ++i) {
+				const uint32_t item = bvh.items[i];
+				const glm::vec3 center(bounds.centerX[item], bounds.centerY[item], bounds.centerZ[item]);
+				const glm::vec3 extent(bounds.extentX[item], bounds.extentY[item], bounds.extentZ[item]);
+				if (URayBox(center - extent, center + extent, origin, inverseDirection, distance) < 0.0f)
+					continue;
+				const float t = hitDistance(item);
+				if (t >= 0.0f && t <= distance) {
+					distance = t;
+					hit = static_cast<int>(item);
+				}
+			}
+			continue;
+		}
+
+		//Push the far child first so the near one is popped next
+		const uint32_t leftIndex = entry.node + 1;
+		const uint32_t rightIndex = node.rightOrFirst;
+		const float leftEnter = URayBox(bvh.nodes[leftIndex].min, bvh.nodes[leftIndex].max, origin, inverseDirection, distance);
+		const float rightEnter = URayBox(bvh.nodes[rightIndex].min, bvh.nodes[rightIndex].max, origin, inverseDirection, distance);
+		if (leftEnter >= 0.0f && rightEnter >= 0.0f) {
+			const bool leftFirst = leftEnter <= rightEnter;
+			stack[top++] = leftFirst ? Entry{ rightIndex, rightEnter } : Entry{ leftIndex, leftEnter };
+			stack[top++] = leftFirst ? Entry{ leftIndex, leftEnter } : Entry{ rightIndex, rightEnter };
+		}
+		else if (leftEnter >= 0.0f) {
+			stack[top++] = { leftIndex, leftEnter };
+		}
+		else if (rightEnter >= 0.0f) {
+			stack[top++] = { rightIndex, rightEnter };
+		}
+	}
+	return hit;
+}
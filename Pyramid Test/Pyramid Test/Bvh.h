@@ -0,0 +1,54 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "Culling.h"
+
+//Node of the flattened hierarchy, 32 bytes so two share a cache line. Nodes are stored depth first: an interior
+//node's left child is the next node and only the right child's index is kept
+struct BvhNode {
+	glm::vec3 min;
+	uint32_t rightOrFirst;	//Interior: index of the right child. Leaf: first entry in Bvh::items
+	glm::vec3 max;
+	uint32_t count;			//Items in a leaf, 0 for interior nodes
+};
+
+//Bounding volume hierarchy over the draw items' world boxes (see CullingBounds)
+struct Bvh {
+	std::vector<BvhNode> nodes;
+	std::vector<uint32_t> items;		//Draw item indices, each leaf's a contiguous run
+	std::vector<uint32_t> parents;		//Per node, UINT32_MAX for the root
+	std::vector<uint32_t> leafOfItem;	//Per draw item, the leaf holding it
+	int depth = 0;
+	int leaves = 0;
+};
+
+//Largest leaf the builder makes; smaller leaves are made when the surface area heuristic prefers them
+const uint32_t BVH_MAX_LEAF_ITEMS = 8;
+
+//Builds top down with a binned surface area heuristic over the box centroids
+void UBuildBvh(const CullingBounds& bounds, Bvh& bvh);
+
+//Grows or shrinks the leaves holding the given items, and their ancestors until a box stops changing, to fit the
+//items' current boxes. The tree shape is kept, so a lot of movement slowly makes queries looser; rebuild then
+void URefitBvh(Bvh& bvh, const CullingBounds& bounds, const std::vector<uint32_t>& changedItems);
+
+//Appends every draw item whose box is at least partly inside the frustum. Subtrees wholly inside skip the plane
+//tests, so the order is the tree's rather than index order
+void UCullBvh(const Bvh& bvh, const CullingBounds& bounds, const Frustum& frustum, std::vector<uint32_t>& visible);
+
+//Slab test of a box against origin + t * direction, t in [0, maxDistance]; returns the entry t, negative for a miss
+float URayBox(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance);
+
+//Closest hit along origin + t * direction for t in [0, maxDistance]. Nodes are visited near child first and skipped
+//once they start beyond the closest hit so far; hitDistance tests one item and returns its t, negative for a miss.
+//Returns the item, or -1 when nothing was hit
+int URaycastBvh(const Bvh& bvh, const CullingBounds& bounds, const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+	const std::function<float(uint32_t)>& hitDistance, float& distance);
+
+#endif
@@ -0,0 +1,190 @@
+#include "Culling.h"
+
+#include <cmath>
+
+//SSE is part of x86-64 and of 32-bit builds with /arch:SSE or later (the MSVC default)
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define CULLING_SSE
+#include <xmmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	bool BoxOutside(const CullingBounds& bounds, size_t i, const Frustum& frustum) {
+		for (const glm::vec4& plane : frustum.planes) {
+			const float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+			const float radius = fabs(plane.x) * bounds.extentX[i] + fabs(plane.y) * bounds.extentY[i] + fabs(plane.z) * bounds.extentZ[i];
+			if (distance + radius < 0.0f)
+				return true;
+		}
+		return false;
+	}
+
+	void CullScalar(const CullingBounds& bounds, const Frustum& frustum, vector<uint32_t>& visible) {
+		for (size_t i = 0; i < bounds.count; ++i)
+			if (!BoxOutside(bounds, i, frustum))
+				visible.push_back(static_cast<uint32_t>(i));
+	}
+
+	//Appends the indices of the clear bits of outsideMask (bit n is box first + n) that are real boxes
+	void AppendVisible(int outsideMask, int lanes, size_t first, size_t count, vector<uint32_t>& visible) {
+		for (int lane = 0; lane < lanes; ++lane)
+			if ((outsideMask & (1 << lane)) == 0 && first + lane < count)
+				visible.push_back(static_cast<uint32_t>(first + lane));
+	}
+
+#ifdef CULLING_SSE
+	void CullSse(const CullingBounds& bounds, const Frustum& frustum, vector<uint32_t>& visible) {
+		//Plane components are splatted once; |n| is precomputed so the extent term is three multiply-adds
+		__m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+		for (int p = 0; p < 6; ++p) {
+			const glm::vec4& plane = frustum.planes[p];
+			nx[p] = _mm_set1_ps(plane.x);
+			ny[p] = _mm_set1_ps(plane.y);
+			nz[p] = _mm_set1_ps(plane.z);
+			nw[p] = _mm_set1_ps(plane.w);
+			ax[p] = _mm_set1_ps(fabs(plane.x));
+			ay[p] = _mm_set1_ps(fabs(plane.y));
+			az[p] = _mm_set1_ps(fabs(plane.z));
+		}
+		const __m128 zero = _mm_setzero_ps();
+
+		for (size_t i = 0; i < bounds.count; i += 4) {
+			const __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+			const __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+			const __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+			const __m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+			const __m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+			const __m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+
+			__m128 outside = _mm_setzero_ps();
+			for (int p = 0; p < 6; ++p) {
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_add_ps(_mm_mul_ps(nz[p], cz), nw[p]));
+				__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+			}
+			AppendVisible(_mm_movemask_ps(outside), 4, i, bounds.count, visible);
+		}
+	}
+#endif
+
+#ifdef __AVX__
+	void CullAvx(const CullingBounds& bounds, const Frustum& frustum, vector<uint32_t>& visible) {
+		__m256 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+		for (int p = 0; p < 6; ++p) {
+			const glm::vec4& plane = frustum.planes[p];
+			nx[p] = _mm256_set1_ps(plane.x);
+			ny[p] = _mm256_set1_ps(plane.y);
+			nz[p] = _mm256_set1_ps(plane.z);
+			nw[p] = _mm256_set1_ps(plane.w);
+			ax[p] = _mm256_set1_ps(fabs(plane.x));
+			ay[p] = _mm256_set1_ps(fabs(plane.y));
+			az[p] = _mm256_set1_ps(fabs(plane.z));
+		}
+		const __m256 zero = _mm256_setzero_ps();
+
+		for (size_t i = 0; i < bounds.count; i += 8) {
+			const __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+			const __m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+			const __m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+			const __m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+			const __m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+			const __m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+
+			__m256 outside = _mm256_setzero_ps();
+			for (int p = 0; p < 6; ++p) {
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)), _mm256_add_ps(_mm256_mul_ps(nz[p], cz), nw[p]));
+				__m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_mul_ps(az[p], ez));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+			}
+			AppendVisible(_mm256_movemask_ps(outside), 8, i, bounds.count, visible);
+		}
+	}
+#endif
+}
+
+const char* UCullingModeName(CullingMode mode) {
+	switch (mode) {
+	case CULLING_OFF:
+		return "off";
+	case CULLING_SCALAR:
+		return "scalar";
+	case CULLING_BVH:
+		return "bvh";
+	default:
+#if defined(__AVX__)
+		return "avx";
+#elif defined(CULLING_SSE)
+		return "sse";
+#else
+		return "scalar";
+#endif
+	}
+}
+
+Frustum UExtractFrustum(const glm::mat4& viewProjection) {
+	//Rows of the matrix; glm stores columns
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; ++r)
+		rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];
+	frustum.planes[1] = rows[3] - rows[0];
+	frustum.planes[2] = rows[3] + rows[1];
+	frustum.planes[3] = rows[3] - rows[1];
+	frustum.planes[4] = rows[3] + rows[2];
+	frustum.planes[5] = rows[3] - rows[2];
+	for (glm::vec4& plane : frustum.planes)
+		plane /= glm::length(glm::vec3(plane));
+	return frustum;
+}
+
+void UResizeCullingBounds(CullingBounds& bounds, size_t count) {
+	//Padding boxes are degenerate at the origin; they are tested but never reported
+	const size_t padded = (count + CULLING_BATCH - 1) / CULLING_BATCH * CULLING_BATCH;
+	for (vector<float>* component : { &bounds.centerX, &bounds.centerY, &bounds.centerZ, &bounds.extentX, &bounds.extentY, &bounds.extentZ })
+		component->resize(padded, 0.0f);
+	bounds.count = count;
+}
+
+void USetCullingBounds(CullingBounds& bounds, size_t index, const MeshBounds& mesh, const glm::mat4& world) {
+	const glm::vec3 center = glm::vec3(world * glm::vec4((mesh.min + mesh.max) * 0.5f, 1.0f));
+	const glm::vec3 extent = (mesh.max - mesh.min) * 0.5f;
+
+	glm::vec3 worldExtent(0.0f);
+	for (int column = 0; column < 3; ++column)
+		worldExtent += glm::abs(glm::vec3(world[column])) * extent[column];
+
+	bounds.centerX[index] = center.x;
+	bounds.centerY[index] = center.y;
+	bounds.centerZ[index] = center.z;
+	bounds.extentX[index] = worldExtent.x;
+	bounds.extentY[index] = worldExtent.y;
+	bounds.extentZ[index] = worldExtent.z;
+}
+
+void UCullBounds(const CullingBounds& bounds, const Frustum& frustum, CullingMode mode, vector<uint32_t>& visible) {
+	if (mode == CULLING_OFF) {
+		for (size_t i = 0; i < bounds.count; ++i)
+			visible.push_back(static_cast<uint32_t>(i));
+		return;
+	}
+
+#if defined(__AVX__)
+	if (mode == CULLING_SIMD || mode == CULLING_BVH) {
+		CullAvx(bounds, frustum, visible);
+		return;
+	}
+#elif defined(CULLING_SSE)
+	if (mode == CULLING_SIMD || mode == CULLING_BVH) {
+		CullSse(bounds, frustum, visible);
+		return;
+	}
+#endif
+	CullScalar(bounds, frustum, visible);
+}
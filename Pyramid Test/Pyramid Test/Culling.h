@@ -0,0 +1,49 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "MeshBuilder.h"
+
+//How draw items are tested against the view frustum
+enum CullingMode {
+	CULLING_OFF = 0,	//Everything is submitted
+	CULLING_SCALAR,		//One box at a time
+	CULLING_SIMD,		//Eight boxes at a time with AVX when compiled for it, else four with SSE; scalar elsewhere
+	CULLING_BVH			//Down the draw items' bounding volume hierarchy (see Bvh.h); UCullBounds treats it as CULLING_SIMD
+};
+
+const char* UCullingModeName(CullingMode mode);
+
+//Left, right, bottom, top, near and far planes as an inward normal (xyz) and offset (w), normalised so w + dot
+//gives the signed distance
+struct Frustum {
+	glm::vec4 planes[6];
+};
+
+//Gribb-Hartmann extraction from a projection * view matrix; works for perspective and orthographic projections
+Frustum UExtractFrustum(const glm::mat4& viewProjection);
+
+//World-space boxes of the draw items as centre and half extent, structure of arrays so the SIMD loops load each
+//component of several boxes at once. Arrays are padded to a multiple of CULLING_BATCH, so the loops need no tail
+const size_t CULLING_BATCH = 8;
+struct CullingBounds {
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	size_t count = 0;
+};
+
+void UResizeCullingBounds(CullingBounds& bounds, size_t count);
+
+//Stores the world box around an object-space box transformed by world (Arvo's method: the centre goes through the
+//matrix, the extent through its absolute 3x3)
+void USetCullingBounds(CullingBounds& bounds, size_t index, const MeshBounds& mesh, const glm::mat4& world);
+
+//Appends the index of every box at least partly inside the frustum to visible, in index order. Boxes straddling
+//a plane corner may pass although they are outside, never the other way round
+void UCullBounds(const CullingBounds& bounds, const Frustum& frustum, CullingMode mode, std::vector<uint32_t>& visible);
+
+#endif
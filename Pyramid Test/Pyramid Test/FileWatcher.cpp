@@ -0,0 +1,94 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+#if !defined(__linux__)
+namespace {
+	time_t ModifiedTime(const string& path) {
+#ifdef _WIN32
+		struct _stat info;
+		return _stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+#else
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+#endif
+	}
+}
+#endif
+
+bool UCreateFileWatcher(FileWatcher& watcher, const string& directory, const vector<string>& files) {
+	UDestroyFileWatcher(watcher);
+	watcher.directory = directory;
+	watcher.files = files;
+
+#if defined(__linux__)
+	watcher.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watcher.inotifyFd < 0 || inotify_add_watch(watcher.inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		cout << "Failed to watch " << directory << " for changes: " << strerror(errno) << endl;
+		UDestroyFileWatcher(watcher);
+		return false;
+	}
+#else
+	for (const string& file : files)
+		watcher.modified.push_back(ModifiedTime(directory + "/" + file));
+	watcher.lastCheck = chrono::steady_clock::now();
+#endif
+	return true;
+}
+
+void UDestroyFileWatcher(FileWatcher& watcher) {
+#if defined(__linux__)
+	if (watcher.inotifyFd >= 0)
+		close(watcher.inotifyFd);
+#endif
+	watcher = FileWatcher();
+}
+
+bool UPollFileWatcher(FileWatcher& watcher) {
+	bool changed = false;
+
+#if defined(__linux__)
+	if (watcher.inotifyFd < 0)
+		return false;
+
+	//Drain every event queued since the last poll; a save is often several of them
+	alignas(inotify_event) char buffer[4096];
+	for (;;) {
+		const ssize_t length = read(watcher.inotifyFd, buffer, sizeof(buffer));
+		if (length <= 0)
+			break;
+		for (ssize_t offset = 0; offset < length;) {
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			if (event->len > 0 && find(watcher.files.begin(), watcher.files.end(), string(event->name)) != watcher.files.end())
+				changed = true;
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+#else
+	const auto now = chrono::steady_clock::now();
+	if (watcher.files.empty() || now - watcher.lastCheck < chrono::milliseconds(500))
+		return false;
+	watcher.lastCheck = now;
+
+	for (size_t i = 0; i < watcher.files.size(); ++i) {
+		const time_t modified = ModifiedTime(watcher.directory + "/" + watcher.files[i]);
+		if (modified != watcher.modified[i]) {
+			watcher.modified[i] = modified;
+			changed = true;
+		}
+	}
+#endif
+	return changed;
+}
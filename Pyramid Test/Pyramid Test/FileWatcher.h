@@ -0,0 +1,26 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <vector>
+
+//Watches some files of one directory for changes. Linux asks inotify about the directory, so editors that save by
+//writing a new file and renaming it over the old one are seen too; elsewhere the files' modification times are
+//compared, at most twice a second
+struct FileWatcher {
+	std::string directory;
+	std::vector<std::string> files;
+	int inotifyFd = -1;
+	std::vector<time_t> modified;
+	std::chrono::steady_clock::time_point lastCheck;
+};
+
+bool UCreateFileWatcher(FileWatcher& watcher, const std::string& directory, const std::vector<std::string>& files);
+void UDestroyFileWatcher(FileWatcher& watcher);
+
+//True when a watched file was written since the last call. Never blocks
+bool UPollFileWatcher(FileWatcher& watcher);
+
+#endif
@@ -0,0 +1,202 @@
+#include "Headless.h"
+
+#include <iostream>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+using namespace std;
+
+namespace {
+#if defined(__linux__)
+	EGLDisplay gEglDisplay = EGL_NO_DISPLAY;
+	EGLConfig gEglConfig = (EGLConfig)0;
+	EGLContext gEglContext = EGL_NO_CONTEXT;
+	EGLContext gEglSharedContext = EGL_NO_CONTEXT;
+
+	const EGLint CONTEXT_ATTRIBS[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 4,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+#else
+	GLFWwindow* gHiddenWindow = nullptr;
+	GLFWwindow* gSharedWindow = nullptr;
+#endif
+}
+
+#if defined(__linux__)
+//Surfaceless, so the size is the offscreen target's
+bool UCreateHeadlessContext(int, int) {
+	//Prefer the surfaceless platform so no X/Wayland display or GPU is needed
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		gEglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (gEglDisplay == EGL_NO_DISPLAY)
+		gEglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major = 0, minor = 0;
+	if (gEglDisplay == EGL_NO_DISPLAY || !eglInitialize(gEglDisplay, &major, &minor)) {
+		cout << "Failed to initialize EGL display (error 0x" << hex << eglGetError() << dec << ")" << endl;
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		cout << "EGL implementation does not support desktop OpenGL" << endl;
+		return false;
+	}
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLint numConfigs = 0;
+	eglChooseConfig(gEglDisplay, configAttribs, &gEglConfig, 1, &numConfigs);
+	if (numConfigs <= 0)
+		gEglConfig = (EGLConfig)0;
+
+	gEglContext = eglCreateContext(gEglDisplay, gEglConfig, EGL_NO_CONTEXT, CONTEXT_ATTRIBS);
+	if (gEglContext == EGL_NO_CONTEXT) {
+		cout << "Failed to create EGL context (error 0x" << hex << eglGetError() << dec << ")" << endl;
+		return false;
+	}
+
+	//All rendering goes to an FBO, so the context is made current without a surface
+	if (!eglMakeCurrent(gEglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, gEglContext)) {
+		cout << "Failed to make EGL context current (error 0x" << hex << eglGetError() << dec << ")" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+void UDestroyHeadlessContext() {
+	if (gEglDisplay == EGL_NO_DISPLAY)
+		return;
+
+	eglMakeCurrent(gEglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (gEglSharedContext != EGL_NO_CONTEXT)
+		eglDestroyContext(gEglDisplay, gEglSharedContext);
+	if (gEglContext != EGL_NO_CONTEXT)
+		eglDestroyContext(gEglDisplay, gEglContext);
+	eglTerminate(gEglDisplay);
+
+	gEglSharedContext = EGL_NO_CONTEXT;
+	gEglContext = EGL_NO_CONTEXT;
+	gEglDisplay = EGL_NO_DISPLAY;
+}
+
+bool UCreateHeadlessSharedContext() {
+	gEglSharedContext = eglCreateContext(gEglDisplay, gEglConfig, gEglContext, CONTEXT_ATTRIBS);
+	if (gEglSharedContext == EGL_NO_CONTEXT) {
+		cout << "Failed to create shared EGL context (error 0x" << hex << eglGetError() << dec << ")" << endl;
+		return false;
+	}
+	return true;
+}
+
+bool UMakeHeadlessSharedContextCurrent() {
+	//The bound API is per thread
+	return eglBindAPI(EGL_OPENGL_API) && eglMakeCurrent(gEglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, gEglSharedContext);
+}
+
+void UReleaseHeadlessSharedContext() {
+	eglMakeCurrent(gEglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglReleaseThread();
+}
+#else
+bool UCreateHeadlessContext(int width, int height) {
+	if (!glfwInit())
+		return false;
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+	gHiddenWindow = glfwCreateWindow(width, height, "headless", NULL, NULL);
+	if (gHiddenWindow == NULL) {
+		cout << "Failed to create hidden GLFW window" << endl;
+		glfwTerminate();
+		return false;
+	}
+	glfwMakeContextCurrent(gHiddenWindow);
+
+	return true;
+}
+
+void UDestroyHeadlessContext() {
+	if (gSharedWindow)
+		glfwDestroyWindow(gSharedWindow);
+	if (gHiddenWindow)
+		glfwDestroyWindow(gHiddenWindow);
+	gSharedWindow = gHiddenWindow = nullptr;
+	glfwTerminate();
+}
+
+bool UCreateHeadlessSharedContext() {
+	//The window hints of the headless window, visibility included, are still set
+	gSharedWindow = glfwCreateWindow(1, 1, "shader compiler", NULL, gHiddenWindow);
+	if (gSharedWindow == NULL) {
+		cout << "Failed to create shared GLFW context" << endl;
+		return false;
+	}
+	return true;
+}
+
+bool UMakeHeadlessSharedContextCurrent() {
+	glfwMakeContextCurrent(gSharedWindow);
+	return true;
+}
+
+void UReleaseHeadlessSharedContext() {
+	glfwMakeContextCurrent(NULL);
+}
+#endif
+
+bool UCreateOffscreenTarget(GLOffscreenTarget& target, int width, int height) {
+	target.width = width;
+	target.height = height;
+
+	glGenFramebuffers(1, &target.fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+
+	glGenRenderbuffers(1, &target.colorRbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, target.colorRbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.colorRbo);
+
+	glGenRenderbuffers(1, &target.depthRbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, target.depthRbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.depthRbo);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		cout << "Offscreen framebuffer incomplete (status 0x" << hex << status << dec << ")" << endl;
+		return false;
+	}
+
+	glViewport(0, 0, width, height);
+
+	return true;
+}
+
+void UDestroyOffscreenTarget(GLOffscreenTarget& target) {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteRenderbuffers(1, &target.colorRbo);
+	glDeleteRenderbuffers(1, &target.depthRbo);
+	glDeleteFramebuffers(1, &target.fbo);
+	target = GLOffscreenTarget();
+}
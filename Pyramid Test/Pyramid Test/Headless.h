@@ -0,0 +1,30 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <GL/glew.h>
+
+//Offscreen framebuffer the scene is rendered into when there is no window
+struct GLOffscreenTarget {
+	GLuint fbo = 0;
+	GLuint colorRbo = 0;
+	GLuint depthRbo = 0;
+	int width = 0;
+	int height = 0;
+};
+
+//Creates a GL 4.4 core context without a visible window.
+//Linux uses EGL on Mesa's surfaceless platform (works with llvmpipe and no display),
+//other platforms fall back to a hidden GLFW window.
+bool UCreateHeadlessContext(int width, int height);
+void UDestroyHeadlessContext();
+
+//Second context in the headless context's share group, for a worker thread. Created here on the main thread, made
+//current and released on the worker; UDestroyHeadlessContext destroys it
+bool UCreateHeadlessSharedContext();
+bool UMakeHeadlessSharedContextCurrent();
+void UReleaseHeadlessSharedContext();
+
+bool UCreateOffscreenTarget(GLOffscreenTarget& target, int width, int height);
+void UDestroyOffscreenTarget(GLOffscreenTarget& target);
+
+#endif
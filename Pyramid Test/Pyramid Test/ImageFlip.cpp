@@ -0,0 +1,130 @@
+#include "ImageFlip.h"
+
+#include <cstring>
+#include <utility>
+
+//SSE2 is part of x86-64 and of 32-bit builds with /arch:SSE2 (the MSVC default)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_FLIP_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	void FlipScalar(unsigned char* image, int width, int height, int channels) {
+		for (int j = 0; j < height / 2; ++j)
+		{
+			int index1 = j * width * channels;
+			int index2 = (height - 1 - j) * width * channels;
+
+			for (int i = width * channels; i > 0; --i)
+			{
+				unsigned char tmp = image[index1];
+				image[index1] = image[index2];
+				image[index2] = tmp;
+				++index1;
+				++index2;
+			}
+		}
+	}
+
+	void SwapRowsMemcpy(unsigned char* a, unsigned char* b, size_t bytes, unsigned char* scratch) {
+		memcpy(scratch, a, bytes);
+		memcpy(a, b, bytes);
+		memcpy(b, scratch, bytes);
+	}
+
+#ifdef IMAGE_FLIP_SSE2
+	//Rows are only byte aligned (width * 3), so everything uses unaligned loads and stores; four registers per side
+	//per iteration keep enough loads in flight to stay memory bound
+	void SwapRowsSimd(unsigned char* a, unsigned char* b, size_t bytes) {
+		size_t i = 0;
+#ifdef __AVX2__
+		for (; i + 64 <= bytes; i += 64) {
+			const __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+			const __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 32));
+			const __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+			const __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 32));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), b0);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i + 32), b1);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(b + i), a0);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(b + i + 32), a1);
+		}
+#endif
+		for (; i + 64 <= bytes; i += 64) {
+			const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+			const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 16));
+			const __m128i a2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 32));
+			const __m128i a3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 48));
+			const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+			const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 16));
+			const __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 32));
+			const __m128i b3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 48));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), b0);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(a + i + 16), b1);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(a + i + 32), b2);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(a + i + 48), b3);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(b + i), a0);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(b + i + 16), a1);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(b + i + 32), a2);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(b + i + 48), a3);
+		}
+		for (; i + 16 <= bytes; i += 16) {
+			const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+			const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), b0);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(b + i), a0);
+		}
+		for (; i < bytes; ++i)
+			swap(a[i], b[i]);
+	}
+#endif
+}
+
+const char* UFlipMethodName(FlipMethod method) {
+	switch (method) {
+	case FLIP_SCALAR:
+		return "scalar";
+	case FLIP_MEMCPY:
+		return "memcpy";
+	default:
+#if defined(__AVX2__)
+		return "avx2";
+#elif defined(IMAGE_FLIP_SSE2)
+		return "sse2";
+#else
+		return "memcpy";
+#endif
+	}
+}
+
+void UFlipImageRows(unsigned char* image, int width, int height, int channels, FlipMethod method, vector<unsigned char>& scratch) {
+	if (method == FLIP_SCALAR) {
+		FlipScalar(image, width, height, channels);
+		return;
+	}
+
+	const size_t rowBytes = static_cast<size_t>(width) * channels;
+#ifdef IMAGE_FLIP_SSE2
+	if (method == FLIP_SIMD) {
+		for (int j = 0; j < height / 2; ++j)
+			SwapRowsSimd(image + j * rowBytes, image + (height - 1 - j) * rowBytes, rowBytes);
+		return;
+	}
+#endif
+
+	if (scratch.size() < rowBytes)
+		scratch.resize(rowBytes);
+	for (int j = 0; j < height / 2; ++j)
+		SwapRowsMemcpy(image + j * rowBytes, image + (height - 1 - j) * rowBytes, rowBytes, scratch.data());
+}
+
+void flipImageVertically(unsigned char* image, int width, int height, int channels) {
+	//Without SIMD this is the memcpy path, which wants a row buffer per thread
+	static thread_local vector<unsigned char> scratch;
+	UFlipImageRows(image, width, height, channels, FLIP_SIMD, scratch);
+}
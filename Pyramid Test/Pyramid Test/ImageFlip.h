@@ -0,0 +1,23 @@
+#ifndef IMAGE_FLIP_H
+#define IMAGE_FLIP_H
+
+#include <vector>
+
+//Ways to swap the rows of an image. All give the same result; they exist side by side so texbake --flip-benchmark
+//can compare them
+enum FlipMethod {
+	FLIP_SCALAR = 0,	//Byte at a time, the original loop
+	FLIP_MEMCPY,		//Whole rows through a row-sized scratch buffer
+	FLIP_SIMD			//Whole rows swapped through vector registers (AVX2 when compiled for it, else SSE2); memcpy elsewhere
+};
+
+const char* UFlipMethodName(FlipMethod method);
+
+//Flips rows in place so the first row of the file ends up at texture coordinate v = 0. scratch is only used by
+//FLIP_MEMCPY and keeps its capacity between calls, so a caller flipping many images allocates once
+void UFlipImageRows(unsigned char* image, int width, int height, int channels, FlipMethod method, std::vector<unsigned char>& scratch);
+
+//Flips with the fastest method built in
+void flipImageVertically(unsigned char* image, int width, int height, int channels);
+
+#endif
@@ -0,0 +1,80 @@
+#include "Instancing.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+namespace {
+	//Fills the index buffer with 0 .. indexCapacity - 1
+	void FillInstanceIndices(const GLInstanceBuffer& buffer) {
+		vector<uint32_t> indices(buffer.indexCapacity);
+		for (size_t i = 0; i < indices.size(); ++i)
+			indices[i] = static_cast<uint32_t>(i);
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffer.indexVbo);
+		glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+void UCreateInstanceBuffer(GLInstanceBuffer& buffer, size_t initialCapacity) {
+	buffer.capacity = max<size_t>(initialCapacity, 1);
+	buffer.indexCapacity = buffer.capacity;
+
+	glGenBuffers(1, &buffer.ssbo);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.ssbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, buffer.capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glGenBuffers(1, &buffer.indexVbo);
+	FillInstanceIndices(buffer);
+}
+
+void UDestroyInstanceBuffer(GLInstanceBuffer& buffer) {
+	glDeleteBuffers(1, &buffer.ssbo);
+	glDeleteBuffers(1, &buffer.indexVbo);
+	buffer = GLInstanceBuffer();
+}
+
+void UAttachInstanceBuffer(const GLInstanceBuffer& buffer, GLuint vao) {
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.indexVbo);
+
+	glEnableVertexAttribArray(INSTANCE_INDEX_LOCATION);
+	glVertexAttribIPointer(INSTANCE_INDEX_LOCATION, 1, GL_UNSIGNED_INT, sizeof(uint32_t), 0);
+	glVertexAttribDivisor(INSTANCE_INDEX_LOCATION, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+InstanceData UMakeInstance(const glm::mat4& model, const glm::mat3& normalMatrix, glm::uvec2 texture, glm::vec2 uvScale) {
+	InstanceData instance;
+	instance.model = model;
+	for (int column = 0; column < 3; ++column)
+		instance.normalMatrix[column] = glm::vec4(normalMatrix[column], 0.0f);
+	instance.texture = texture;
+	instance.uvScale = uvScale;
+	return instance;
+}
+
+void UUploadInstances(GLInstanceBuffer& buffer, const vector<InstanceData>& instances, size_t slots) {
+	if (instances.empty())
+		return;
+
+	//Grow geometrically; the VAOs reference the index buffer by name, so new storage needs no re-attach
+	if (instances.size() > buffer.capacity)
+		buffer.capacity = max(instances.size(), buffer.capacity * 2);
+	slots = max(slots, buffer.capacity);
+	if (slots > buffer.indexCapacity) {
+		buffer.indexCapacity = max(slots, buffer.indexCapacity * 2);
+		FillInstanceIndices(buffer);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer.ssbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, buffer.capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, instances.size() * sizeof(InstanceData), instances.data());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BUFFER_BINDING, buffer.ssbo);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
@@ -0,0 +1,52 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+//Attribute location of the per-instance index into the instance buffer
+const GLuint INSTANCE_INDEX_LOCATION = 3;
+//Shader storage binding point of the instance buffer (1-3 are the light buffers)
+const GLuint INSTANCE_BUFFER_BINDING = 4;
+
+//Material flags in InstanceData::texture.y. Specialised shader variants know their material at compile time and
+//only the generic variant reads the last two (see ShaderVariants)
+const GLuint INSTANCE_ROWS_TOP_DOWN = 1;	//The texture layer's rows are top-down, v is mirrored
+const GLuint INSTANCE_UNTEXTURED = 2;		//texture.x holds a flat colour packed as unorm RGBA8 instead of a layer
+const GLuint INSTANCE_NO_SPECULAR = 4;
+
+//CPU mirror of one std430 Instance in the instance buffer (mat3 columns are padded to vec4), 128 bytes
+struct InstanceData {
+	glm::mat4 model;
+	glm::vec4 normalMatrix[3];	//Columns, computed on the CPU when the node moves so the shader never inverts
+	glm::uvec2 texture;			//Layer in the scene's texture array (or packed colour) and INSTANCE_ flags
+	glm::vec2 uvScale;
+};
+
+//Per-instance data lives in a shader storage buffer the vertex shader indexes. The only instanced attribute is
+//the instance's index, read from a buffer holding 0, 1, 2, ... with divisor 1, so the base instance of a draw
+//(plain or indirect) selects the slice of the storage buffer the batch uses
+struct GLInstanceBuffer {
+	GLuint ssbo = 0;
+	GLuint indexVbo = 0;
+	size_t capacity = 0;		//In instances
+	size_t indexCapacity = 0;	//Entries in the index buffer, at least capacity
+};
+
+void UCreateInstanceBuffer(GLInstanceBuffer& buffer, size_t initialCapacity);
+void UDestroyInstanceBuffer(GLInstanceBuffer& buffer);
+
+//Points the instance index attribute of a VAO at the shared index buffer
+void UAttachInstanceBuffer(const GLInstanceBuffer& buffer, GLuint vao);
+
+//Packs a draw item's transforms and material into the instance layout
+InstanceData UMakeInstance(const glm::mat4& model, const glm::mat3& normalMatrix, glm::uvec2 texture, glm::vec2 uvScale);
+
+//Replaces the buffer contents for this frame, orphaning the old storage so the GPU never stalls on it, and binds
+//it to INSTANCE_BUFFER_BINDING. slots is how many instance indices draws may select this frame, when that is more
+//than the instances uploaded (the occlusion passes draw from a compacted copy twice the size)
+void UUploadInstances(GLInstanceBuffer& buffer, const std::vector<InstanceData>& instances, size_t slots = 0);
+
+#endif
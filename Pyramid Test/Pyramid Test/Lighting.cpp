@@ -0,0 +1,200 @@
+#include "Lighting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+	GpuLight ToGpuLight(const SceneLight& light) {
+		GpuLight gpu;
+		gpu.positionRange = glm::vec4(light.position, light.type == LIGHT_POINT ? light.range : 0.0f);
+		gpu.colorType = glm::vec4(light.color, static_cast<float>(light.type));
+		gpu.shading = glm::vec4(light.ambient, light.specular, light.highlight, 0.0f);
+		return gpu;
+	}
+
+	//Point on the view ray through NDC (x, y) at the given view-space depth (distance in front of the camera).
+	//Works for perspective and orthographic projections alike
+	glm::vec3 UnprojectAtDepth(const glm::mat4& inverseProjection, float x, float y, float depth) {
+		glm::vec4 nearPoint = inverseProjection * glm::vec4(x, y, -1.0f, 1.0f);
+		glm::vec4 farPoint = inverseProjection * glm::vec4(x, y, 1.0f, 1.0f);
+		glm::vec3 a = glm::vec3(nearPoint) / nearPoint.w;
+		glm::vec3 b = glm::vec3(farPoint) / farPoint.w;
+		float t = (-depth - a.z) / (b.z - a.z);
+		return a + (b - a) * t;
+	}
+
+	//Depth range covered by a slice; the first and last slices stretch to the clip planes
+	void SliceRange(const LightGrid& grid, int slice, float nearPlane, float farPlane, float& sliceNear, float& sliceFar) {
+		sliceNear = slice == 0 ? min(nearPlane, grid.sliceNear) : grid.sliceNear * exp(slice / grid.sliceScale);
+		sliceFar = slice == grid.slices - 1 ? farPlane : grid.sliceNear * exp((slice + 1) / grid.sliceScale);
+	}
+
+	void BuildClusterBounds(LightGrid& grid, const glm::mat4& projection, float nearPlane, float farPlane, int width, int height) {
+		const glm::mat4 inverseProjection = glm::inverse(projection);
+		const int clusterCount = grid.tilesX * grid.tilesY * grid.slices;
+		grid.clusterMin.resize(clusterCount);
+		grid.clusterMax.resize(clusterCount);
+
+		for (int slice = 0; slice < grid.slices; ++slice) {
+			float sliceNear, sliceFar;
+			SliceRange(grid, slice, nearPlane, farPlane, sliceNear, sliceFar);
+
+			for (int y = 0; y < grid.tilesY; ++y) {
+				float y0 = -1.0f + 2.0f * y * LIGHT_TILE_SIZE / height;
+				float y1 = min(-1.0f + 2.0f * (y + 1) * LIGHT_TILE_SIZE / height, 1.0f);
+
+				for (int x = 0; x < grid.tilesX; ++x) {
+					float x0 = -1.0f + 2.0f * x * LIGHT_TILE_SIZE / width;
+					float x1 = min(-1.0f + 2.0f * (x + 1) * LIGHT_TILE_SIZE / width, 1.0f);
+
+					//Box around the eight corners of the tile's frustum segment
+					glm::vec3 boundsMin(1e30f);
+					glm::vec3 boundsMax(-1e30f);
+					for (int corner = 0; corner < 8; ++corner) {
+						glm::vec3 p = UnprojectAtDepth(inverseProjection, corner & 1 ? x1 : x0, corner & 2 ? y1 : y0, corner & 4 ? sliceFar : sliceNear);
+						boundsMin = glm::min(boundsMin, p);
+						boundsMax = glm::max(boundsMax, p);
+					}
+
+					int cluster = (slice * grid.tilesY + y) * grid.tilesX + x;
+					grid.clusterMin[cluster] = boundsMin;
+					grid.clusterMax[cluster] = boundsMax;
+				}
+			}
+		}
+	}
+
+	float DistanceSq(glm::vec3 point, glm::vec3 boxMin, glm::vec3 boxMax) {
+		glm::vec3 closest = glm::clamp(point, boxMin, boxMax);
+		glm::vec3 offset = point - closest;
+		return glm::dot(offset, offset);
+	}
+
+	//Same scheme as the instance buffer: grow geometrically and orphan every frame so the GPU never stalls
+	void UploadStorage(GLuint buffer, size_t& capacity, const void* data, size_t bytes) {
+		if (bytes == 0)
+			return;
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		if (bytes > capacity)
+			capacity = max(bytes, capacity * 2);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, data);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+}
+
+void UCullLights(const vector<SceneLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+	float nearPlane, float farPlane, int width, int height, WorkerPool& pool, LightGrid& grid) {
+	grid.lights.clear();
+	grid.viewSpheres.clear();
+
+	//Unbounded lights first, they are looped over by every fragment
+	for (const SceneLight& light : lights) {
+		if (light.type == LIGHT_DIRECTIONAL || light.range <= 0.0f)
+			grid.lights.push_back(ToGpuLight(light));
+	}
+	grid.globalLights = static_cast<int>(grid.lights.size());
+
+	for (const SceneLight& light : lights) {
+		if (light.type == LIGHT_POINT && light.range > 0.0f) {
+			grid.lights.push_back(ToGpuLight(light));
+			grid.viewSpheres.push_back(glm::vec4(glm::vec3(view * glm::vec4(light.position, 1.0f)), light.range));
+		}
+	}
+
+	grid.tilesX = (width + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+	grid.tilesY = (height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+	grid.sliceNear = max(nearPlane, LIGHT_SLICE_MIN_DEPTH);
+	grid.sliceScale = grid.slices / log(max(farPlane, grid.sliceNear * 2.0f) / grid.sliceNear);
+
+	if (width != grid.boundsWidth || height != grid.boundsHeight || memcmp(&projection, &grid.boundsProjection, sizeof(glm::mat4)) != 0) {
+		BuildClusterBounds(grid, projection, nearPlane, farPlane, width, height);
+		grid.boundsProjection = projection;
+		grid.boundsWidth = width;
+		grid.boundsHeight = height;
+	}
+
+	const int tilesPerSlice = grid.tilesX * grid.tilesY;
+	grid.clusters.resize(tilesPerSlice * grid.slices);
+	grid.sliceIndices.resize(grid.slices);
+	grid.sliceCandidates.resize(grid.slices);
+
+	pool.ParallelFor(grid.slices, [&](int slice) {
+		float sliceNear, sliceFar;
+		SliceRange(grid, slice, nearPlane, farPlane, sliceNear, sliceFar);
+
+		//Only lights whose depth extent reaches this slice are tested against its tiles
+		vector<uint32_t>& candidates = grid.sliceCandidates[slice];
+		candidates.clear();
+		for (size_t i = 0; i < grid.viewSpheres.size(); ++i) {
+			float depth = -grid.viewSpheres[i].z;
+			float range = grid.viewSpheres[i].w;
+			if (depth + range >= sliceNear && depth - range <= sliceFar)
+				candidates.push_back(static_cast<uint32_t>(i));
+		}
+
+		vector<uint32_t>& indices = grid.sliceIndices[slice];
+		indices.clear();
+		for (int tile = 0; tile < tilesPerSlice; ++tile) {
+			const int cluster = slice * tilesPerSlice + tile;
+			LightCluster& entry = grid.clusters[cluster];
+			entry.offset = static_cast<uint32_t>(indices.size());
+
+			for (uint32_t candidate : candidates) {
+				const glm::vec4& sphere = grid.viewSpheres[candidate];
+				if (DistanceSq(glm::vec3(sphere), grid.clusterMin[cluster], grid.clusterMax[cluster]) <= sphere.w * sphere.w)
+					indices.push_back(grid.globalLights + candidate);
+			}
+			entry.count = static_cast<uint32_t>(indices.size()) - entry.offset;
+		}
+	});
+
+	//Concatenate the per-slice lists; cluster offsets become absolute
+	grid.indices.clear();
+	for (int slice = 0; slice < grid.slices; ++slice) {
+		const uint32_t base = static_cast<uint32_t>(grid.indices.size());
+		for (int tile = 0; tile < tilesPerSlice; ++tile)
+			grid.clusters[slice * tilesPerSlice + tile].offset += base;
+		grid.indices.insert(grid.indices.end(), grid.sliceIndices[slice].begin(), grid.sliceIndices[slice].end());
+	}
+}
+
+void UCreateLightBuffers(GLLightBuffers& buffers) {
+	glGenBuffers(1, &buffers.lights);
+	glGenBuffers(1, &buffers.clusters);
+	glGenBuffers(1, &buffers.indices);
+
+	//Start with room for one element so the bindings never point at an empty store
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers.lights);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuLight), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers.clusters);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(LightCluster), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers.indices);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	buffers.lightBytes = sizeof(GpuLight);
+	buffers.clusterBytes = sizeof(LightCluster);
+	buffers.indexBytes = sizeof(uint32_t);
+
+	//Like the FrameData block, the binding points match the shader layouts and are set once
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BUFFER_BINDING, buffers.lights);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_CLUSTER_BINDING, buffers.clusters);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_BINDING, buffers.indices);
+}
+
+void UUploadLightGrid(GLLightBuffers& buffers, const LightGrid& grid) {
+	UploadStorage(buffers.lights, buffers.lightBytes, grid.lights.data(), grid.lights.size() * sizeof(GpuLight));
+	UploadStorage(buffers.clusters, buffers.clusterBytes, grid.clusters.data(), grid.clusters.size() * sizeof(LightCluster));
+	UploadStorage(buffers.indices, buffers.indexBytes, grid.indices.data(), grid.indices.size() * sizeof(uint32_t));
+}
+
+void UDestroyLightBuffers(GLLightBuffers& buffers) {
+	glDeleteBuffers(1, &buffers.lights);
+	glDeleteBuffers(1, &buffers.clusters);
+	glDeleteBuffers(1, &buffers.indices);
+	buffers = GLLightBuffers();
+}
@@ -0,0 +1,82 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Scene.h"
+#include "WorkerPool.h"
+
+//Shader storage binding points of the light, cluster and light index buffers
+const GLuint LIGHT_BUFFER_BINDING = 1;
+const GLuint LIGHT_CLUSTER_BINDING = 2;
+const GLuint LIGHT_INDEX_BINDING = 3;
+
+//Clusters are screen tiles of LIGHT_TILE_SIZE pixels split into exponential depth slices
+const int LIGHT_TILE_SIZE = 64;
+const int LIGHT_DEPTH_SLICES = 16;
+const float LIGHT_SLICE_MIN_DEPTH = 0.1f;	//Depth where slicing starts; anything closer lands in the first slice
+
+//std430 mirror of the shader's Light struct
+struct GpuLight {
+	glm::vec4 positionRange;	//xyz world position (travel direction for directional lights), w range (0 = unbounded)
+	glm::vec4 colorType;		//rgb colour, w LightType
+	glm::vec4 shading;			//ambient strength, specular strength, specular exponent, unused
+};
+
+//Slice of the light index list used by one cluster
+struct LightCluster {
+	uint32_t offset;
+	uint32_t count;
+};
+
+//Lights sorted for the GPU and the per-cluster light lists for one frame.
+//Unbounded lights come first and are evaluated by every fragment; the rest are only listed in clusters they touch
+struct LightGrid {
+	int tilesX = 0;
+	int tilesY = 0;
+	int slices = LIGHT_DEPTH_SLICES;
+	float sliceNear = LIGHT_SLICE_MIN_DEPTH;
+	float sliceScale = 1.0f;	//Slices per unit of log(depth / sliceNear)
+	int globalLights = 0;
+
+	std::vector<GpuLight> lights;
+	std::vector<LightCluster> clusters;
+	std::vector<uint32_t> indices;
+
+	//View-space cluster bounds, rebuilt only when the projection or viewport changes
+	glm::mat4 boundsProjection = glm::mat4(0.0f);
+	int boundsWidth = 0;
+	int boundsHeight = 0;
+	std::vector<glm::vec3> clusterMin;
+	std::vector<glm::vec3> clusterMax;
+
+	//Per-frame scratch
+	std::vector<glm::vec4> viewSpheres;		//View-space centre and range of each bounded light
+	std::vector<std::vector<uint32_t>> sliceIndices;
+	std::vector<std::vector<uint32_t>> sliceCandidates;
+};
+
+//Storage buffers holding a LightGrid on the GPU
+struct GLLightBuffers {
+	GLuint lights = 0;
+	GLuint clusters = 0;
+	GLuint indices = 0;
+	size_t lightBytes = 0;
+	size_t clusterBytes = 0;
+	size_t indexBytes = 0;
+};
+
+//Assigns bounded point lights to the clusters their range sphere overlaps, one depth slice per job on the pool.
+//nearPlane/farPlane are the projection's clip distances; width/height the viewport in pixels
+void UCullLights(const std::vector<SceneLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+	float nearPlane, float farPlane, int width, int height, WorkerPool& pool, LightGrid& grid);
+
+void UCreateLightBuffers(GLLightBuffers& buffers);
+void UUploadLightGrid(GLLightBuffers& buffers, const LightGrid& grid);
+void UDestroyLightBuffers(GLLightBuffers& buffers);
+
+#endif
@@ -0,0 +1,53 @@
+#include "Lod.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+	const float PI = 3.14159265358979323846f;
+
+	//Coarsest level whose segments along the projected circumference are at most LOD_PIXELS_PER_SEGMENT long
+	int LevelForSize(float pixels) {
+		const float segments = PI * pixels / LOD_PIXELS_PER_SEGMENT;
+		for (int level = 0; level < LOD_LEVELS; ++level)
+			if (LOD_SEGMENTS[level] >= segments)
+				return level;
+		return LOD_LEVELS - 1;
+	}
+}
+
+bool UPrimitiveHasLod(const PrimitiveDesc& desc) {
+	switch (desc.shape) {
+	case PRIMITIVE_CYLINDER:
+	case PRIMITIVE_DISC:
+	case PRIMITIVE_CONE:
+	case PRIMITIVE_SPHERE:
+	case PRIMITIVE_TORUS:
+		return true;
+	default:
+		return false;
+	}
+}
+
+PrimitiveDesc ULodPrimitive(const PrimitiveDesc& desc, int level) {
+	PrimitiveDesc lod = desc;
+	lod.segments = LOD_SEGMENTS[level];
+	//Straight-sided shapes keep their rings; the curved profiles of spheres and tori follow the segment count
+	if (desc.shape == PRIMITIVE_SPHERE || desc.shape == PRIMITIVE_TORUS)
+		lod.rings = max(1, desc.rings * lod.segments / max(desc.segments, 1));
+	return lod;
+}
+
+float UProjectedDiameter(const glm::mat4& projection, const glm::vec3& viewCenter, float radius, float viewportHeight) {
+	//Clip w is the view depth for a perspective projection and 1 for an orthographic one
+	const float w = projection[2][3] * viewCenter.z + projection[3][3];
+	return radius * projection[1][1] * viewportHeight / max(w, 1e-3f);
+}
+
+int USelectLodLevel(float pixels, int previous) {
+	const int level = LevelForSize(pixels);
+	if (previous < 0 || level >= previous)
+		return level;
+	return min(previous, LevelForSize(pixels * (1.0f + LOD_HYSTERESIS)));
+}
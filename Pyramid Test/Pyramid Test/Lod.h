@@ -0,0 +1,37 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <glm/glm.hpp>
+
+#include "Primitives.h"
+
+//Round primitives are generated at each of these segment counts and drawn at the coarsest one whose segments
+//stay under LOD_PIXELS_PER_SEGMENT of the projected circumference
+const int LOD_LEVELS = 5;
+const int LOD_SEGMENTS[LOD_LEVELS] = { 8, 16, 32, 64, 128 };
+const float LOD_PIXELS_PER_SEGMENT = 12.0f;
+//A coarser level is only taken once the object has shrunk this fraction past the switch point, so one resting on
+//a threshold does not flicker between levels
+const float LOD_HYSTERESIS = 0.2f;
+
+//GLMesh entries drawing one primitive at each level, coarsest first; count is 0 for meshes without levels
+struct MeshLodChain {
+	int meshes[LOD_LEVELS] = {};
+	int count = 0;
+	float radius = 0.0f;	//Object-space distance from the primitive's axis (+Y) to its rim
+};
+
+//Whether a primitive is round and so worth generating at several segment counts
+bool UPrimitiveHasLod(const PrimitiveDesc& desc);
+
+//The primitive at a level: segments from LOD_SEGMENTS and rings scaled to keep their ratio to segments
+PrimitiveDesc ULodPrimitive(const PrimitiveDesc& desc, int level);
+
+//Pixels across the screen a sphere of radius spans at viewCenter (view space), for perspective and orthographic
+//projections alike
+float UProjectedDiameter(const glm::mat4& projection, const glm::vec3& viewCenter, float radius, float viewportHeight);
+
+//Level to draw a primitive spanning pixels with; previous is the level drawn last frame, or -1
+int USelectLodLevel(float pixels, int previous);
+
+#endif
@@ -0,0 +1,498 @@
+#include "MeshBuilder.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+	struct VertexHash {
+		size_t operator()(const MeshVertex& vertex) const {
+			//FNV-1a over the raw bytes; -0.0 is folded into 0.0 before vertices reach the map
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+			size_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(MeshVertex); ++i) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+	};
+
+	struct VertexEqual {
+		bool operator()(const MeshVertex& a, const MeshVertex& b) const {
+			return memcmp(&a, &b, sizeof(MeshVertex)) == 0;
+		}
+	};
+
+	MeshVertex Canonical(MeshVertex vertex) {
+		float* values = reinterpret_cast<float*>(&vertex);
+		for (size_t i = 0; i < sizeof(MeshVertex) / sizeof(float); ++i)
+			values[i] += 0.0f;
+		return vertex;
+	}
+
+	//IEEE half with round to nearest even; values past the half range become infinity
+	uint16_t FloatToHalf(float value) {
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		const int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+		uint32_t mantissa = bits & 0x7FFFFF;
+
+		if (exponent >= 31)
+			return static_cast<uint16_t>(sign | 0x7C00);
+
+		//Subnormal halves keep the implicit bit in the mantissa and shift further
+		int shift = 13;
+		uint32_t half = static_cast<uint32_t>(exponent) << 10;
+		if (exponent <= 0) {
+			if (exponent < -10)
+				return static_cast<uint16_t>(sign);
+			mantissa |= 0x800000;
+			shift = 14 - exponent;
+			half = 0;
+		}
+
+		const uint32_t rest = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		half |= mantissa >> shift;
+		if (rest > halfway || (rest == halfway && (half & 1)))
+			++half;		//A carry into the exponent is still the correctly rounded value
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	float HalfToFloat(uint16_t half) {
+		const int exponent = (half >> 10) & 0x1F;
+		const int mantissa = half & 0x3FF;
+		float value = exponent == 0 ? ldexp(static_cast<float>(mantissa), -24) : ldexp(static_cast<float>(mantissa | 0x400), exponent - 25);
+		return half & 0x8000 ? -value : value;
+	}
+
+	//Octahedral mapping: the unit sphere is projected onto an octahedron and the lower half folded over the square's corners
+	glm::vec2 OctahedralEncode(glm::vec3 n) {
+		n /= fabs(n.x) + fabs(n.y) + fabs(n.z);
+		glm::vec2 e(n.x, n.y);
+		if (n.z < 0.0f)
+			e = glm::vec2((1.0f - fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+		return e;
+	}
+
+	//Same decode as the vertex shader's OctahedralDecode
+	glm::vec3 OctahedralDecode(glm::vec2 e) {
+		glm::vec3 n(e.x, e.y, 1.0f - fabs(e.x) - fabs(e.y));
+		float t = max(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+		return glm::normalize(n);
+	}
+
+	//Signed normalized 10-bit fields as GL reads them: max(q / 511, -1)
+	float Snorm10(int q) {
+		return max(q / 511.0f, -1.0f);
+	}
+
+	uint32_t PackNormal(int x, int y) {
+		return (static_cast<uint32_t>(x) & 0x3FF) | ((static_cast<uint32_t>(y) & 0x3FF) << 10);
+	}
+
+	//Rounding each component independently is not always closest on the sphere, so all four
+	//neighbouring grid points are tried and the one decoding nearest the input kept
+	uint32_t EncodeNormal(const glm::vec3& normal) {
+		const float length = glm::length(normal);
+		if (length == 0.0f)
+			return PackNormal(0, 0);
+
+		const glm::vec3 unit = normal / length;
+		const glm::vec2 e = OctahedralEncode(unit) * 511.0f;
+		const int baseX = static_cast<int>(floor(e.x));
+		const int baseY = static_cast<int>(floor(e.y));
+
+		uint32_t best = 0;
+		float bestDot = -2.0f;
+		for (int candidate = 0; candidate < 4; ++candidate) {
+			int x = glm::clamp(baseX + (candidate & 1), -511, 511);
+			int y = glm::clamp(baseY + (candidate >> 1), -511, 511);
+			float d = glm::dot(OctahedralDecode(glm::vec2(Snorm10(x), Snorm10(y))), unit);
+			if (d > bestDot) {
+				bestDot = d;
+				best = PackNormal(x, y);
+			}
+		}
+		return best;
+	}
+
+	glm::vec3 DecodeNormal(uint32_t packed) {
+		//Sign-extend the 10-bit fields
+		int x = static_cast<int>(packed << 22) >> 22;
+		int y = static_cast<int>(packed << 12) >> 22;
+		return OctahedralDecode(glm::vec2(Snorm10(x), Snorm10(y)));
+	}
+
+	//Forsyth's scoring: recently used vertices score high (the last triangle's three a fixed amount lower,
+	//so strips don't run away), and vertices with few remaining triangles get a boost so they are finished off
+	const int FORSYTH_CACHE_SIZE = 32;
+	const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+	const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+	const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+	const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+	float ForsythVertexScore(int cachePosition, int remainingTriangles) {
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			if (cachePosition < 3)
+				score = FORSYTH_LAST_TRIANGLE_SCORE;
+			else
+				score = pow(1.0f - static_cast<float>(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+		}
+		return score + FORSYTH_VALENCE_BOOST_SCALE * pow(static_cast<float>(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+	}
+}
+
+MeshData UMeshFromInterleaved(const float* data, size_t floatCount) {
+	const size_t floatsPerVertex = 8;
+	MeshData mesh;
+	mesh.vertices.resize(floatCount / floatsPerVertex);
+	mesh.indices.resize(mesh.vertices.size());
+
+	for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+		const float* source = data + i * floatsPerVertex;
+		mesh.vertices[i].position = glm::vec3(source[0], source[1], source[2]);
+		mesh.vertices[i].uv = glm::vec2(source[3], source[4]);
+		mesh.vertices[i].normal = glm::vec3(source[5], source[6], source[7]);
+		mesh.indices[i] = static_cast<uint32_t>(i);
+	}
+	return mesh;
+}
+
+void UWeldVertices(MeshData& mesh) {
+	unordered_map<MeshVertex, uint32_t, VertexHash, VertexEqual> unique;
+	unique.reserve(mesh.vertices.size());
+
+	vector<MeshVertex> welded;
+	welded.reserve(mesh.vertices.size());
+	vector<uint32_t> remap(mesh.vertices.size());
+
+	for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+		MeshVertex vertex = Canonical(mesh.vertices[i]);
+		auto found = unique.find(vertex);
+		if (found == unique.end()) {
+			found = unique.emplace(vertex, static_cast<uint32_t>(welded.size())).first;
+			welded.push_back(vertex);
+		}
+		remap[i] = found->second;
+	}
+
+	//Strip joins collapse onto shared vertices once welded; they would only cost index fetches
+	vector<uint32_t> indices;
+	indices.reserve(mesh.indices.size());
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		uint32_t a = remap[mesh.indices[i]];
+		uint32_t b = remap[mesh.indices[i + 1]];
+		uint32_t c = remap[mesh.indices[i + 2]];
+		if (a != b && b != c && c != a)
+			indices.insert(indices.end(), { a, b, c });
+	}
+
+	mesh.vertices.swap(welded);
+	mesh.indices.swap(indices);
+}
+
+void UOptimizeVertexCache(vector<uint32_t>& indices, size_t vertexCount) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	//Triangles using each vertex, as one flat array; the first remaining[v] entries are the ones not yet emitted
+	vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : indices)
+		++remaining[index];
+
+	vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] = offsets[v] + remaining[v];
+
+	vector<uint32_t> vertexTriangles(indices.size());
+	vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; ++t) {
+		for (int corner = 0; corner < 3; ++corner)
+			vertexTriangles[fill[indices[t * 3 + corner]]++] = static_cast<uint32_t>(t);
+	}
+
+	vector<int> cachePosition(vertexCount, -1);
+	vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+
+	vector<float> triangleScore(triangleCount);
+	for (size_t t = 0; t < triangleCount; ++t)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+	vector<char> emitted(triangleCount, 0);
+	vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	//Simulated LRU cache, most recently used vertex first
+	vector<uint32_t> cache;
+	vector<uint32_t> nextCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	size_t bestTriangle = max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+	size_t scanCursor = 0;
+
+	while (output.size() < indices.size()) {
+		const uint32_t* corners = &indices[bestTriangle * 3];
+		output.insert(output.end(), corners, corners + 3);
+		emitted[bestTriangle] = 1;
+
+		//Remove the triangle from its vertices' remaining lists
+		for (int corner = 0; corner < 3; ++corner) {
+			uint32_t v = corners[corner];
+			uint32_t* begin = &vertexTriangles[offsets[v]];
+			uint32_t* end = begin + remaining[v];
+			uint32_t* found = find(begin, end, static_cast<uint32_t>(bestTriangle));
+			swap(*found, *(end - 1));
+			--remaining[v];
+		}
+
+		//Move the triangle's vertices to the front of the LRU cache
+		nextCache.assign(corners, corners + 3);
+		for (uint32_t v : cache) {
+			if (v != corners[0] && v != corners[1] && v != corners[2])
+				nextCache.push_back(v);
+		}
+		for (size_t i = FORSYTH_CACHE_SIZE; i < nextCache.size(); ++i)
+			cachePosition[nextCache[i]] = -1;
+		if (nextCache.size() > static_cast<size_t>(FORSYTH_CACHE_SIZE))
+			nextCache.resize(FORSYTH_CACHE_SIZE);
+		cache.swap(nextCache);
+
+		//Rescore what is in the cache and pick the best triangle touching it
+		for (size_t i = 0; i < cache.size(); ++i) {
+			cachePosition[cache[i]] = static_cast<int>(i);
+			vertexScore[cache[i]] = ForsythVertexScore(static_cast<int>(i), remaining[cache[i]]);
+		}
+		for (size_t i = 0; i < nextCache.size(); ++i) {
+			uint32_t v = nextCache[i];
+			if (cachePosition[v] < 0)
+				vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+		}
+
+		float bestScore = -1.0f;
+		for (uint32_t v : cache) {
+			for (uint32_t i = 0; i < remaining[v]; ++i) {
+				uint32_t t = vertexTriangles[offsets[v] + i];
+				float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				triangleScore[t] = score;
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		//Nothing left next to the cache: continue with the next unemitted triangle
+		if (bestScore < 0.0f && output.size() < indices.size()) {
+			while (emitted[scanCursor])
+				++scanCursor;
+			bestTriangle = scanCursor;
+		}
+	}
+
+	indices.swap(output);
+}
+
+float UComputeAcmr(const vector<uint32_t>& indices, size_t cacheSize) {
+	if (indices.size() < 3)
+		return 0.0f;
+
+	vector<uint32_t> fifo(cacheSize, UINT32_MAX);
+	size_t head = 0;
+	size_t misses = 0;
+	for (uint32_t index : indices) {
+		if (find(fifo.begin(), fifo.end(), index) != fifo.end())
+			continue;
+		fifo[head] = index;
+		head = (head + 1) % cacheSize;
+		++misses;
+	}
+	return static_cast<float>(misses) / (indices.size() / 3);
+}
+
+MeshBuildStats UBuildIndexedMesh(MeshData& mesh, size_t sourceVertices) {
+	MeshBuildStats stats;
+	stats.sourceVertices = sourceVertices;
+
+	UWeldVertices(mesh);
+	stats.vertices = mesh.vertices.size();
+	stats.triangles = mesh.indices.size() / 3;
+	stats.sourceAcmr = stats.triangles > 0 ? static_cast<float>(sourceVertices) / stats.triangles : 0.0f;
+	stats.weldedAcmr = UComputeAcmr(mesh.indices);
+
+	UOptimizeVertexCache(mesh.indices, mesh.vertices.size());
+	stats.optimizedAcmr = UComputeAcmr(mesh.indices);
+
+	return stats;
+}
+
+void UEncodeCompactVertices(const MeshData& mesh, vector<CompactVertex>& vertices, glm::vec3& boundsMin, glm::vec3& boundsSize) {
+	boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax(0.0f);
+	if (!mesh.vertices.empty()) {
+		boundsMin = boundsMax = mesh.vertices[0].position;
+		for (const MeshVertex& vertex : mesh.vertices) {
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+	}
+
+	//Flat meshes get a unit size on their flat axis so the decode never divides by zero
+	boundsSize = boundsMax - boundsMin;
+	for (int axis = 0; axis < 3; ++axis) {
+		if (boundsSize[axis] <= 0.0f)
+			boundsSize[axis] = 1.0f;
+	}
+
+	vertices.resize(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+		const MeshVertex& source = mesh.vertices[i];
+		CompactVertex& vertex = vertices[i];
+
+		glm::vec3 unit = (source.position - boundsMin) / boundsSize;
+		for (int axis = 0; axis < 3; ++axis)
+			vertex.position[axis] = static_cast<uint16_t>(glm::clamp(floor(unit[axis] * 65535.0f + 0.5f), 0.0f, 65535.0f));
+		vertex.pad = 0;
+		vertex.normal = EncodeNormal(source.normal);
+		vertex.uv[0] = FloatToHalf(source.uv.x);
+		vertex.uv[1] = FloatToHalf(source.uv.y);
+	}
+}
+
+MeshVertex UDecodeCompactVertex(const CompactVertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsSize) {
+	MeshVertex decoded;
+	decoded.position = boundsMin + glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]) / 65535.0f * boundsSize;
+	decoded.normal = DecodeNormal(vertex.normal);
+	decoded.uv = glm::vec2(HalfToFloat(vertex.uv[0]), HalfToFloat(vertex.uv[1]));
+	return decoded;
+}
+
+VertexEncodingError UMeasureCompactError(const MeshData& mesh) {
+	vector<CompactVertex> compact;
+	glm::vec3 boundsMin, boundsSize;
+	UEncodeCompactVertices(mesh, compact, boundsMin, boundsSize);
+
+	VertexEncodingError error;
+	for (size_t i = 0; i < compact.size(); ++i) {
+		const MeshVertex& source = mesh.vertices[i];
+		MeshVertex decoded = UDecodeCompactVertex(compact[i], boundsMin, boundsSize);
+
+		error.position = max(error.position, glm::length(decoded.position - source.position));
+		error.uv = max(error.uv, max(fabs(decoded.uv.x - source.uv.x), fabs(decoded.uv.y - source.uv.y)));
+
+		float length = glm::length(source.normal);
+		if (length > 0.0f) {
+			float cosine = glm::clamp(glm::dot(decoded.normal, source.normal / length), -1.0f, 1.0f);
+			error.normalDegrees = max(error.normalDegrees, glm::degrees(acos(cosine)));
+		}
+	}
+	return error;
+}
+
+MeshBounds UComputeMeshBounds(const MeshData& mesh) {
+	MeshBounds bounds;
+	if (mesh.vertices.empty())
+		return bounds;
+
+	bounds.min = bounds.max = mesh.vertices[0].position;
+	for (const MeshVertex& vertex : mesh.vertices) {
+		bounds.min = glm::min(bounds.min, vertex.position);
+		bounds.max = glm::max(bounds.max, vertex.position);
+	}
+
+	bounds.center = (bounds.min + bounds.max) * 0.5f;
+	float radiusSq = 0.0f;
+	for (const MeshVertex& vertex : mesh.vertices) {
+		const glm::vec3 offset = vertex.position - bounds.center;
+		radiusSq = max(radiusSq, glm::dot(offset, offset));
+	}
+	bounds.radius = sqrt(radiusSq);
+	return bounds;
+}
+
+void USetVertexLayout(VertexFormat format) {
+	if (format == VERTEX_FORMAT_COMPACT) {
+		const GLsizei stride = sizeof(CompactVertex);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(CompactVertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(CompactVertex, normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactVertex, uv));
+	}
+	else {
+		const GLsizei stride = sizeof(MeshVertex);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MeshVertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MeshVertex, normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MeshVertex, uv));
+	}
+}
+
+void UUploadIndexedMesh(const MeshData& mesh, VertexFormat format, GLIndexedMesh& glMesh) {
+	glGenVertexArrays(1, &glMesh.vao);
+	glGenBuffers(1, &glMesh.vbo);
+	glGenBuffers(1, &glMesh.ibo);
+
+	glBindVertexArray(glMesh.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, glMesh.vbo);
+	glMesh.format = format;
+	glMesh.bounds = UComputeMeshBounds(mesh);
+
+	if (format == VERTEX_FORMAT_COMPACT) {
+		vector<CompactVertex> compact;
+		glm::vec3 boundsMin, boundsSize;
+		UEncodeCompactVertices(mesh, compact, boundsMin, boundsSize);
+		glBufferData(GL_ARRAY_BUFFER, compact.size() * sizeof(CompactVertex), compact.data(), GL_STATIC_DRAW);
+		glMesh.vertexBytes = sizeof(CompactVertex);
+		glMesh.dequantize = glm::translate(boundsMin) * glm::scale(boundsSize);
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(MeshVertex), mesh.vertices.data(), GL_STATIC_DRAW);
+		glMesh.vertexBytes = sizeof(MeshVertex);
+		glMesh.dequantize = glm::mat4(1.0f);
+	}
+	USetVertexLayout(format);
+
+	//The element buffer binding is VAO state, so it stays bound with the VAO
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glMesh.ibo);
+	glMesh.indexCount = static_cast<GLsizei>(mesh.indices.size());
+	if (mesh.vertices.size() <= 0xFFFF) {
+		vector<uint16_t> shortIndices(mesh.indices.begin(), mesh.indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+		glMesh.indexType = GL_UNSIGNED_SHORT;
+	}
+	else {
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(uint32_t), mesh.indices.data(), GL_STATIC_DRAW);
+		glMesh.indexType = GL_UNSIGNED_INT;
+	}
+
+	glBindVertexArray(0);
+}
+
+void UDestroyIndexedMesh(GLIndexedMesh& glMesh) {
+	glDeleteVertexArrays(1, &glMesh.vao);
+	glDeleteBuffers(1, &glMesh.vbo);
+	glDeleteBuffers(1, &glMesh.ibo);
+	glMesh = GLIndexedMesh();
+}
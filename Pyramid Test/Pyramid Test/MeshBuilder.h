@@ -0,0 +1,109 @@
+#ifndef MESH_BUILDER_H
+#define MESH_BUILDER_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+//Interleaved vertex, attribute locations 0 (position), 1 (normal) and 2 (texture coordinate)
+struct MeshVertex {
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 uv;
+};
+
+//Vertex layouts a mesh can be uploaded with
+enum VertexFormat {
+	VERTEX_FORMAT_FULL = 0,		//MeshVertex as is, 32 bytes
+	VERTEX_FORMAT_COMPACT = 1	//CompactVertex, 16 bytes
+};
+
+//Compact vertex. Positions are 16-bit unsigned normalized inside the mesh bounds, the normal is octahedral
+//encoded in x and y of a GL_INT_2_10_10_10_REV (z and w unused) and texture coordinates are half floats
+struct CompactVertex {
+	uint16_t position[3];
+	uint16_t pad;
+	uint32_t normal;
+	uint16_t uv[2];
+};
+
+//Largest difference between a mesh's vertices and their compact encoding
+struct VertexEncodingError {
+	float position = 0.0f;		//Object-space distance
+	float normalDegrees = 0.0f;
+	float uv = 0.0f;
+};
+
+//Indexed triangle list on the CPU
+struct MeshData {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+};
+
+//What welding and cache optimisation did to a mesh
+struct MeshBuildStats {
+	size_t sourceVertices = 0;	//Vertices the old non-indexed draw submitted
+	size_t vertices = 0;		//Unique vertices after welding
+	size_t triangles = 0;
+	float sourceAcmr = 0.0f;	//Vertex shader runs per triangle of the old draw (no reuse)
+	float weldedAcmr = 0.0f;	//Indexed, original triangle order
+	float optimizedAcmr = 0.0f;	//Indexed, after vertex cache optimisation
+};
+
+//Object-space bounds of a mesh: an axis-aligned box and a sphere around it
+struct MeshBounds {
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+	glm::vec3 center = glm::vec3(0.0f);		//Sphere centre, the middle of the box
+	float radius = 0.0f;					//Distance to the farthest vertex
+};
+
+//Uploaded mesh: one interleaved VBO, one index buffer, drawn as GL_TRIANGLES
+struct GLIndexedMesh {
+	GLuint vao = 0;
+	GLuint vbo = 0;
+	GLuint ibo = 0;
+	GLsizei indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_INT;		//GL_UNSIGNED_SHORT when every index fits
+	VertexFormat format = VERTEX_FORMAT_FULL;
+	GLsizei vertexBytes = 0;
+	//Takes decoded positions (0-1 inside the bounds) back to object space. Identity for full meshes,
+	//otherwise folded into the instance model matrix so the shader needs no extra work
+	glm::mat4 dequantize = glm::mat4(1.0f);
+	MeshBounds bounds;		//Object space, before any quantisation
+};
+
+//FIFO size used when simulating the post-transform cache for ACMR figures
+const size_t ACMR_CACHE_SIZE = 16;
+
+//Hand-written tables laid out position (3), texture coordinate (2), normal (3) per vertex, as GL_TRIANGLES
+MeshData UMeshFromInterleaved(const float* data, size_t floatCount);
+
+//Merges bit-identical vertices and drops triangles that became degenerate
+void UWeldVertices(MeshData& mesh);
+//Reorders triangles for the post-transform vertex cache (Tom Forsyth's linear-speed algorithm)
+void UOptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+//Average cache misses per triangle with a FIFO cache of cacheSize entries
+float UComputeAcmr(const std::vector<uint32_t>& indices, size_t cacheSize = ACMR_CACHE_SIZE);
+
+//Welds and cache-optimises a mesh built from sourceVertices non-indexed vertices
+MeshBuildStats UBuildIndexedMesh(MeshData& mesh, size_t sourceVertices);
+
+//Encodes every vertex in the compact layout; boundsMin/boundsSize receive the quantisation box
+void UEncodeCompactVertices(const MeshData& mesh, std::vector<CompactVertex>& vertices, glm::vec3& boundsMin, glm::vec3& boundsSize);
+MeshVertex UDecodeCompactVertex(const CompactVertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsSize);
+//Encodes and decodes the mesh and reports the worst error of each attribute
+VertexEncodingError UMeasureCompactError(const MeshData& mesh);
+
+MeshBounds UComputeMeshBounds(const MeshData& mesh);
+
+//Points attributes 0-2 of the bound VAO at the bound GL_ARRAY_BUFFER, interleaved in the given layout
+void USetVertexLayout(VertexFormat format);
+
+//Uploads into a new VAO with the attributes interleaved in one VBO and records the mesh bounds
+void UUploadIndexedMesh(const MeshData& mesh, VertexFormat format, GLIndexedMesh& glMesh);
+void UDestroyIndexedMesh(GLIndexedMesh& glMesh);
+
+#endif
@@ -0,0 +1,136 @@
+#include "MultiDraw.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+namespace {
+	//Index data of a mesh read back from its element buffer and widened to 32 bits
+	void ReadIndices(const GLIndexedMesh& mesh, vector<uint32_t>& indices) {
+		glBindBuffer(GL_COPY_READ_BUFFER, mesh.ibo);
+		indices.resize(mesh.indexCount);
+		if (mesh.indexType == GL_UNSIGNED_SHORT) {
+			vector<uint16_t> shortIndices(mesh.indexCount);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, shortIndices.size() * sizeof(uint16_t), shortIndices.data());
+			copy(shortIndices.begin(), shortIndices.end(), indices.begin());
+		}
+		else {
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, indices.size() * sizeof(uint32_t), indices.data());
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+
+	size_t VertexCount(const GLIndexedMesh& mesh) {
+		GLint bytes = 0;
+		glBindBuffer(GL_COPY_READ_BUFFER, mesh.vbo);
+		glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &bytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		return static_cast<size_t>(bytes) / mesh.vertexBytes;
+	}
+}
+
+void UCreateMeshPool(const vector<GLIndexedMesh>& meshes, GLMeshPool& pool) {
+	pool = GLMeshPool();
+
+	//First pass places every mesh so each group's buffers can be allocated once
+	vector<size_t> vertexCounts(meshes.size());
+	for (size_t i = 0; i < meshes.size(); ++i) {
+		const GLIndexedMesh& mesh = meshes[i];
+		GLMeshPoolGroup& group = pool.groups[mesh.format];
+		vertexCounts[i] = VertexCount(mesh);
+
+		MeshPoolRange range;
+		range.format = mesh.format;
+		range.firstIndex = static_cast<GLuint>(group.indices);
+		range.baseVertex = static_cast<GLint>(group.vertices);
+		range.indexCount = static_cast<GLuint>(mesh.indexCount);
+		pool.ranges.push_back(range);
+
+		group.vertices += vertexCounts[i];
+		group.indices += mesh.indexCount;
+	}
+
+	vector<uint32_t> indices[2];
+	for (int format = 0; format < 2; ++format) {
+		GLMeshPoolGroup& group = pool.groups[format];
+		if (group.vertices == 0)
+			continue;
+
+		const GLsizei stride = format == VERTEX_FORMAT_COMPACT ? sizeof(CompactVertex) : sizeof(MeshVertex);
+		glGenBuffers(1, &group.vbo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, group.vbo);
+		glBufferData(GL_COPY_WRITE_BUFFER, group.vertices * stride, NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		indices[format].reserve(group.indices);
+	}
+
+	//Vertices never leave the GPU. Indices stay relative to their mesh, the commands' base vertex offsets them
+	vector<uint32_t> meshIndices;
+	for (size_t i = 0; i < meshes.size(); ++i) {
+		const GLIndexedMesh& mesh = meshes[i];
+		const MeshPoolRange& range = pool.ranges[i];
+		glBindBuffer(GL_COPY_READ_BUFFER, mesh.vbo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, pool.groups[mesh.format].vbo);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, static_cast<GLintptr>(range.baseVertex) * mesh.vertexBytes,
+			vertexCounts[i] * mesh.vertexBytes);
+
+		ReadIndices(mesh, meshIndices);
+		indices[mesh.format].insert(indices[mesh.format].end(), meshIndices.begin(), meshIndices.end());
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	for (int format = 0; format < 2; ++format) {
+		GLMeshPoolGroup& group = pool.groups[format];
+		if (group.vertices == 0)
+			continue;
+
+		glGenVertexArrays(1, &group.vao);
+		glGenBuffers(1, &group.ibo);
+		glBindVertexArray(group.vao);
+		glBindBuffer(GL_ARRAY_BUFFER, group.vbo);
+		USetVertexLayout(static_cast<VertexFormat>(format));
+
+		//The element buffer binding is VAO state, so it stays bound with the VAO
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, group.ibo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices[format].size() * sizeof(uint32_t), indices[format].data(), GL_STATIC_DRAW);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	glGenBuffers(1, &pool.indirectBuffer);
+}
+
+void UDestroyMeshPool(GLMeshPool& pool) {
+	for (GLMeshPoolGroup& group : pool.groups) {
+		glDeleteVertexArrays(1, &group.vao);
+		glDeleteBuffers(1, &group.vbo);
+		glDeleteBuffers(1, &group.ibo);
+	}
+	glDeleteBuffers(1, &pool.indirectBuffer);
+	pool = GLMeshPool();
+}
+
+DrawElementsIndirectCommand UMakeIndirectCommand(const GLMeshPool& pool, int mesh, GLuint instanceCount, GLuint baseInstance) {
+	const MeshPoolRange& range = pool.ranges[mesh];
+	DrawElementsIndirectCommand command;
+	command.count = range.indexCount;
+	command.instanceCount = instanceCount;
+	command.firstIndex = range.firstIndex;
+	command.baseVertex = range.baseVertex;
+	command.baseInstance = baseInstance;
+	return command;
+}
+
+void UUploadIndirectCommands(GLMeshPool& pool, const vector<DrawElementsIndirectCommand>& commands) {
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pool.indirectBuffer);
+	if (commands.empty())
+		return;
+
+	if (commands.size() > pool.indirectCapacity)
+		pool.indirectCapacity = max(commands.size(), pool.indirectCapacity * 2);
+
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, pool.indirectCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+}
@@ -0,0 +1,66 @@
+#ifndef MULTI_DRAW_H
+#define MULTI_DRAW_H
+
+#include <GL/glew.h>
+
+#include <vector>
+
+#include "MeshBuilder.h"
+
+//Command layout glMultiDrawElementsIndirect reads from the bound GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+	GLuint count = 0;
+	GLuint instanceCount = 0;
+	GLuint firstIndex = 0;
+	GLint baseVertex = 0;
+	GLuint baseInstance = 0;
+};
+
+//Where a mesh ended up inside its format's shared buffers
+struct MeshPoolRange {
+	VertexFormat format = VERTEX_FORMAT_FULL;
+	GLuint firstIndex = 0;
+	GLint baseVertex = 0;
+	GLuint indexCount = 0;
+};
+
+//Run of consecutive indirect commands drawn with one program from one vertex format's group, a single
+//glMultiDrawElementsIndirect
+struct MultiDrawGroup {
+	int program = 0;
+	VertexFormat format = VERTEX_FORMAT_FULL;
+	size_t firstCommand = 0;
+	size_t commandCount = 0;
+};
+
+//Shared vertex and 32-bit index buffers of every mesh with one vertex layout, behind one VAO
+struct GLMeshPoolGroup {
+	GLuint vao = 0;
+	GLuint vbo = 0;
+	GLuint ibo = 0;
+	size_t vertices = 0;
+	size_t indices = 0;
+};
+
+//Every mesh packed into one group per vertex format, so a frame's batches become indirect commands drawn with one
+//glMultiDrawElementsIndirect per format instead of a bind and draw per mesh
+struct GLMeshPool {
+	GLMeshPoolGroup groups[2];			//Indexed by VertexFormat
+	std::vector<MeshPoolRange> ranges;	//Indexed like the meshes the pool was built from
+	GLuint indirectBuffer = 0;
+	size_t indirectCapacity = 0;		//In commands
+};
+
+//Copies the meshes' vertices into the pool on the GPU and rebases their indices to 32 bits. The meshes are left
+//alone; the instanced path still draws them
+void UCreateMeshPool(const std::vector<GLIndexedMesh>& meshes, GLMeshPool& pool);
+void UDestroyMeshPool(GLMeshPool& pool);
+
+//Indirect command drawing instanceCount instances of a mesh from the pool, starting at baseInstance
+DrawElementsIndirectCommand UMakeIndirectCommand(const GLMeshPool& pool, int mesh, GLuint instanceCount, GLuint baseInstance);
+
+//Replaces the indirect buffer contents for this frame, orphaning the old storage, and leaves it bound to
+//GL_DRAW_INDIRECT_BUFFER
+void UUploadIndirectCommands(GLMeshPool& pool, const std::vector<DrawElementsIndirectCommand>& commands);
+
+#endif
@@ -0,0 +1,402 @@
+#include "Occlusion.h"
+
+#include "Instancing.h"
+#include "MultiDraw.h"
+#include "ShaderProgram.h"
+
+#include <algorithm>
+
+using namespace std;
+
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version " core \n" #Source
+#endif
+
+namespace {
+	const GLuint HIZ_TEXTURE_UNIT = 1;	//Unit 0 holds the scene's texture array
+
+	//One level of the pyramid per dispatch. Level 0 copies the depth texture; every other level keeps the farthest
+	//of the 2x2 texels under it, widened to 3 where the level above has an odd size so no texel is dropped
+	const GLchar* hiZShaderSource = GLSL(440,
+	layout(local_size_x = 8, local_size_y = 8) in;
+
+	layout(binding = 1) uniform sampler2D depthTexture;
+	layout(r32f, binding = 0) readonly uniform image2D source;
+	layout(r32f, binding = 1) writeonly uniform image2D destination;
+
+	uniform bool fromDepth;
+	uniform ivec2 sourceSize;
+	uniform ivec2 destinationSize;
+
+	void main()
+	{
+		ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+		if (p.x >= destinationSize.x || p.y >= destinationSize.y)
+			return;
+
+		if (fromDepth) {
+			imageStore(destination, p, vec4(texelFetch(depthTexture, p, 0).r));
+			return;
+		}
+
+		ivec2 first = p * 2;
+		ivec2 last = min(first + 1 + ivec2(equal(p, destinationSize - 1)) * (sourceSize & 1), sourceSize - 1);
+		float depth = 0.0f;
+		for (int y = first.y; y <= last.y; ++y)
+			for (int x = first.x; x <= last.x; ++x)
+				depth = max(depth, imageLoad(source, ivec2(x, y)).r);
+		imageStore(destination, p, vec4(depth));
+	}
+	);
+
+	//Tests candidates and compacts the visible ones into the commands' instance slices
+	const GLchar* cullShaderSource = GLSL(440,
+	layout(local_size_x = 64) in;
+
+	layout(std140, binding = 0) uniform FrameData
+	{
+		mat4 view;
+		mat4 projection;
+		vec3 viewPosition;
+		ivec4 clusterGrid;
+		vec2 clusterDepth;
+		int globalLightCount;
+	};
+
+	struct Instance
+	{
+		mat4 model;
+		vec4 normalMatrix[3];
+		uvec2 textureLayer;
+		vec2 uvScale;
+	};
+
+	struct Candidate
+	{
+		vec4 center;
+		vec4 extent;
+		uint item;
+		uint instance;
+		uint command;
+		uint pad;
+	};
+
+	// DrawElementsIndirectCommand
+	struct Command
+	{
+		uint count;
+		uint instanceCount;
+		uint firstIndex;
+		int baseVertex;
+		uint baseInstance;
+	};
+
+	layout(std430, binding = 5) readonly buffer SourceInstances
+	{
+		Instance sourceInstances[];
+	};
+
+	layout(std430, binding = 6) readonly buffer Candidates
+	{
+		Candidate candidates[];
+	};
+
+	layout(std430, binding = 7) buffer Commands
+	{
+		Command commands[];
+	};
+
+	layout(std430, binding = 8) writeonly buffer VisibleInstances
+	{
+		Instance visibleInstances[];
+	};
+
+	layout(std430, binding = 9) buffer History
+	{
+		uint history[];
+	};
+
+	layout(binding = 1) uniform sampler2D hiZ;
+
+	uniform int phase; // 0 draws what was visible last frame, 1 tests against the pyramid
+	uniform uint candidateCount;
+	uniform uint commandOffset;
+	uniform ivec2 viewportSize;
+	uniform int hiZLevels;
+
+	// True when the box is wholly behind the depth already drawn
+	bool Occluded(vec3 center, vec3 extent)
+	{
+		mat4 viewProjection = projection * view;
+		vec2 minUV = vec2(1.0f);
+		vec2 maxUV = vec2(0.0f);
+		float nearest = 1.0f;
+		for (int i = 0; i < 8; ++i) {
+			vec3 corner = center + extent * vec3((i & 1) != 0 ? 1.0f : -1.0f, (i & 2) != 0 ? 1.0f : -1.0f, (i & 4) != 0 ? 1.0f : -1.0f);
+			vec4 clip = viewProjection * vec4(corner, 1.0f);
+			// Reaching behind the camera: the projected rectangle is unbounded
+			if (clip.w <= 0.0f)
+				return false;
+			vec3 ndc = clip.xyz / clip.w;
+			minUV = min(minUV, ndc.xy * 0.5f + 0.5f);
+			maxUV = max(maxUV, ndc.xy * 0.5f + 0.5f);
+			nearest = min(nearest, ndc.z * 0.5f + 0.5f);
+		}
+		if (nearest <= 0.0f)
+			return false;
+
+		// The level where the rectangle spans at most 2x2 texels
+		minUV = clamp(minUV, 0.0f, 1.0f);
+		maxUV = clamp(maxUV, 0.0f, 1.0f);
+		vec2 size = (maxUV - minUV) * vec2(viewportSize);
+		int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0f)))), 0, hiZLevels - 1);
+		// Each level halves the one above, rounding down. Not textureSize: with a level that differs between invocations
+		// some drivers return another level's size, and the clamp below then moves the lookup off the rectangle
+		ivec2 levelSize = max(viewportSize >> level, ivec2(1));
+		ivec2 p0 = min(ivec2(minUV * vec2(viewportSize)) >> level, levelSize - 1);
+		ivec2 p1 = min(ivec2(maxUV * vec2(viewportSize)) >> level, levelSize - 1);
+		float farthest = max(max(texelFetch(hiZ, p0, level).r, texelFetch(hiZ, ivec2(p1.x, p0.y), level).r),
+			max(texelFetch(hiZ, ivec2(p0.x, p1.y), level).r, texelFetch(hiZ, p1, level).r));
+		return nearest > farthest;
+	}
+
+	void main()
+	{
+		uint i = gl_GlobalInvocationID.x;
+		if (i >= candidateCount)
+			return;
+
+		Candidate candidate = candidates[i];
+		bool draw;
+		if (phase == 0) {
+			draw = history[candidate.item] != 0u;
+		}
+		else {
+			bool visible = !Occluded(candidate.center.xyz, candidate.extent.xyz);
+			draw = visible && history[candidate.item] == 0u;
+			history[candidate.item] = visible ? 1u : 0u;
+		}
+		if (!draw)
+			return;
+
+		uint command = commandOffset + candidate.command;
+		uint slot = atomicAdd(commands[command].instanceCount, 1u);
+		visibleInstances[commands[command].baseInstance + slot] = sourceInstances[candidate.instance];
+	}
+	);
+
+	//Grows a shader storage buffer to hold at least bytes, discarding its contents
+	void ReserveBuffer(GLuint buffer, size_t& capacity, size_t required, size_t elementBytes) {
+		if (required <= capacity)
+			return;
+		capacity = max(required, capacity * 2);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * elementBytes, NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	//Depth copy and pyramid sized to the viewport, recreated when it changes
+	void ResizeTargets(GLOcclusionCuller& culler, int width, int height) {
+		if (width == culler.width && height == culler.height)
+			return;
+
+		glDeleteTextures(1, &culler.depthTexture);
+		glDeleteTextures(1, &culler.hiZTexture);
+		culler.width = width;
+		culler.height = height;
+		culler.levels = 1;
+		for (int size = max(width, height); size > 1; size /= 2)
+			++culler.levels;
+
+		glGenTextures(1, &culler.depthTexture);
+		glBindTexture(GL_TEXTURE_2D, culler.depthTexture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glGenTextures(1, &culler.hiZTexture);
+		glBindTexture(GL_TEXTURE_2D, culler.hiZTexture);
+		glTexStorage2D(GL_TEXTURE_2D, culler.levels, GL_R32F, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
+
+bool UCreateOcclusionCuller(GLOcclusionCuller& culler, size_t drawItems) {
+	culler = GLOcclusionCuller();
+	if (!UCreateComputeProgram(hiZShaderSource, culler.hiZProgram) || !UCreateComputeProgram(cullShaderSource, culler.cullProgram)) {
+		UDestroyOcclusionCuller(culler);
+		return false;
+	}
+
+	culler.hiZFromDepthLoc = glGetUniformLocation(culler.hiZProgram, "fromDepth");
+	culler.hiZSourceSizeLoc = glGetUniformLocation(culler.hiZProgram, "sourceSize");
+	culler.hiZDestinationSizeLoc = glGetUniformLocation(culler.hiZProgram, "destinationSize");
+	culler.phaseLoc = glGetUniformLocation(culler.cullProgram, "phase");
+	culler.candidateCountLoc = glGetUniformLocation(culler.cullProgram, "candidateCount");
+	culler.commandOffsetLoc = glGetUniformLocation(culler.cullProgram, "commandOffset");
+	culler.viewportSizeLoc = glGetUniformLocation(culler.cullProgram, "viewportSize");
+	culler.hiZLevelsLoc = glGetUniformLocation(culler.cullProgram, "hiZLevels");
+
+	glGenBuffers(1, &culler.candidateBuffer);
+	glGenBuffers(1, &culler.visibleBuffer);
+	glGenBuffers(1, &culler.historyBuffer);
+
+	//Nothing was visible before the first frame, so it all goes through the pass 2 test
+	culler.historyItems = max<size_t>(drawItems, 1);
+	vector<uint32_t> history(culler.historyItems, 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, culler.historyBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, history.size() * sizeof(uint32_t), history.data(), GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return true;
+}
+
+void UDestroyOcclusionCuller(GLOcclusionCuller& culler) {
+	glDeleteProgram(culler.hiZProgram);
+	glDeleteProgram(culler.cullProgram);
+	glDeleteTextures(1, &culler.depthTexture);
+	glDeleteTextures(1, &culler.hiZTexture);
+	glDeleteBuffers(1, &culler.candidateBuffer);
+	glDeleteBuffers(1, &culler.visibleBuffer);
+	glDeleteBuffers(1, &culler.historyBuffer);
+	for (GLsync fence : culler.readbackFences)
+		glDeleteSync(fence);
+	glDeleteBuffers(1, &culler.readbackBuffer);
+	culler = GLOcclusionCuller();
+}
+
+void UUploadOcclusionCandidates(GLOcclusionCuller& culler, const vector<OcclusionCandidate>& candidates, size_t instanceSlots) {
+	ReserveBuffer(culler.visibleBuffer, culler.visibleCapacity, max<size_t>(instanceSlots, 1), sizeof(InstanceData));
+	if (candidates.empty())
+		return;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, culler.candidateBuffer);
+	if (candidates.size() > culler.candidateCapacity)
+		culler.candidateCapacity = max(candidates.size(), culler.candidateCapacity * 2);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, culler.candidateCapacity * sizeof(OcclusionCandidate), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, candidates.size() * sizeof(OcclusionCandidate), candidates.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void URunOcclusionPass(GLOcclusionCuller& culler, int phase, size_t candidates, GLuint sourceInstances, GLuint indirectBuffer, size_t commandOffset) {
+	if (candidates > 0) {
+		glUseProgram(culler.cullProgram);
+		glUniform1i(culler.phaseLoc, phase);
+		glUniform1ui(culler.candidateCountLoc, static_cast<GLuint>(candidates));
+		glUniform1ui(culler.commandOffsetLoc, static_cast<GLuint>(commandOffset));
+		glUniform2i(culler.viewportSizeLoc, culler.width, culler.height);
+		glUniform1i(culler.hiZLevelsLoc, culler.levels);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_SOURCE_BINDING, sourceInstances);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_CANDIDATE_BINDING, culler.candidateBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_COMMAND_BINDING, indirectBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_VISIBLE_BINDING, culler.visibleBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OCCLUSION_HISTORY_BINDING, culler.historyBuffer);
+		glActiveTexture(GL_TEXTURE0 + HIZ_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, culler.hiZTexture);
+		glActiveTexture(GL_TEXTURE0);
+
+		glDispatchCompute(static_cast<GLuint>((candidates + 63) / 64), 1, 1);
+
+		//The draws read the counts as commands and the compacted instances as storage
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+		glUseProgram(0);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BUFFER_BINDING, culler.visibleBuffer);
+}
+
+void UBuildHiZ(GLOcclusionCuller& culler, int width, int height) {
+	ResizeTargets(culler, width, height);
+
+	glActiveTexture(GL_TEXTURE0 + HIZ_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, culler.depthTexture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+	glUseProgram(culler.hiZProgram);
+	int sourceWidth = width;
+	int sourceHeight = height;
+	for (int level = 0; level < culler.levels; ++level) {
+		const int levelWidth = level == 0 ? width : max(1, sourceWidth / 2);
+		const int levelHeight = level == 0 ? height : max(1, sourceHeight / 2);
+		glUniform1i(culler.hiZFromDepthLoc, level == 0);
+		glUniform2i(culler.hiZSourceSizeLoc, sourceWidth, sourceHeight);
+		glUniform2i(culler.hiZDestinationSizeLoc, levelWidth, levelHeight);
+		if (level > 0)
+			glBindImageTexture(0, culler.hiZTexture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glBindImageTexture(1, culler.hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((levelWidth + 7) / 8, (levelHeight + 7) / 8, 1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		sourceWidth = levelWidth;
+		sourceHeight = levelHeight;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glUseProgram(0);
+}
+
+void UQueueOcclusionReadback(GLOcclusionCuller& culler, GLuint indirectBuffer, size_t commandCount, size_t tested) {
+	const int slot = culler.readbackNext;
+	if (culler.readbackFences[slot])
+		return;
+
+	//Immutable storage can't grow, so a bigger frame replaces the buffer and whatever was still in flight in it
+	if (commandCount > culler.readbackCapacity) {
+		for (GLsync& fence : culler.readbackFences) {
+			glDeleteSync(fence);
+			fence = 0;
+		}
+		glDeleteBuffers(1, &culler.readbackBuffer);
+		culler.readbackCapacity = max(commandCount, culler.readbackCapacity * 2);
+		const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		const GLsizeiptr size = OCCLUSION_READBACK_FRAMES * culler.readbackCapacity * sizeof(DrawElementsIndirectCommand);
+		glGenBuffers(1, &culler.readbackBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, culler.readbackBuffer);
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+		culler.readbackCommands = static_cast<const DrawElementsIndirectCommand*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+	}
+
+	//The culling passes wrote the counts from a compute shader
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_COPY_READ_BUFFER, indirectBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, culler.readbackBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, slot * culler.readbackCapacity * sizeof(DrawElementsIndirectCommand),
+		commandCount * sizeof(DrawElementsIndirectCommand));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	culler.readbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	culler.readbackCount[slot] = commandCount;
+	culler.readbackTested[slot] = tested;
+	culler.readbackNext = (slot + 1) % OCCLUSION_READBACK_FRAMES;
+}
+
+bool UTakeOcclusionReadback(GLOcclusionCuller& culler, OcclusionCounts& counts) {
+	//Slots finish in the order they were queued, oldest first from the next one to be written
+	bool found = false;
+	for (int i = 0; i < OCCLUSION_READBACK_FRAMES; ++i) {
+		const int slot = (culler.readbackNext + i) % OCCLUSION_READBACK_FRAMES;
+		GLsync& fence = culler.readbackFences[slot];
+		if (!fence)
+			continue;
+		const GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(fence);
+		fence = 0;
+
+		counts = OcclusionCounts();
+		counts.tested = culler.readbackTested[slot];
+		const DrawElementsIndirectCommand* commands = culler.readbackCommands + slot * culler.readbackCapacity;
+		for (size_t k = 0; k < culler.readbackCount[slot]; ++k) {
+			counts.instances += commands[k].instanceCount;
+			counts.vertices += static_cast<long long>(commands[k].count) * commands[k].instanceCount;
+			counts.triangles += static_cast<long long>(commands[k].count / 3) * commands[k].instanceCount;
+		}
+		found = true;
+	}
+	return found;
+}
@@ -0,0 +1,101 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "MultiDraw.h"
+//Shader storage binding points used by the occlusion compute pass (1-4 are the light and instance buffers)
+const GLuint OCCLUSION_SOURCE_BINDING = 5;		//Every frustum-visible instance, as uploaded
+const GLuint OCCLUSION_CANDIDATE_BINDING = 6;
+const GLuint OCCLUSION_COMMAND_BINDING = 7;		//The frame's indirect commands
+const GLuint OCCLUSION_VISIBLE_BINDING = 8;		//Instances that survived, compacted per command
+const GLuint OCCLUSION_HISTORY_BINDING = 9;		//Per draw item, 1 when it passed the last Hi-Z test
+
+//Frames of indirect commands that may be in flight between the draw and the CPU reading back what they drew
+const int OCCLUSION_READBACK_FRAMES = 3;
+
+//CPU mirror of one std430 Candidate: a frustum-visible instance with its world box, 48 bytes
+struct OcclusionCandidate {
+	glm::vec4 center;		//World box centre, w unused
+	glm::vec4 extent;		//World box half size, w unused
+	uint32_t item = 0;		//Draw item, indexes the visibility history
+	uint32_t instance = 0;	//Slot in the source instance buffer
+	uint32_t command = 0;	//Indirect command that draws it
+	uint32_t pad = 0;
+};
+
+//What one frame's indirect commands drew, out of how many candidates
+struct OcclusionCounts {
+	long long instances = 0;
+	long long vertices = 0;
+	long long triangles = 0;
+	size_t tested = 0;
+};
+
+//Two-pass occlusion culling against a hierarchical depth buffer. Pass 1 draws what passed the Hi-Z test last
+//frame; its depth is reduced into a max-depth pyramid; pass 2 tests every candidate's box against the pyramid,
+//records the result for next frame and draws the visible ones pass 1 did not. A compute shader does the tests and
+//writes instance counts straight into the indirect commands, so hidden instances never reach the vertex shader
+struct GLOcclusionCuller {
+	GLuint hiZProgram = 0;
+	GLuint cullProgram = 0;
+	GLuint depthTexture = 0;	//Copy of the depth buffer after pass 1
+	GLuint hiZTexture = 0;		//R32F, each level the farthest depth of the texels under it
+	int width = 0;
+	int height = 0;
+	int levels = 0;
+
+	GLuint candidateBuffer = 0;
+	GLuint visibleBuffer = 0;
+	GLuint historyBuffer = 0;
+	size_t candidateCapacity = 0;
+	size_t visibleCapacity = 0;		//In instances
+	size_t historyItems = 0;
+
+	GLint hiZFromDepthLoc = -1;
+	GLint hiZSourceSizeLoc = -1;
+	GLint hiZDestinationSizeLoc = -1;
+	GLint phaseLoc = -1;
+	GLint candidateCountLoc = -1;
+	GLint commandOffsetLoc = -1;
+	GLint viewportSizeLoc = -1;
+	GLint hiZLevelsLoc = -1;
+
+	//Ring of copies of the indirect commands in one persistently mapped buffer, each slot behind a fence, so the CPU
+	//reads a frame's counts once the GPU has finished with them instead of waiting on the live buffer
+	GLuint readbackBuffer = 0;
+	const DrawElementsIndirectCommand* readbackCommands = nullptr;
+	size_t readbackCapacity = 0;	//In commands per slot
+	GLsync readbackFences[OCCLUSION_READBACK_FRAMES] = {};
+	size_t readbackCount[OCCLUSION_READBACK_FRAMES] = {};
+	size_t readbackTested[OCCLUSION_READBACK_FRAMES] = {};
+	int readbackNext = 0;
+};
+
+bool UCreateOcclusionCuller(GLOcclusionCuller& culler, size_t drawItems);
+void UDestroyOcclusionCuller(GLOcclusionCuller& culler);
+
+//Uploads this frame's candidates and sizes the compacted instance buffer for instanceSlots instances
+void UUploadOcclusionCandidates(GLOcclusionCuller& culler, const std::vector<OcclusionCandidate>& candidates, size_t instanceSlots);
+
+//Runs one culling pass over the uploaded candidates (phase 0 or 1), copying survivors out of sourceInstances and
+//adding them to the instance counts of the commands starting at commandOffset in indirectBuffer. Leaves the
+//compacted instances bound where the scene shaders read instances and the scene program unbound
+void URunOcclusionPass(GLOcclusionCuller& culler, int phase, size_t candidates, GLuint sourceInstances, GLuint indirectBuffer, size_t commandOffset);
+
+//Copies the bound read framebuffer's depth and reduces it into the Hi-Z pyramid
+void UBuildHiZ(GLOcclusionCuller& culler, int width, int height);
+
+//Copies the first commandCount commands of indirectBuffer into the next readback slot once the GPU has written them,
+//with the number of candidates tested. Drops the frame rather than waiting when every slot is still in flight
+void UQueueOcclusionReadback(GLOcclusionCuller& culler, GLuint indirectBuffer, size_t commandCount, size_t tested);
+
+//Counts of the newest queued frame the GPU has finished with, usually a couple of frames old. Never waits; false
+//when no frame has finished since the last call
+bool UTakeOcclusionReadback(GLOcclusionCuller& culler, OcclusionCounts& counts);
+
+#endif
@@ -0,0 +1,302 @@
+#include "Primitives.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+using namespace std;
+
+namespace {
+	//cos/sin of 2 * pi * i / segments for i in [0, segments]; the last entry repeats the first exactly so seams
+	//close without cracks. Tables are shared by every primitive with the same segment count
+	const vector<glm::vec2>& UnitCircle(int segments) {
+		static map<int, vector<glm::vec2>> tables;
+
+		vector<glm::vec2>& table = tables[segments];
+		if (table.empty()) {
+			table.resize(segments + 1);
+			for (int i = 0; i < segments; ++i) {
+				double theta = 2.0 * 3.14159265358979323846 * i / segments;
+				table[i] = glm::vec2(static_cast<float>(cos(theta)), static_cast<float>(sin(theta)));
+			}
+			table[segments] = table[0];
+		}
+		return table;
+	}
+
+	//Parameters clamped to what each shape can be built from
+	PrimitiveDesc Sanitized(PrimitiveDesc desc) {
+		desc.segments = max(desc.segments, 3);
+		desc.rings = max(desc.rings, desc.shape == PRIMITIVE_SPHERE ? 2 : desc.shape == PRIMITIVE_TORUS ? 3 : 1);
+		return desc;
+	}
+
+	//Writes straight into the preallocated vertex and index arrays
+	struct MeshWriter {
+		MeshData& mesh;
+		size_t vertexCount = 0;
+		size_t indexCount = 0;
+
+		explicit MeshWriter(MeshData& target) : mesh(target) {}
+
+		uint32_t Vertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv) {
+			MeshVertex& vertex = mesh.vertices[vertexCount];
+			vertex.position = position;
+			vertex.normal = normal;
+			vertex.uv = uv;
+			return static_cast<uint32_t>(vertexCount++);
+		}
+
+		void Triangle(uint32_t a, uint32_t b, uint32_t c) {
+			mesh.indices[indexCount++] = a;
+			mesh.indices[indexCount++] = b;
+			mesh.indices[indexCount++] = c;
+		}
+
+		//Two triangles per quad of a grid of (columns + 1) * (rows + 1) vertices starting at base, row by row.
+		//Rows run from +y down and columns around +y from +x towards +z, which makes (a, b, c) face outwards.
+		//A first or last row that collapses to a point (cone apex, sphere poles) only gets its non-degenerate half
+		void Grid(uint32_t base, int columns, int rows, bool collapsedFirstRow, bool collapsedLastRow) {
+			const uint32_t stride = columns + 1;
+			for (int row = 0; row < rows; ++row) {
+				for (int column = 0; column < columns; ++column) {
+					uint32_t a = base + row * stride + column;
+					uint32_t b = a + 1;
+					uint32_t c = a + stride;
+					uint32_t d = c + 1;
+					if (!(collapsedFirstRow && row == 0))
+						Triangle(a, b, c);
+					if (!(collapsedLastRow && row == rows - 1))
+						Triangle(b, d, c);
+				}
+			}
+		}
+
+		//Flat circle at height y. Texture coordinates are planar and read the right way round from the side the
+		//cap faces, with the top of the image towards -z
+		void Cap(const vector<glm::vec2>& circle, int segments, float radius, float y, bool facingUp) {
+			const glm::vec3 normal(0.0f, facingUp ? 1.0f : -1.0f, 0.0f);
+			const float flipV = facingUp ? -0.5f : 0.5f;
+			const uint32_t center = Vertex(glm::vec3(0.0f, y, 0.0f), normal, glm::vec2(0.5f));
+			for (int i = 0; i < segments; ++i)
+				Vertex(glm::vec3(radius * circle[i].x, y, radius * circle[i].y), normal, glm::vec2(0.5f + 0.5f * circle[i].x, 0.5f + flipV * circle[i].y));
+
+			for (int i = 0; i < segments; ++i) {
+				uint32_t rim = center + 1 + i;
+				uint32_t next = center + 1 + (i + 1) % segments;
+				if (facingUp)
+					Triangle(center, next, rim);
+				else
+					Triangle(center, rim, next);
+			}
+		}
+
+		//Quad centred on center spanning +-u and +-v; u x v is the face normal
+		void Quad(const glm::vec3& center, const glm::vec3& u, const glm::vec3& v) {
+			const glm::vec3 normal = glm::normalize(glm::cross(u, v));
+			uint32_t first = Vertex(center - u - v, normal, glm::vec2(0.0f, 0.0f));
+			Vertex(center + u - v, normal, glm::vec2(1.0f, 0.0f));
+			Vertex(center + u + v, normal, glm::vec2(1.0f, 1.0f));
+			Vertex(center - u + v, normal, glm::vec2(0.0f, 1.0f));
+			Triangle(first, first + 1, first + 2);
+			Triangle(first, first + 2, first + 3);
+		}
+	};
+
+	void GenerateCylinder(const PrimitiveDesc& desc, MeshWriter& writer) {
+		const vector<glm::vec2>& circle = UnitCircle(desc.segments);
+		const float radius = desc.size.x;
+		const float height = desc.size.y;
+
+		for (int ring = 0; ring <= desc.rings; ++ring) {
+			float v = static_cast<float>(ring) / desc.rings;
+			float y = height * (0.5f - v);
+			for (int i = 0; i <= desc.segments; ++i) {
+				glm::vec3 normal(circle[i].x, 0.0f, circle[i].y);
+				writer.Vertex(glm::vec3(radius * normal.x, y, radius * normal.z), normal, glm::vec2(static_cast<float>(i) / desc.segments, v));
+			}
+		}
+		writer.Grid(0, desc.segments, desc.rings, false, false);
+
+		if (desc.capped) {
+			writer.Cap(circle, desc.segments, radius, height * 0.5f, true);
+			writer.Cap(circle, desc.segments, radius, -height * 0.5f, false);
+		}
+	}
+
+	void GenerateCone(const PrimitiveDesc& desc, MeshWriter& writer) {
+		const vector<glm::vec2>& circle = UnitCircle(desc.segments);
+		const float radius = desc.size.x;
+		const float height = desc.size.y;
+
+		//Rings widen from the apex down to the base; the slant normal is the same along each column
+		for (int ring = 0; ring <= desc.rings; ++ring) {
+			float v = static_cast<float>(ring) / desc.rings;
+			float y = height * (0.5f - v);
+			for (int i = 0; i <= desc.segments; ++i) {
+				glm::vec3 normal = glm::normalize(glm::vec3(height * circle[i].x, radius, height * circle[i].y));
+				writer.Vertex(glm::vec3(radius * v * circle[i].x, y, radius * v * circle[i].y), normal, glm::vec2(static_cast<float>(i) / desc.segments, v));
+			}
+		}
+		writer.Grid(0, desc.segments, desc.rings, true, false);
+
+		if (desc.capped)
+			writer.Cap(circle, desc.segments, radius, -height * 0.5f, false);
+	}
+
+	void GenerateBox(const PrimitiveDesc& desc, MeshWriter& writer) {
+		const glm::vec3 half = desc.size * 0.5f;
+		const glm::vec3 x(half.x, 0.0f, 0.0f);
+		const glm::vec3 y(0.0f, half.y, 0.0f);
+		const glm::vec3 z(0.0f, 0.0f, half.z);
+
+		writer.Quad(x, -z, y);
+		writer.Quad(-x, z, y);
+		writer.Quad(y, x, -z);
+		writer.Quad(-y, x, z);
+		writer.Quad(z, x, y);
+		writer.Quad(-z, -x, y);
+	}
+
+	void GeneratePyramid(const PrimitiveDesc& desc, MeshWriter& writer) {
+		const glm::vec3 half = desc.size * 0.5f;
+		const glm::vec3 apex(0.0f, half.y, 0.0f);
+		//Base corners counter-clockwise seen from above
+		const glm::vec3 corners[4] = {
+			glm::vec3(-half.x, -half.y, half.z), glm::vec3(half.x, -half.y, half.z),
+			glm::vec3(half.x, -half.y, -half.z), glm::vec3(-half.x, -half.y, -half.z)
+		};
+
+		for (int side = 0; side < 4; ++side) {
+			const glm::vec3& left = corners[side];
+			const glm::vec3& right = corners[(side + 1) % 4];
+			glm::vec3 normal = glm::normalize(glm::cross(right - left, apex - left));
+			uint32_t first = writer.Vertex(left, normal, glm::vec2(0.0f, 0.0f));
+			writer.Vertex(right, normal, glm::vec2(1.0f, 0.0f));
+			writer.Vertex(apex, normal, glm::vec2(0.5f, 1.0f));
+			writer.Triangle(first, first + 1, first + 2);
+		}
+
+		writer.Quad(glm::vec3(0.0f, -half.y, 0.0f), glm::vec3(half.x, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, half.z));
+	}
+
+	void GenerateSphere(const PrimitiveDesc& desc, MeshWriter& writer) {
+		const vector<glm::vec2>& circle = UnitCircle(desc.segments);
+		//Every other entry of the table with twice the rings walks pole to pole in half a turn
+		const vector<glm::vec2>& latitude = UnitCircle(desc.rings * 2);
+		const float radius = desc.size.x;
+
+		for (int ring = 0; ring <= desc.rings; ++ring) {
+			float y = latitude[ring].x;
+			float ringRadius = latitude[ring].y;
+			for (int i = 0; i <= desc.segments; ++i) {
+				glm::vec3 normal(ringRadius * circle[i].x, y, ringRadius * circle[i].y);
+				writer.Vertex(radius * normal, normal, glm::vec2(static_cast<float>(i) / desc.segments, static_cast<float>(ring) / desc.rings));
+			}
+		}
+		writer.Grid(0, desc.segments, desc.rings, true, true);
+	}
+
+	void GenerateTorus(const PrimitiveDesc& desc, MeshWriter& writer) {
+		const vector<glm::vec2>& circle = UnitCircle(desc.segments);
+		const vector<glm::vec2>& tube = UnitCircle(desc.rings);
+		const float ringRadius = desc.size.x;
+		const float tubeRadius = desc.size.y;
+
+		//The tube is walked downwards on its outer side so the grid keeps facing out
+		for (int ring = 0; ring <= desc.rings; ++ring) {
+			for (int i = 0; i <= desc.segments; ++i) {
+				glm::vec3 normal(tube[ring].x * circle[i].x, -tube[ring].y, tube[ring].x * circle[i].y);
+				glm::vec3 center(ringRadius * circle[i].x, 0.0f, ringRadius * circle[i].y);
+				writer.Vertex(center + tubeRadius * normal, normal, glm::vec2(static_cast<float>(i) / desc.segments, static_cast<float>(ring) / desc.rings));
+			}
+		}
+		writer.Grid(0, desc.segments, desc.rings, false, false);
+	}
+}
+
+bool PrimitiveDesc::operator<(const PrimitiveDesc& other) const {
+	return tie(shape, size.x, size.y, size.z, segments, rings, capped)
+		< tie(other.shape, other.size.x, other.size.y, other.size.z, other.segments, other.rings, other.capped);
+}
+
+void UPrimitiveCounts(const PrimitiveDesc& source, size_t& vertexCount, size_t& indexCount) {
+	const PrimitiveDesc desc = Sanitized(source);
+	const size_t segments = desc.segments;
+	const size_t rings = desc.rings;
+	const size_t grid = (segments + 1) * (rings + 1);
+
+	switch (desc.shape) {
+	case PRIMITIVE_CYLINDER:
+		vertexCount = grid + (desc.capped ? 2 * (segments + 1) : 0);
+		indexCount = 6 * segments * rings + (desc.capped ? 6 * segments : 0);
+		break;
+	case PRIMITIVE_DISC:
+		vertexCount = segments + 1;
+		indexCount = 3 * segments;
+		break;
+	case PRIMITIVE_CONE:
+		vertexCount = grid + (desc.capped ? segments + 1 : 0);
+		indexCount = segments * (6 * rings - 3) + (desc.capped ? 3 * segments : 0);
+		break;
+	case PRIMITIVE_BOX:
+		vertexCount = 24;
+		indexCount = 36;
+		break;
+	case PRIMITIVE_PYRAMID:
+		vertexCount = 16;
+		indexCount = 18;
+		break;
+	case PRIMITIVE_SPHERE:
+		vertexCount = grid;
+		indexCount = segments * (6 * rings - 6);
+		break;
+	case PRIMITIVE_TORUS:
+		vertexCount = grid;
+		indexCount = 6 * segments * rings;
+		break;
+	default:
+		vertexCount = 0;
+		indexCount = 0;
+		break;
+	}
+}
+
+MeshData UGeneratePrimitive(const PrimitiveDesc& source) {
+	const PrimitiveDesc desc = Sanitized(source);
+
+	size_t vertexCount, indexCount;
+	UPrimitiveCounts(desc, vertexCount, indexCount);
+
+	MeshData mesh;
+	mesh.vertices.resize(vertexCount);
+	mesh.indices.resize(indexCount);
+
+	MeshWriter writer(mesh);
+	switch (desc.shape) {
+	case PRIMITIVE_CYLINDER:
+		GenerateCylinder(desc, writer);
+		break;
+	case PRIMITIVE_DISC:
+		writer.Cap(UnitCircle(desc.segments), desc.segments, desc.size.x, 0.0f, true);
+		break;
+	case PRIMITIVE_CONE:
+		GenerateCone(desc, writer);
+		break;
+	case PRIMITIVE_BOX:
+		GenerateBox(desc, writer);
+		break;
+	case PRIMITIVE_PYRAMID:
+		GeneratePyramid(desc, writer);
+		break;
+	case PRIMITIVE_SPHERE:
+		GenerateSphere(desc, writer);
+		break;
+	case PRIMITIVE_TORUS:
+		GenerateTorus(desc, writer);
+		break;
+	}
+
+	return mesh;
+}
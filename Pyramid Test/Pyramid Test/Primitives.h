@@ -0,0 +1,42 @@
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+#include <glm/glm.hpp>
+
+#include "MeshBuilder.h"
+
+enum PrimitiveShape {
+	PRIMITIVE_CYLINDER = 0,
+	PRIMITIVE_DISC,
+	PRIMITIVE_CONE,
+	PRIMITIVE_BOX,
+	PRIMITIVE_PYRAMID,
+	PRIMITIVE_SPHERE,
+	PRIMITIVE_TORUS
+};
+
+//Shape and parameters of a generated mesh, also the key of the primitive cache. Every shape is centred
+//on the origin with its axis along +Y; what size means depends on the shape:
+//  cylinder, cone  x radius, y height
+//  disc, sphere    x radius
+//  box, pyramid    x, y, z extents (pyramid apex at +y)
+//  torus           x ring radius, y tube radius
+//segments divide the circumference; rings divide the height (cylinder, cone), latitude (sphere) or tube (torus).
+//capped closes the ends of cylinders and the base of cones
+struct PrimitiveDesc {
+	PrimitiveShape shape = PRIMITIVE_BOX;
+	glm::vec3 size = glm::vec3(1.0f);
+	int segments = 20;
+	int rings = 1;
+	bool capped = false;
+
+	bool operator<(const PrimitiveDesc& other) const;
+};
+
+//Vertex and index counts a description produces, known before anything is generated
+void UPrimitiveCounts(const PrimitiveDesc& desc, size_t& vertexCount, size_t& indexCount);
+
+//Generates an indexed triangle list with outward facing, counter-clockwise triangles
+MeshData UGeneratePrimitive(const PrimitiveDesc& desc);
+
+#endif
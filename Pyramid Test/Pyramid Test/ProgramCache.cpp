@@ -0,0 +1,196 @@
+#include "ProgramCache.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+namespace {
+	const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	const uint64_t FNV_PRIME = 1099511628211ull;
+
+	bool gEnabled = false;
+	ProgramCacheMode gMode = PROGRAM_CACHE_OFF;
+	string gDirectory;
+	uint64_t gDriverKey = 0;
+	ProgramCacheStats gStats;
+
+	//FNV-1a over the bytes, continuing from hash
+	uint64_t Hash(uint64_t hash, const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	//The length goes in first so "ab" + "c" and "a" + "bc" differ
+	uint64_t HashString(uint64_t hash, const char* text) {
+		const uint64_t length = text ? strlen(text) : 0;
+		hash = Hash(hash, &length, sizeof(length));
+		return Hash(hash, text, static_cast<size_t>(length));
+	}
+
+	string EntryPath(uint64_t key) {
+		ostringstream path;
+		path << gDirectory << "/" << hex << setw(16) << setfill('0') << key << ".bin";
+		return path.str();
+	}
+
+	bool MakeDirectory(const string& directory) {
+#ifdef _WIN32
+		return _mkdir(directory.c_str()) == 0 || errno == EEXIST;
+#else
+		return mkdir(directory.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+	}
+
+	double MsSince(chrono::steady_clock::time_point start) {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+}
+
+bool UOpenProgramCache(const string& directory, ProgramCacheMode mode) {
+	gEnabled = false;
+	gMode = mode;
+	gDirectory = directory;
+	gStats = ProgramCacheStats();
+	if (mode == PROGRAM_CACHE_OFF)
+		return true;
+
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats <= 0) {
+		cout << "INFO: The driver offers no program binary formats, shaders compile every run" << endl;
+		return false;
+	}
+	if (!MakeDirectory(directory)) {
+		cout << "Failed to create the shader cache directory " << directory << endl;
+		return false;
+	}
+
+	//Any of these changing means the driver may no longer accept, or may misread, what it wrote before
+	const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION };
+	gDriverKey = FNV_OFFSET;
+	for (GLenum name : strings)
+		gDriverKey = HashString(gDriverKey, reinterpret_cast<const char*>(glGetString(name)));
+
+	gEnabled = true;
+	return true;
+}
+
+uint64_t UProgramCacheKey(const char* const* sources, int count) {
+	uint64_t key = HashString(gDriverKey, "program");
+	for (int i = 0; i < count; ++i)
+		key = HashString(key, sources[i]);
+	return key;
+}
+
+GLuint ULoadCachedProgram(uint64_t key) {
+	if (!gEnabled)
+		return 0;
+	if (gMode == PROGRAM_CACHE_REBUILD) {
+		++gStats.misses;
+		return 0;
+	}
+
+	const auto start = chrono::steady_clock::now();
+	const string path = EntryPath(key);
+	ifstream in(path, ios::binary);
+	if (!in) {
+		++gStats.misses;
+		return 0;
+	}
+
+	ProgramCacheHeader header;
+	vector<char> binary;
+	bool valid = in.read(reinterpret_cast<char*>(&header), sizeof(header)) && header.magic == PROGRAM_CACHE_MAGIC && header.key == key
+		&& header.binarySize > 0 && header.binarySize < (1u << 30);
+	if (valid) {
+		binary.resize(static_cast<size_t>(header.binarySize));
+		valid = static_cast<bool>(in.read(binary.data(), binary.size()));
+	}
+	in.close();
+
+	GLuint program = 0;
+	GLint linked = GL_FALSE;
+	if (valid) {
+		program = glCreateProgram();
+		glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	}
+	gStats.loadMs += MsSince(start);
+
+	if (!linked) {
+		//Left by another driver build or damaged; compile this time and write a fresh entry
+		cout << "INFO: Shader cache entry " << path << " was rejected, recompiling" << endl;
+		glDeleteProgram(program);
+		remove(path.c_str());
+		++gStats.rejected;
+		return 0;
+	}
+	++gStats.hits;
+	return program;
+}
+
+void UPrepareCachedProgram(GLuint program) {
+	if (gEnabled)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void UStoreCachedProgram(uint64_t key, GLuint program) {
+	if (!gEnabled)
+		return;
+
+	const auto start = chrono::steady_clock::now();
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	ProgramCacheHeader header;
+	header.key = key;
+	vector<char> binary(length);
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &written, &format, binary.data());
+	if (written <= 0)
+		return;
+	header.binaryFormat = format;
+	header.binarySize = static_cast<uint64_t>(written);
+
+	//Written under a temporary name and renamed, so a run that dies halfway never leaves a short entry behind
+	const string path = EntryPath(key);
+	const string temporary = path + ".tmp";
+	{
+		ofstream out(temporary, ios::binary | ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(binary.data(), written);
+		if (!out) {
+			cout << "Failed to write the shader cache entry " << temporary << endl;
+			return;
+		}
+	}
+	remove(path.c_str());
+	if (rename(temporary.c_str(), path.c_str()) != 0)
+		remove(temporary.c_str());
+	gStats.storeMs += MsSince(start);
+}
+
+const ProgramCacheStats& UProgramCacheStats() {
+	return gStats;
+}
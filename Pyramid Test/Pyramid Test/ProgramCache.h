@@ -0,0 +1,56 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+const uint32_t PROGRAM_CACHE_MAGIC = 0x31435050;	//"PPC1" read as a little endian word
+
+//A cache entry is this header followed by binarySize bytes from glGetProgramBinary
+struct ProgramCacheHeader {
+	uint32_t magic = PROGRAM_CACHE_MAGIC;
+	uint32_t binaryFormat = 0;
+	uint64_t key = 0;			//Repeated so a renamed or truncated file is caught before GL sees it
+	uint64_t binarySize = 0;
+};
+
+static_assert(sizeof(ProgramCacheHeader) == 24, "Program cache header layout is part of the file format");
+
+//How the cache is used: read and write entries, ignore existing entries and write fresh ones (a cold start), or
+//always compile
+enum ProgramCacheMode {
+	PROGRAM_CACHE_ON,
+	PROGRAM_CACHE_REBUILD,
+	PROGRAM_CACHE_OFF
+};
+
+//What the cache did this run
+struct ProgramCacheStats {
+	int hits = 0;
+	int misses = 0;
+	int rejected = 0;		//Entries that were present but the driver refused, recompiled and replaced
+	double loadMs = 0.0;	//Reading entries and handing them to glProgramBinary, hits and rejections
+	double storeMs = 0.0;	//Reading binaries back after linking and writing them out
+};
+
+//Linked programs are kept in directory, one file per program named by a hash of its shader sources and the
+//vendor, renderer, GL and GLSL version strings, so a driver update or a changed shader misses instead of loading a
+//stale binary. Needs a current context; stays off when the driver offers no binary formats
+bool UOpenProgramCache(const std::string& directory, ProgramCacheMode mode);
+
+//Key of a program built from count sources, in the order they are attached
+uint64_t UProgramCacheKey(const char* const* sources, int count);
+
+//Linked program loaded from the entry for key, or 0 on a miss or when the driver rejects the binary (the entry is
+//then deleted, and the program built from source replaces it)
+GLuint ULoadCachedProgram(uint64_t key);
+
+//Call before linking a program that will be stored, so the driver keeps its binary around
+void UPrepareCachedProgram(GLuint program);
+void UStoreCachedProgram(uint64_t key, GLuint program);
+
+const ProgramCacheStats& UProgramCacheStats();
+
+#endif
@@ -1,6 +1,15 @@
 #include <iostream>
+#include <fstream>
 #include <cstdlib>
 #include <cmath>
+#include <cstring>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <map>
+#include <functional>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
@@ -9,40 +18,152 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "camera.h"
+#include "Benchmark.h"
+#include "Bvh.h"
+#include "Culling.h"
+#include "FileWatcher.h"
+#include "Headless.h"
+#include "Instancing.h"
+#include "Lighting.h"
+#include "Lod.h"
+#include "MeshBuilder.h"
+#include "MultiDraw.h"
+#include "Occlusion.h"
+#include "Primitives.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
+#include "Scene.h"
+#include "Simulation.h"
+#include "TextureArray.h"
+#include "TextureLoader.h"
+#include "ShaderProgram.h"
+#include "ShaderVariants.h"
+#include "WorkerPool.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 using namespace std;
 
-#ifndef GLSL
-#define GLSL(Version, Source) "#version " #Version " core \n" #Source
-#endif
-
 namespace {
 	const char* const WINDOW_TITLE = "Pyramid Test";	//Window Title
 
 	const int WINDOW_HEIGHT = 600;
 	const int WINDOW_WIDTH = 800;
+	const float FAR_PLANE = 100.0f;
+	const char* const SHADER_DIRECTORY = "shaders";
+
+	//How long render-on-demand sleeps without events: long enough to use no CPU, short enough for the stats title
+	//and the shader watcher, and shorter while variants are still compiling
+	const double IDLE_WAIT_SECONDS = 0.5;
+	const double COMPILE_WAIT_SECONDS = 1.0 / 60.0;
+
+	//Reasons the next frame has to be drawn in render-on-demand mode
+	enum FrameDirty : unsigned {
+		FRAME_DIRTY_VIEW = 1 << 0,		//The simulation moved the camera or switched the projection
+		FRAME_DIRTY_ASSETS = 1 << 1,	//A shader variant finished building or was rebuilt from edited files
+		FRAME_DIRTY_RESIZE = 1 << 2		//The window was resized or needs repainting
+	};
+
+	//Process CPU time against wall time, split by whether frames were being drawn
+	struct CpuUsage {
+		double busyCpu = 0.0;
+		double busyWall = 0.0;
+		double idleCpu = 0.0;
+		double idleWall = 0.0;
+	};
 
 	struct GLMesh {
-		GLuint vao[10];
-		GLuint vbos[20];
-		GLuint nVertices[20];
+		vector<GLIndexedMesh> meshes;	//Indexed by the draw item's mesh
+		vector<int> meshOfName;		//MESH_NAMES index to meshes entry; names built from the same primitive share one
+		vector<MeshLodChain> lods;	//Indexed like meshes: the entries drawing a round primitive at each level of detail
 };
+
+	//Entry of the primitive mesh table
+	struct PrimitiveMesh {
+		PrimitiveDesc desc;
+		bool lod;		//Also built at every level of detail when the shape is round
+	};
+
+	//Names scene files use for the GLMesh entries, in order
+	const vector<string> MESH_NAMES = {
+		"pyramid", "cube", "plane", "box", "bottleBody", "bottleTop", "bottleBottom", "capBody", "capTop", "watchHand", "denseCylinder",
+		"cylinder", "disc", "cone", "cuboid", "squarePyramid", "sphere", "torus"
+	};
 	//Main GLFW window
 	GLFWwindow* gWindow = nullptr;
 	//Triangle mesh data
 	GLMesh gMesh;
-	//Shader program
-	GLuint gProgramId;
-	//Textures
-	GLuint houseTextureId;
-	GLuint floorTextureId;
-	GLuint tissueTextureId;
-	GLuint watchTextureId;
-	GLuint capTextureId;
-	GLuint watchFaceTextureId;
-	GLuint bottleTextureId;
+	//Scene shader variants: the generic one any draw can use, and per material and vertex layout the smallest one
+	//that draws it (indexed material * 2 + VertexFormat, -1 where no draw item needs it)
+	GLShaderVariants gShaderVariants;
+	int gGenericVariant = 0;
+	vector<int> gMaterialVariants;
+	bool gVariantsPending = true;		//Some variant is still compiling in the background
+	bool gShadersReloading = false;		//Variants rebuilding after their templates changed
+	FileWatcher gShaderWatcher;
+	GLFWwindow* gCompilerWindow = nullptr;	//Hidden window whose context the shader compile worker uses
+	int gShaderBuilds = 0;			//gShaderVariants.builds when the shaders were last checked
+	//InstanceData::texture of every material: texture layer or packed colour, and its flags
+	vector<glm::uvec2> gMaterialTextures;
+	//Per-frame uniform block shared by the scene shaders
+	GLFrameUniforms gFrameUniforms;
+	//Scene (textures, nodes and draw items)
+	Scene gScene;
+	//The scene's textures, packed one per layer
+	GLTextureArray gTextureArray;
+	string gScenePath = "scenes/desk.scene";
+
+	//Draws sorted by state each frame, and what submitting them cost
+	RenderQueue gRenderQueue;
+	RenderStats gRenderStats;
+
+	//Instanced submission: model matrices in sorted order and the batches that draw them
+	GLInstanceBuffer gInstanceBuffer;
+	vector<InstanceData> gInstances;
+	vector<DrawBatch> gBatches;
+
+	//Multi-draw-indirect submission (--multi-draw): every mesh in shared buffers, one indirect command per batch
+	GLMeshPool gMeshPool;
+	vector<DrawElementsIndirectCommand> gIndirectCommands;
+	vector<MultiDrawGroup> gDrawGroups;
+
+	//Hi-Z occlusion culling (--occlusion): the frustum-visible instances tested on the GPU, which fills in the
+	//indirect commands' instance counts. The commands are read back a few frames later to count what was hidden
+	GLOcclusionCuller gOcclusionCuller;
+	vector<OcclusionCandidate> gOcclusionCandidates;
+	OcclusionCounts gOcclusionDrawn;	//Newest frame read back from the indirect commands
+
+	//Draw items' world boxes and the hierarchy over them, both refit as nodes move, and the items inside the
+	//frustum this frame
+	CullingBounds gCullingBounds;
+	Bvh gBvh;
+	vector<uint32_t> gChangedItems;
+	vector<uint32_t> gVisibleItems;
+	//Level of detail each draw item was drawn at last frame (-1 before its first), and the GLMesh entry it draws
+	//with this frame
+	vector<int> gLodLevels;
+	vector<int> gDrawMeshes;
+	//Matrices of the last frame, for picking
+	glm::mat4 gFrameView = glm::mat4(1.0f);
+	glm::mat4 gFrameProjection = glm::mat4(1.0f);
+
+	//Lights are culled into screen clusters each frame on the worker pool
+	WorkerPool gWorkerPool;
+	LightGrid gLightGrid;
+	GLLightBuffers gLightBuffers;
+
+	//How long startup took before the first frame, reported once and written with benchmark results
+	StartupTimes gStartupTimes;
+
+	//Stats overlay (window title) refresh
+	float gOverlayLastUpdate = 0.0f;
+	int gOverlayFrames = 0;
+	CpuUsage gOverlayCpu;		//Since the last refresh
+	CpuUsage gRunCpu;			//Since the render loop started, reported on exit
+	int gRunFrames = 0;
+
+	//Render-on-demand state: what has changed since the last frame was drawn
+	unsigned gFrameDirty = FRAME_DIRTY_RESIZE;	//The first frame is always drawn
 
 	//Camera
 	float cameraSpeed = 2.0f;
@@ -55,253 +176,468 @@ namespace {
 	glm::vec3 gCameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
 	glm::vec3 gCameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
-	//Timing
-	float gDeltaTime = 0.0f;	//Time between current and last frame
-	float gLastFrame = 0.0f;
+	//Camera movement runs at a fixed rate on its own thread; frames draw its state interpolated to the frame's time
+	Simulation gSimulation;
+	SimulationState gDrawnView;		//What the last frame drew
 
 	//Lighting variables
-	glm::vec3 gLightColor(0.85f, 0.85f, 0.86f);
-	glm::vec3 gLightColorB(0.98f, 0.85f, 0.95f);
-	glm::vec3 gLightPosition(20.0f, 15.0f, -15.0f);
-	glm::vec3 gLightPositionB(20.0f, 30.0f, 30.0f);
 	glm::vec3 gLightScale(1.0f);
 	glm::vec3 gLightScaleB(0.1f);
 	glm::vec2 gUVScale(0.5f, 0.5f);
 	glm::vec2 gUVScaleB(0.05f, 0.05f);
 
 	const double pi = 3.14159265358979323846;
+
+	//Headless benchmark options (--headless --frames=N --warmup=N --json=path --shader-normals --vertex-format=full|compact --multi-draw --occlusion)
+	bool gHeadless = false;
+	bool gShaderNormals = false;	//Derive normal matrices per vertex in the shader, the baseline for vertex throughput
+	string gVertexFormat = "scene";	//"scene" keeps the scene file's per-mesh choice, "full" or "compact" applies to every mesh
+	bool gValidateVertices = false;	//Report compact encoding error of every mesh at startup
+	bool gUseBakedTextures = true;	//Load the .btx copies texbake wrote instead of decoding the images
+	bool gLevelOfDetail = true;		//Draw round primitives at a segment count chosen by their size on screen
+	bool gRenderOnDemand = false;	//Sleep in the render loop until input, a shader rebuild or the window dirties the frame
+	int gSimulationRate = 120;		//Simulation ticks per second
+	ProgramCacheMode gShaderCache = PROGRAM_CACHE_ON;	//Reuse linked program binaries from earlier runs (ProgramCache)
+	bool gSpecializedShaders = true;	//Draw each material with its smallest shader variant, not the generic one
+	string gShaderManifest;			//Variant manifest to compile as well, to precompile and time every listed variant
+	ShaderCompileMode gShaderCompile = SHADER_COMPILE_AUTO;	//Where variants compile off the critical path
+	int gShaderReload = -1;			//Rebuild variants when their template files change: 1, 0, or -1 for windowed runs only
+	TextureFlip gTextureFlip = TEXTURE_FLIP_ROWS;	//How decoded images are put in GL row order
+	int gTextureLayerSize = 0;		//Caps the texture array's layer size, 0 for the largest scene texture
+	bool gMultiDraw = false;		//Submit the scene with glMultiDrawElementsIndirect from the mesh pool
+	bool gOcclusion = false;		//Hide instances behind the depth drawn so far with a Hi-Z test; implies gMultiDraw
+	CullingMode gCulling = CULLING_SIMD;
+	int gBenchmarkFrames = 300;
+	int gWarmupFrames = 10;
+	string gBenchmarkJsonPath = "benchmark.json";
 }
 
 //Functions to intitialize, set window size and draw on screen
+bool UParseCommandLine(int argc, char* argv[]);
 bool UInitialize(int, char* [], GLFWwindow** window);
+bool UCreateWindow(GLFWwindow** window);
+int URunBenchmark();
 void UResizeWindow(GLFWwindow* window, int width, int height);
 void UProcessInput(GLFWwindow* window);
 void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos);
 void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
-void UCreateMesh(GLMesh& mesh);
+void UCreateMesh(GLMesh& mesh, const vector<bool>& compactMeshes);
+int UPickDrawItem(float ndcX, float ndcY, float& distance);
 void UDestroyMesh(GLMesh& mesh);
-bool UCreateTexture(const char* fileName, GLuint& textureId);
 void UDestroyTexture(GLuint textureId);
 void URender();
-bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId);
-void UDestroyShaderProgram(GLuint programId);
-
-//Vertex shader source code
-const GLchar* vertexShaderSource = GLSL(440,
-	layout(location = 0) in vec3 position; // VAP position 0 for vertex position data
-layout(location = 1) in vec3 normal; // VAP position 1 for normals
-layout(location = 2) in vec2 textureCoordinate;
-
-out vec3 vertexNormal; // For outgoing normals to fragment shader
-out vec3 vertexFragmentPos; // For outgoing color / pixels to fragment shader
-out vec2 vertexTextureCoordinate;
-
-//Uniform / Global variables for the  transform matrices
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-void main()
-{
-	gl_Position = projection * view * model * vec4(position, 1.0f); // Transforms vertices into clip coordinates
-
-	vertexFragmentPos = vec3(model * vec4(position, 1.0f)); // Gets fragment / pixel position in world space only (exclude view and projection)
-
-	vertexNormal = mat3(transpose(inverse(model))) * normal; // get normal vectors in world space only and exclude normal translation properties
-	vertexTextureCoordinate = textureCoordinate;
-}
-);
-
-//Fragment shader source code
-const GLchar* fragmentShaderSource = GLSL(440,
-	in vec3 vertexNormal; // For incoming normals
-in vec3 vertexFragmentPos; // For incoming fragment position
-in vec2 vertexTextureCoordinate;
-
-out vec4 fragmentColor; // For outgoing cube color to the GPU
+void UUpdateStatsOverlay(float currentTime, bool drewFrame);
+void UAddCpuUsage(bool idle, double wallSeconds, double cpuSeconds);
+void UWindowRefreshCallback(GLFWwindow* window);
+void UUpdateSceneShaders();
+bool UCreateSceneShaders();
+bool UCreateCompilerContext(function<bool()>& makeCurrent, function<void()>& release);
+void UReportShaderVariants();
+int UDrawProgram(int material, int format);
 
-// Uniform / Global variables for light color, light position, and camera/view position
-uniform vec3 lightColor;
-uniform vec3 lightPos;
-uniform vec3 viewPosition;
-
-uniform vec3 lightColorB;
-uniform vec3 lightPosB;
-uniform vec3 viewPositionB;
-
-uniform sampler2D uTexture; // Useful when working with multiple textures
-uniform vec2 uvScale;
-
-void main()
-{
-	/*Phong lighting model calculations to generate ambient, diffuse, and specular components*/
-
-	//Calculate Ambient lighting*/
-	float ambientStrength = 0.3f; // Set ambient or global lighting strength
-	vec3 ambient = ambientStrength * lightColor; // Generate ambient light color
-
-	//Calculate Diffuse lighting*/
-	vec3 norm = normalize(vertexNormal); // Normalize vectors to 1 unit
-	vec3 lightDirection = normalize(lightPos - vertexFragmentPos); // Calculate distance (light direction) between light source and fragments/pixels on cube
-	float impact = max(dot(norm, lightDirection), 0.0);// Calculate diffuse impact by generating dot product of normal and light
-	vec3 diffuse = impact * lightColor; // Generate diffuse light color
-
-	//Calculate Specular lighting*/
-	float specularIntensity = 0.1f; // Set specular light strength
-	float highlightSize = 16.0f; // Set specular highlight size
-	vec3 viewDir = normalize(viewPosition - vertexFragmentPos); // Calculate view direction
-	vec3 reflectDir = reflect(-lightDirection, norm);// Calculate reflection vector
-
-	//Calculate specular component
-	float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), highlightSize);
-	vec3 specular = specularIntensity * specularComponent * lightColor;
-
-	//Calculate Ambient lighting*/
-	float ambientStrengthB = 0.5f; // Set ambient or global lighting strength
-	vec3 ambientB = ambientStrengthB * lightColorB; // Generate ambient light color
-
-	//Calculate Diffuse lighting*/
-	vec3 normB = normalize(vertexNormal); // Normalize vectors to 1 unit
-	vec3 lightDirectionB = normalize(lightPosB - vertexFragmentPos); // Calculate distance (light direction) between light source and fragments/pixels on cube
-	float impactB = max(dot(normB, lightDirectionB), 0.0);// Calculate diffuse impact by generating dot product of normal and light
-	vec3 diffuseB = impactB * lightColorB; // Generate diffuse light color
-
-	//Calculate Specular lighting*/
-	float specularIntensityB = 0.2f; // Set specular light strength
-	float highlightSizeB = 16.0f; // Set specular highlight size
-	vec3 viewDirB = normalize(viewPositionB - vertexFragmentPos); // Calculate view direction
-	vec3 reflectDirB = reflect(-lightDirectionB, normB);// Calculate reflection vector
-
-	//Calculate specular component
-	float specularComponentB = pow(max(dot(viewDirB, reflectDirB), 0.0), highlightSizeB);
-	vec3 specularB = specularIntensityB * specularComponentB * lightColorB;
-
-	// Texture holds the color to be used for all three components
-	vec4 textureColor = texture(uTexture, vertexTextureCoordinate * uvScale);
-
-	// Calculate phong result
-	vec3 phong = ((ambient + diffuse + specular) + (ambientB + diffuseB + specularB)) * textureColor.xyz;
-
-	fragmentColor = vec4(phong, 1.0); // Send lighting results to GPU
-}
-);
+int main(int argc, char* argv[]) {
+	const auto startupStart = chrono::steady_clock::now();
 
-void flipImageVertically(unsigned char* image, int width, int height, int channels)
-{
-	for (int j = 0; j < height / 2; ++j)
-	{
-		int index1 = j * width * channels;
-		int index2 = (height - 1 - j) * width * channels;
-
-		for (int i = width * channels; i > 0; --i)
-		{
-			unsigned char tmp = image[index1];
-			image[index1] = image[index2];
-			image[index2] = tmp;
-			++index1;
-			++index2;
-		}
+	if (!UParseCommandLine(argc, argv)) {
+		return EXIT_FAILURE;
 	}
-}
-
 
-int main(int argc, char* argv[]) {
 	if (!UInitialize(argc, argv, &gWindow)) {
 		return EXIT_FAILURE;
 	}
 
-	//Create mesh
-	UCreateMesh(gMesh);		//Calls function to create vbo
+	//Every program built from here on, the culling and resampling ones included, goes through the cache
+	UOpenProgramCache("shadercache", gShaderCache);
 
-	//Create shader program
-	if (!UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, gProgramId)) {
+	//Load scene first, it picks each mesh's vertex layout and lists the textures
+	if (!ULoadScene(gScenePath.c_str(), MESH_NAMES, gScene)) {
 		return EXIT_FAILURE;
 	}
 
-	//Load texture
-	const char* houseTexFileName = "textures/housetexture.jpg";
-	const char* floorTexFileName = "textures/blankback.jpg";
-	const char* tissueTexFileName = "textures/tissuetexture.jpg";
-	const char* watchTexFileName = "textures/watchtexture.jpg";
-	const char* bottleTexFileName = "textures/bottletexture.jpg";
-	const char* capTexFileName = "textures/captexture.jpg";
-	const char* watchFaceTexFileName = "textures/watchfacetexture.jpg";
+	//Texture files decode on worker threads while meshes and shaders are built here
+	TextureLoader textureLoader;
+	vector<string> texturePaths;
+	for (const SceneTexture& texture : gScene.textures)
+		texturePaths.push_back(texture.path);
+	textureLoader.Start(texturePaths, gUseBakedTextures, gTextureFlip);
 
-	if (!UCreateTexture(houseTexFileName, houseTextureId))
-	{
-		cout << "Failed to load texture " << houseTexFileName << endl;
-		return EXIT_FAILURE;
+	//Create mesh
+	auto phaseStart = chrono::steady_clock::now();
+	vector<bool> compactMeshes = gScene.compactMeshes;
+	if (gVertexFormat != "scene")
+		compactMeshes.assign(MESH_NAMES.size(), gVertexFormat == "compact");
+	UCreateMesh(gMesh, compactMeshes);		//Calls function to create vbo
+
+	//The scene names meshes; from here on draw items point at the GLMesh entry, which names may share
+	for (DrawItem& item : gScene.drawItems)
+		item.mesh = gMesh.meshOfName[item.mesh];
+
+	//Every VAO reads its instance index from the shared instance buffer
+	UCreateInstanceBuffer(gInstanceBuffer, 1024);
+	for (const GLIndexedMesh& part : gMesh.meshes)
+		UAttachInstanceBuffer(gInstanceBuffer, part.vao);
+
+	//The indirect path draws from copies of the meshes packed per vertex format
+	if (gMultiDraw) {
+		UCreateMeshPool(gMesh.meshes, gMeshPool);
+		for (const GLMeshPoolGroup& group : gMeshPool.groups)
+			if (group.vao != 0)
+				UAttachInstanceBuffer(gInstanceBuffer, group.vao);
 	}
-
-	if (!UCreateTexture(floorTexFileName, floorTextureId))
-	{
-		cout << "Failed to load texture " << floorTexFileName << endl;
-		return EXIT_FAILURE;
+	if (gOcclusion && !UCreateOcclusionCuller(gOcclusionCuller, gScene.drawItems.size())) {
+		cout << "Failed to create the occlusion culling shaders, drawing without them" << endl;
+		gOcclusion = false;
 	}
 
-	if (!UCreateTexture(tissueTexFileName, tissueTextureId))
-	{
-		cout << "Failed to load texture " << tissueTexFileName << endl;
-		return EXIT_FAILURE;
-	}
+	gStartupTimes.meshMs = chrono::duration<double, milli>(chrono::steady_clock::now() - phaseStart).count();
 
-	if (!UCreateTexture(watchTexFileName, watchTextureId))
-	{
-		cout << "Failed to load texture " << watchTexFileName << endl;
+	//World boxes of the draw items and the hierarchy culling and picking walk
+	phaseStart = chrono::steady_clock::now();
+	UResizeCullingBounds(gCullingBounds, gScene.drawItems.size());
+	for (size_t i = 0; i < gScene.drawItems.size(); ++i) {
+		const DrawItem& item = gScene.drawItems[i];
+		USetCullingBounds(gCullingBounds, i, gMesh.meshes[item.mesh].bounds, item.world);
+	}
+	UBuildBvh(gCullingBounds, gBvh);
+	gStartupTimes.bvhMs = chrono::duration<double, milli>(chrono::steady_clock::now() - phaseStart).count();
+	gStartupTimes.bvhNodes = static_cast<int>(gBvh.nodes.size());
+
+	ostringstream bvhReport;
+	bvhReport << "INFO: BVH over " << gScene.drawItems.size() << " draw items: " << gBvh.nodes.size() << " nodes, " << gBvh.leaves << " leaves, depth "
+		<< gBvh.depth << ", built in " << fixed << setprecision(1) << gStartupTimes.bvhMs << " ms";
+	cout << bvhReport.str() << endl;
+
+	//Create shader programs; only the generic variant is waited for
+	phaseStart = chrono::steady_clock::now();
+	if (!UCreateSceneShaders()) {
 		return EXIT_FAILURE;
 	}
-
-	if (!UCreateTexture(bottleTexFileName, bottleTextureId))
-	{
-		cout << "Failed to load texture " << bottleTexFileName << endl;
+	gStartupTimes.shaderMs = chrono::duration<double, milli>(chrono::steady_clock::now() - phaseStart).count();
+	UCreateFrameUniforms(gFrameUniforms);
+	UCreateLightBuffers(gLightBuffers);
+	gWorkerPool.Start();
+
+	//Upload the scene's textures as their decodes finish
+	vector<GLuint> textureIds;
+	TextureLoadStats textureStats;
+	bool texturesLoaded = textureLoader.Finish(textureIds, textureStats);
+	for (size_t i = 0; i < gScene.textures.size(); ++i) {
+		gScene.textures[i].id = textureIds[i];
+		gScene.textures[i].rowsTopDown = textureLoader.RowsTopDown(static_cast<int>(i));
+	}
+	if (!texturesLoaded) {
 		return EXIT_FAILURE;
 	}
 
-	if (!UCreateTexture(watchFaceTexFileName, watchFaceTextureId))
-	{
-		cout << "Failed to load texture " << watchFaceTexFileName << endl;
-		return EXIT_FAILURE;
+	for (const SceneMaterial& material : gScene.materials) {
+		glm::uvec2 texture(0, 0);
+		if (material.texture >= 0)
+			texture = glm::uvec2(material.texture, gScene.textures[material.texture].rowsTopDown ? INSTANCE_ROWS_TOP_DOWN : 0);
+		else {
+			//Unorm RGBA8, red in the low byte, as unpackUnorm4x8 reads it
+			GLuint packed = 255u << 24;
+			for (int channel = 0; channel < 3; ++channel)
+				packed |= static_cast<GLuint>(lround(min(max(material.color[channel], 0.0f), 1.0f) * 255.0f)) << (8 * channel);
+			texture = glm::uvec2(packed, INSTANCE_UNTEXTURED);
+		}
+		if (!material.specular)
+			texture.y |= INSTANCE_NO_SPECULAR;
+		gMaterialTextures.push_back(texture);
 	}
 
-	if (!UCreateTexture(capTexFileName, capTextureId))
-	{
-		cout << "Failed to load texture " << capTexFileName << endl;
+	//Pack them into one array texture so a frame binds a single texture; the individual ones are not needed after
+	phaseStart = chrono::steady_clock::now();
+	if (!UPackTextureArray(textureIds, gTextureLayerSize, gTextureArray)) {
 		return EXIT_FAILURE;
 	}
-
-	// Tell OpenGL for each sampler which texture unit it belongs to
-	glUseProgram(gProgramId);
-	// We set the texture as texture unit 0
-	glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
+	for (SceneTexture& texture : gScene.textures) {
+		UDestroyTexture(texture.id);
+		texture.id = 0;
+	}
+	gStartupTimes.textureArrayMs = chrono::duration<double, milli>(chrono::steady_clock::now() - phaseStart).count();
+
+	ostringstream arrayReport;
+	arrayReport << "INFO: Texture array " << gTextureArray.width << "x" << gTextureArray.height << ", " << gTextureArray.layers << " layers, "
+		<< gTextureArray.levels << " levels, " << gTextureArray.layers - gTextureArray.resampled << " copied, " << gTextureArray.resampled << " resampled, "
+		<< fixed << setprecision(1)
+		<< gTextureArray.megabytes << " MB in " << gStartupTimes.textureArrayMs << " ms";
+	cout << arrayReport.str() << endl;
+
+	gStartupTimes.textureWallMs = textureStats.wallMs;
+	gStartupTimes.textureWaitMs = textureStats.waitMs;
+	gStartupTimes.textureDecodeMs = textureStats.decodeMs;
+	gStartupTimes.textureFlipMs = textureStats.flipMs;
+	gStartupTimes.textureUploadMs = textureStats.uploadMs;
+	gStartupTimes.textureMipmapMs = textureStats.mipmapMs;
+	gStartupTimes.textureThreads = textureStats.threads;
+	gStartupTimes.textureBaked = textureStats.baked;
+	gStartupTimes.textureMegabytes = textureStats.megabytes;
+	const ProgramCacheStats& cacheStats = UProgramCacheStats();
+	gStartupTimes.programCacheHits = cacheStats.hits;
+	gStartupTimes.programCacheMisses = cacheStats.misses + cacheStats.rejected;
+	gStartupTimes.programCacheLoadMs = cacheStats.loadMs;
+	gStartupTimes.programCacheStoreMs = cacheStats.storeMs;
+	gStartupTimes.totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - startupStart).count();
+
+	ostringstream startupReport;
+	startupReport << fixed << setprecision(1) << "INFO: Startup " << gStartupTimes.totalMs << " ms: meshes " << gStartupTimes.meshMs
+		<< " ms, shaders " << gStartupTimes.shaderMs << " ms (cache " << cacheStats.hits << " hits, " << gStartupTimes.programCacheMisses << " misses), textures " << textureStats.textures << " (" << textureStats.baked << " baked, "
+		<< textureStats.megabytes << " MB) in " << textureStats.wallMs << " ms (decode " << textureStats.decodeMs << " ms incl. flip " << textureStats.flipMs << " ms on " << textureStats.threads << " threads, waited " << textureStats.waitMs
+		<< " ms, upload " << textureStats.uploadMs << " ms, mipmap " << textureStats.mipmapMs << " ms)";
+	cout << startupReport.str() << endl;
 
 	//Set background color to black
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-	//Render loop
+	//Headless runs render a fixed number of frames offscreen and exit
+	if (gHeadless) {
+		//Measured frames draw every material with its own variant
+		UPollShaderVariants(gShaderVariants, true);
+		UReportShaderVariants();
+		gVariantsPending = false;
+
+		int result = URunBenchmark();
+
+		UDestroyMesh(gMesh);
+		UDestroyMeshPool(gMeshPool);
+		UDestroyOcclusionCuller(gOcclusionCuller);
+		UDestroyInstanceBuffer(gInstanceBuffer);
+		UDestroyTextureArray(gTextureArray);
+		UDestroyShaderVariants(gShaderVariants);
+		UDestroyFileWatcher(gShaderWatcher);
+		UDestroyFrameUniforms(gFrameUniforms);
+		UDestroyLightBuffers(gLightBuffers);
+		gWorkerPool.Stop();
+		UDestroyHeadlessContext();
+
+		exit(result);
+	}
+
+	//The simulation takes over the camera. On demand its ticks that change the view wake the render loop
+	function<void()> onViewChange;
+	if (gRenderOnDemand)
+		onViewChange = [] { glfwPostEmptyEvent(); };
+	gSimulation.Start(gCamera, viewProjection, gSimulationRate, onViewChange);
+
+	//Render loop. On demand a frame is only drawn once something has marked it dirty; in between the loop sleeps in
+	//glfwWaitEventsTimeout until an event arrives or the timeout comes round to look for shader changes
 	while (!glfwWindowShouldClose(gWindow)) {
-		//Frame timing
-		float currentFrame = glfwGetTime();
-		gDeltaTime = currentFrame - gLastFrame;
-		gLastFrame = currentFrame;
+		const double iterationStart = glfwGetTime();
+		const double cpuStart = UProcessCpuSeconds();
+		float currentFrame = iterationStart;
 
 		UProcessInput(gWindow);
-		URender();
-		glfwPollEvents();
+		UUpdateSceneShaders();
+
+		//The view as of now, between the simulation's last two ticks. Until it settles every frame shows it further on
+		bool viewSettled = true;
+		const SimulationState view = gSimulation.Interpolate(chrono::steady_clock::now(), viewSettled);
+		if (view != gDrawnView)
+			gFrameDirty |= FRAME_DIRTY_VIEW;
+
+		const bool drawFrame = !gRenderOnDemand || gFrameDirty != 0;
+		if (drawFrame) {
+			gCamera.SetPose(view.position, view.yaw, view.pitch);
+			gCamera.Zoom = view.zoom;
+			viewProjection = view.perspective;
+			gDrawnView = view;
+
+			URender();
+			glfwSwapBuffers(gWindow);
+			++gRunFrames;
+			gFrameDirty = 0;
+		}
+
+		//GLFW poll events, or with nothing to draw sleep until there are some
+		if (gRenderOnDemand && gFrameDirty == 0 && viewSettled) {
+			const double waitStart = glfwGetTime();
+			const double waitCpuStart = UProcessCpuSeconds();
+			UAddCpuUsage(!drawFrame, waitStart - iterationStart, waitCpuStart - cpuStart);
+
+			glfwWaitEventsTimeout(gVariantsPending || gShadersReloading ? COMPILE_WAIT_SECONDS : IDLE_WAIT_SECONDS);
+			UAddCpuUsage(true, glfwGetTime() - waitStart, UProcessCpuSeconds() - waitCpuStart);
+		}
+		else {
+			glfwPollEvents();
+			UAddCpuUsage(!drawFrame, glfwGetTime() - iterationStart, UProcessCpuSeconds() - cpuStart);
+		}
+
+		UUpdateStatsOverlay(currentFrame, drawFrame);
+	}
+	gSimulation.Stop();
+
+	const double runWall = gRunCpu.busyWall + gRunCpu.idleWall;
+	if (runWall > 0.0) {
+		ostringstream runReport;
+		runReport << fixed << setprecision(1) << "INFO: Drew " << gRunFrames << " frames in " << runWall << " s" << (gRenderOnDemand ? " on demand" : "")
+			<< " against " << gSimulation.Ticks() << " simulation ticks at " << gSimulation.TicksPerSecond() << " Hz"
+			<< ", CPU " << 100.0 * (gRunCpu.busyCpu + gRunCpu.idleCpu) / runWall << "%";
+		if (gRunCpu.idleWall > 0.0)
+			runReport << ", idle " << 100.0 * gRunCpu.idleWall / runWall << "% of the time at " << 100.0 * gRunCpu.idleCpu / gRunCpu.idleWall << "% CPU";
+		cout << runReport.str() << endl;
 	}
 
 	//Release mesh data
 	UDestroyMesh(gMesh);
-
-	//Release shader program
-	UDestroyShaderProgram(gProgramId);
+	UDestroyMeshPool(gMeshPool);
+	UDestroyOcclusionCuller(gOcclusionCuller);
+	UDestroyInstanceBuffer(gInstanceBuffer);
+
+	//Release textures
+	UDestroyTextureArray(gTextureArray);
+
+	//Release shader programs
+	UDestroyShaderVariants(gShaderVariants);
+	UDestroyFileWatcher(gShaderWatcher);
+	if (gCompilerWindow)
+		glfwDestroyWindow(gCompilerWindow);
+	UDestroyFrameUniforms(gFrameUniforms);
+	UDestroyLightBuffers(gLightBuffers);
+	gWorkerPool.Stop();
 
 	exit(EXIT_SUCCESS);		//Successfully terminate program
 }
 
 
+//Reads benchmark options from the command line
+bool UParseCommandLine(int argc, char* argv[]) {
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+
+		if (strcmp(arg, "--headless") == 0)
+			gHeadless = true;
+		else if (strncmp(arg, "--frames=", 9) == 0)
+			gBenchmarkFrames = atoi(arg + 9);
+		else if (strncmp(arg, "--warmup=", 9) == 0)
+			gWarmupFrames = atoi(arg + 9);
+		else if (strncmp(arg, "--json=", 7) == 0)
+			gBenchmarkJsonPath = arg + 7;
+		else if (strncmp(arg, "--scene=", 8) == 0)
+			gScenePath = arg + 8;
+		else if (strcmp(arg, "--shader-normals") == 0)
+			gShaderNormals = true;
+		else if (strncmp(arg, "--vertex-format=", 16) == 0)
+			gVertexFormat = arg + 16;
+		else if (strcmp(arg, "--validate-vertices") == 0)
+			gValidateVertices = true;
+		else if (strcmp(arg, "--no-baked-textures") == 0)
+			gUseBakedTextures = false;
+		else if (strcmp(arg, "--no-lod") == 0)
+			gLevelOfDetail = false;
+		else if (strcmp(arg, "--render=continuous") == 0)
+			gRenderOnDemand = false;
+		else if (strcmp(arg, "--render=on-demand") == 0)
+			gRenderOnDemand = true;
+		else if (strncmp(arg, "--sim-rate=", 11) == 0)
+			gSimulationRate = atoi(arg + 11);
+		else if (strcmp(arg, "--shader-cache=on") == 0)
+			gShaderCache = PROGRAM_CACHE_ON;
+		else if (strcmp(arg, "--shader-cache=rebuild") == 0)
+			gShaderCache = PROGRAM_CACHE_REBUILD;
+		else if (strcmp(arg, "--shader-cache=off") == 0)
+			gShaderCache = PROGRAM_CACHE_OFF;
+		else if (strcmp(arg, "--shader-variants=specialized") == 0)
+			gSpecializedShaders = true;
+		else if (strcmp(arg, "--shader-variants=generic") == 0)
+			gSpecializedShaders = false;
+		else if (strcmp(arg, "--precompile-shaders") == 0)
+			gShaderManifest = "shaders/variants.manifest";
+		else if (strncmp(arg, "--precompile-shaders=", 21) == 0)
+			gShaderManifest = arg + 21;
+		else if (strcmp(arg, "--shader-compile=auto") == 0)
+			gShaderCompile = SHADER_COMPILE_AUTO;
+		else if (strcmp(arg, "--shader-compile=driver") == 0)
+			gShaderCompile = SHADER_COMPILE_DRIVER;
+		else if (strcmp(arg, "--shader-compile=worker") == 0)
+			gShaderCompile = SHADER_COMPILE_WORKER;
+		else if (strcmp(arg, "--shader-compile=main") == 0)
+			gShaderCompile = SHADER_COMPILE_MAIN;
+		else if (strcmp(arg, "--shader-reload=on") == 0)
+			gShaderReload = 1;
+		else if (strcmp(arg, "--shader-reload=off") == 0)
+			gShaderReload = 0;
+		else if (strcmp(arg, "--texture-flip=rows") == 0)
+			gTextureFlip = TEXTURE_FLIP_ROWS;
+		else if (strcmp(arg, "--texture-flip=stb") == 0)
+			gTextureFlip = TEXTURE_FLIP_STB;
+		else if (strcmp(arg, "--texture-flip=uv") == 0)
+			gTextureFlip = TEXTURE_FLIP_NONE;
+		else if (strncmp(arg, "--texture-layer-size=", 21) == 0)
+			gTextureLayerSize = atoi(arg + 21);
+		else if (strcmp(arg, "--multi-draw") == 0)
+			gMultiDraw = true;
+		else if (strcmp(arg, "--occlusion") == 0)
+			gOcclusion = gMultiDraw = true;
+		else if (strcmp(arg, "--culling=off") == 0)
+			gCulling = CULLING_OFF;
+		else if (strcmp(arg, "--culling=scalar") == 0)
+			gCulling = CULLING_SCALAR;
+		else if (strcmp(arg, "--culling=simd") == 0)
+			gCulling = CULLING_SIMD;
+		else if (strcmp(arg, "--culling=bvh") == 0)
+			gCulling = CULLING_BVH;
+		else {
+			cout << "Unknown option " << arg << endl;
+			cout << "Usage: " << argv[0] << " [--scene=path] [--headless] [--frames=N] [--warmup=N] [--json=path] [--shader-normals]"
+				<< " [--vertex-format=scene|full|compact] [--validate-vertices] [--no-baked-textures] [--no-lod] [--render=continuous|on-demand] [--sim-rate=N]"
+				<< " [--shader-cache=on|rebuild|off] [--shader-variants=specialized|generic] [--precompile-shaders[=manifest]]"
+				<< " [--shader-compile=auto|driver|worker|main] [--shader-reload=on|off]"
+				<< " [--texture-flip=rows|stb|uv] [--texture-layer-size=N] [--multi-draw] [--occlusion]"
+				<< " [--culling=off|scalar|simd|bvh]" << endl;
+			return false;
+		}
+	}
+
+	if (gSimulationRate <= 0) {
+		cout << "--sim-rate must be positive" << endl;
+		return false;
+	}
+
+	if (gBenchmarkFrames <= 0 || gWarmupFrames < 0) {
+		cout << "--frames must be positive and --warmup must not be negative" << endl;
+		return false;
+	}
+
+	if (gVertexFormat != "scene" && gVertexFormat != "full" && gVertexFormat != "compact") {
+		cout << "--vertex-format must be scene, full or compact" << endl;
+		return false;
+	}
+
+	return true;
+}
+
 //Initialize GLFW, GLEW and create a new window
 bool UInitialize(int argc, char* argv[], GLFWwindow** window) {
+	if (gHeadless) {
+		if (!UCreateHeadlessContext(WINDOW_WIDTH, WINDOW_HEIGHT))
+			return false;
+	}
+	else if (!UCreateWindow(window)) {
+		return false;
+	}
+
+	//GLEW intialize
+	glewExperimental = GL_TRUE;
+	GLenum GlewInitResult = glewInit();
+
+	//GLEW built against GLX refuses EGL contexts, but the GL entry points can still be loaded directly
+	if (GlewInitResult == GLEW_ERROR_NO_GLX_DISPLAY && gHeadless)
+		GlewInitResult = glewContextInit();
+
+	if (GLEW_OK != GlewInitResult) {
+		std::cerr << glewGetErrorString(GlewInitResult) << std::endl;
+		return false;
+	}
+
+	//Displays GPU OpenGL version
+	cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << endl;
+
+	return true;
+}
+
+//Create the GLFW window and hook up input callbacks
+bool UCreateWindow(GLFWwindow** window) {
 	//GLFW intialize and configure
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -321,55 +657,148 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window) {
 	}
 	glfwMakeContextCurrent(*window);
 	glfwSetFramebufferSizeCallback(*window, UResizeWindow);
+	glfwSetWindowRefreshCallback(*window, UWindowRefreshCallback);
 	glfwSetCursorPosCallback(*window, UMousePositionCallback);
 	glfwSetScrollCallback(*window, UMouseScrollCallback);
 	glfwSetMouseButtonCallback(*window, UMouseButtonCallback);
 
 	//capture mouse
 	glfwSetInputMode(*window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-	
-	//GLEW intialize
-	glewExperimental = GL_TRUE;
-	GLenum GlewInitResult = glewInit();
 
-	if (GLEW_OK != GlewInitResult) {
-		std::cerr << glewGetErrorString(GlewInitResult) << std::endl;
-		return false;
+	return true;
+}
+
+//Renders the benchmark camera path into an offscreen framebuffer and writes frame timings as JSON
+int URunBenchmark() {
+	GLOffscreenTarget target;
+	if (!UCreateOffscreenTarget(target, WINDOW_WIDTH, WINDOW_HEIGHT))
+		return EXIT_FAILURE;
+
+	GpuFrameTimer gpuTimer;
+	gpuTimer.Create();
+
+	vector<FrameSample> samples(gBenchmarkFrames);
+	const int totalFrames = gWarmupFrames + gBenchmarkFrames;
+
+	for (int frame = 0; frame < totalFrames; ++frame) {
+		glm::vec3 position;
+		float yaw, pitch;
+		UCameraPathPose(frame, totalFrames, position, yaw, pitch);
+		gCamera.SetPose(position, yaw, pitch);
+
+		//Warmup frames are rendered (shader and texture residency) but not recorded
+		const int sampleIndex = frame - gWarmupFrames;
+		const bool measured = sampleIndex >= 0;
+
+		if (measured)
+			gpuTimer.Begin(sampleIndex);
+
+		auto cpuStart = chrono::steady_clock::now();
+		UUpdateSceneShaders();
+		URender();
+		auto cpuEnd = chrono::steady_clock::now();
+
+		if (measured) {
+			gpuTimer.End();
+			samples[sampleIndex].frame = sampleIndex;
+			samples[sampleIndex].cpuMs = chrono::duration<double, milli>(cpuEnd - cpuStart).count();
+			samples[sampleIndex].drawCalls = gRenderStats.drawCalls;
+			samples[sampleIndex].instances = gRenderStats.instances;
+			samples[sampleIndex].vertices = gRenderStats.vertices;
+			samples[sampleIndex].triangles = gRenderStats.triangles;
+			samples[sampleIndex].stateChanges = gRenderStats.StateChanges();
+			samples[sampleIndex].visible = gRenderStats.visible;
+			samples[sampleIndex].culled = gRenderStats.culled;
+			samples[sampleIndex].cullMs = gRenderStats.cullMs;
+			if (gOcclusion)
+				samples[sampleIndex].occluded = gRenderStats.occluded;
+
+			//What a click in the middle of the screen would cost
+			float distance;
+			const auto pickStart = chrono::steady_clock::now();
+			UPickDrawItem(0.0f, 0.0f, distance);
+			samples[sampleIndex].pickMs = chrono::duration<double, milli>(chrono::steady_clock::now() - pickStart).count();
+		}
+
+		gpuTimer.Collect(samples, false);
+	}
+	gpuTimer.Collect(samples, true);
+
+	BenchmarkInfo info;
+	info.renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	info.version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	info.width = target.width;
+	info.height = target.height;
+	info.warmupFrames = gWarmupFrames;
+	info.normalMatrix = gShaderNormals ? "shader" : "cpu";
+	info.vertexFormat = gVertexFormat;
+	info.submission = gMultiDraw ? "multiDrawIndirect" : "instanced";
+	info.culling = UCullingModeName(gCulling);
+	info.occlusion = gOcclusion;
+	info.levelOfDetail = gLevelOfDetail;
+	info.shaderCache = gShaderCache == PROGRAM_CACHE_ON ? "on" : gShaderCache == PROGRAM_CACHE_REBUILD ? "rebuild" : "off";
+	info.shaderVariants = gSpecializedShaders ? "specialized" : "generic";
+	info.shaderCompile = UShaderCompileModeName(gShaderVariants.mode);
+	for (const GLShaderVariant& entry : gShaderVariants.variants) {
+		ShaderVariantTiming timing;
+		timing.name = UShaderVariantName(entry.variant);
+		timing.compileMs = entry.compileMs;
+		timing.cached = entry.cached;
+		timing.ready = entry.ready;
+		info.variants.push_back(timing);
 	}
+	info.startup = gStartupTimes;
 
-	//Displays GPU OpenGL version
-	cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << endl;
+	gpuTimer.Destroy();
+	UDestroyOffscreenTarget(target);
 
-	return true;
+	ofstream out(gBenchmarkJsonPath);
+	if (!out) {
+		cout << "Failed to open " << gBenchmarkJsonPath << " for writing" << endl;
+		return EXIT_FAILURE;
+	}
+	UWriteBenchmarkJson(out, info, samples);
+	cout << "INFO: Wrote " << samples.size() << " frame timings to " << gBenchmarkJsonPath << endl;
+
+	return EXIT_SUCCESS;
 }
 
-//Processes input, determines whether relevant keys are hit and responds accordingly
+//Processes input, determines whether relevant keys are hit and hands them to the simulation, which moves the camera
 void UProcessInput(GLFWwindow* window) {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
 		glfwSetWindowShouldClose(window, true);
 	}
 
-	float cameraOffSet = cameraSpeed * gDeltaTime;
-
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(FORWARD, gDeltaTime);
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(BACKWARD, gDeltaTime);
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(LEFT, gDeltaTime);
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(RIGHT, gDeltaTime);
-	if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(UP, gDeltaTime);
-	if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-		gCamera.ProcessKeyboard(DOWN, gDeltaTime);
-	if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
-		viewProjection = !viewProjection;
+	const struct {
+		int key;
+		Camera_Movement direction;
+	} movementKeys[] = {
+		{ GLFW_KEY_W, FORWARD }, { GLFW_KEY_S, BACKWARD }, { GLFW_KEY_A, LEFT }, { GLFW_KEY_D, RIGHT }, { GLFW_KEY_Q, UP }, { GLFW_KEY_E, DOWN }
+	};
+	unsigned held = 0;
+	for (const auto& movement : movementKeys) {
+		if (glfwGetKey(window, movement.key) == GLFW_PRESS)
+			held |= UMovementBit(movement.direction);
+	}
+	gSimulation.SetHeldKeys(held);
+
+	//Once per press; the simulation applies it at its next tick
+	static bool projectionKeyDown = false;
+	const bool projectionKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+	if (projectionKey && !projectionKeyDown)
+		gSimulation.ToggleProjection();
+	projectionKeyDown = projectionKey;
 }
 
 //Respond to window resize
 void UResizeWindow(GLFWwindow* window, int width, int height) {
 	glViewport(0, 0, width, height);
+	gFrameDirty |= FRAME_DIRTY_RESIZE;
+}
+
+//The window was uncovered or otherwise lost its contents
+void UWindowRefreshCallback(GLFWwindow*) {
+	gFrameDirty |= FRAME_DIRTY_RESIZE;
 }
 
 void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos) {
@@ -385,7 +814,7 @@ void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos) {
 	gLastX = xpos;
 	gLastY = ypos;
 
-	gCamera.ProcessMouseMovement(xoffset, yoffset);
+	gSimulation.AddMouseLook(xoffset, yoffset);
 }
 
 void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
@@ -393,8 +822,17 @@ void UMouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 	{
 	case GLFW_MOUSE_BUTTON_LEFT:
 	{
-		if (action == GLFW_PRESS)
+		if (action == GLFW_PRESS) {
 			cout << "Left mouse button pressed" << endl;
+
+			//The cursor is captured, so clicks pick whatever is under the middle of the screen
+			float distance;
+			int item = UPickDrawItem(0.0f, 0.0f, distance);
+			if (item >= 0)
+				cout << "Picked " << gScene.nodes[gScene.drawItems[item].node].name << " at distance " << distance << endl;
+			else
+				cout << "Picked nothing" << endl;
+		}
 		else
 			cout << "Left mouse button released" << endl;
 	}
@@ -443,418 +881,472 @@ void URender() {
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	//Set shader to use
-	glUseProgram(gProgramId);
+	RenderStats stats;
 
 	//camera/view transformation
 	glm::mat4 view = gCamera.GetViewMatrix();
 
 	glm::mat4 projection;
+	float nearPlane, farPlane;
 
 	// Create a perspective projection
 	if (viewProjection) {
-		projection = glm::perspective(glm::radians(gCamera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		nearPlane = 0.1f;
+		farPlane = FAR_PLANE;
+		projection = glm::perspective(glm::radians(gCamera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, nearPlane, farPlane);
 	}
 	else {
 		float scale = 120;
-		projection = glm::ortho((800.0f / scale), -(800.0f / scale), -(600.0f / scale), (600.0f / scale), -2.5f, 6.5f);
+		nearPlane = -2.5f;
+		farPlane = 6.5f;
+		projection = glm::ortho((800.0f / scale), -(800.0f / scale), -(600.0f / scale), (600.0f / scale), nearPlane, farPlane);
 	}
 
 	//LIGHT SOURCE BUSINESS
-	// Reference matrix uniforms from the Cube Shader program for the cube color, light color, light position, and camera position
-	GLint objectColorLoc = glGetUniformLocation(gProgramId, "objectColor");
-	GLint lightColorLoc = glGetUniformLocation(gProgramId, "lightColor");
-	GLint lightPositionLoc = glGetUniformLocation(gProgramId, "lightPos");
-	GLint viewPositionLoc = glGetUniformLocation(gProgramId, "viewPosition");
-
-	// Pass color, light, and camera data to the Cube Shader program's corresponding uniforms.
-	glUniform3f(lightColorLoc, gLightColor.r, gLightColor.g, gLightColor.b);
-	glUniform3f(lightPositionLoc, gLightPosition.x, gLightPosition.y, gLightPosition.z);
-	const glm::vec3 cameraPosition = gCamera.Position;
-	glUniform3f(viewPositionLoc, cameraPosition.x, cameraPosition.y, cameraPosition.z);
-
-	GLuint UVScaleLoc = glGetUniformLocation(gProgramId, "uvScale");
-	glUniform2fv(UVScaleLoc, 1, glm::value_ptr(gUVScale));
-
-	//SECOND LIGHT SOURCE
-	//// Reference matrix uniforms from the Cube Shader program for the cube color, light color, light position, and camera position
-	//GLint objectColorLocB = glGetUniformLocation(gProgramId, "objectColorB");
-	//GLint lightColorLocB = glGetUniformLocation(gProgramId, "lightColorB");
-	//GLint lightPositionLocB = glGetUniformLocation(gProgramId, "lightPosB");
-	//GLint viewPositionLocB = glGetUniformLocation(gProgramId, "viewPositionB");
-
-	//// Pass color, light, and camera data to the Cube Shader program's corresponding uniforms.
-	//glUniform3f(lightColorLocB, gLightColorB.r, gLightColorB.g, gLightColorB.b);
-	//glUniform3f(lightPositionLocB, gLightPositionB.x, gLightPositionB.y, gLightPositionB.z);
-	//const glm::vec3 cameraPositionB = gCamera.Position;
-	//glUniform3f(viewPositionLocB, cameraPositionB.x, cameraPositionB.y, cameraPositionB.z);
-
-	//GLuint UVScaleLocB = glGetUniformLocation(gProgramId, "uvScaleB");
-	//glUniform2fv(UVScaleLocB, 1, glm::value_ptr(gUVScaleB));
-
-	//PYRAMID
-	glm::mat4 scale = glm::scale(glm::vec3(0.5f, 0.5f, 0.5f));
-	glm::mat4 rotation = glm::rotate(0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
-	glm::mat4 translation = glm::translate(glm::vec3(0.25f, -0.5f, -0.25f));
-	glm::mat4 model = translation * rotation * scale;
-	// Retrives and passes transformations to shader program
-	GLint modelLoc = glGetUniformLocation(gProgramId, "model");
-	GLint viewLoc = glGetUniformLocation(gProgramId, "view");
-	GLint projLoc = glGetUniformLocation(gProgramId, "projection");
-
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-	glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-	//Texture
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, houseTextureId);
-
-	//Activate VBOs in vao
-	glBindVertexArray(gMesh.vao[0]);
-	glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[0]);
-
-	//CUBE
-	//Texture
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, houseTextureId);
-
-	scale = glm::scale(glm::vec3(0.5f, 0.5f, 0.5f));
-	rotation = glm::rotate(0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
-	translation = glm::translate(glm::vec3(0.25f, -0.75f, 0.0f));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glBindVertexArray(gMesh.vao[1]);
-	glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[1]);
-
-	//PLANE(FLOOR)
-	//Texture
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, floorTextureId);
+	// Scene lights are sorted into screen clusters so each fragment only shades the lights that can reach it
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	UCullLights(gScene.lights, view, projection, nearPlane, farPlane, viewport[2], viewport[3], gWorkerPool, gLightGrid);
+	UUploadLightGrid(gLightBuffers, gLightGrid);
+	stats.lights = static_cast<int>(gLightGrid.lights.size());
+	stats.lightAssignments = static_cast<int>(gLightGrid.indices.size());
+
+	// Camera and light cluster values are shared by every draw, so they go into the FrameData block once per frame
+	FrameData frameData;
+	frameData.view = view;
+	frameData.projection = projection;
+	frameData.viewPosition = gCamera.Position;
+	frameData.clusterGrid = glm::ivec4(gLightGrid.tilesX, gLightGrid.tilesY, gLightGrid.slices, LIGHT_TILE_SIZE);
+	frameData.clusterDepth = glm::vec2(gLightGrid.sliceNear, gLightGrid.sliceScale);
+	frameData.globalLightCount = gLightGrid.globalLights;
+	UUpdateFrameUniforms(gFrameUniforms, frameData);
+
+	gFrameView = view;
+	gFrameProjection = projection;
+
+	//Only nodes that changed since the last frame get their world matrix rebuilt, and only their draw items' boxes
+	//are refit into the hierarchy
+	gChangedItems.clear();
+	UUpdateSceneTransforms(gScene, &gChangedItems);
+	for (uint32_t i : gChangedItems) {
+		const DrawItem& item = gScene.drawItems[i];
+		USetCullingBounds(gCullingBounds, i, gMesh.meshes[item.mesh].bounds, item.world);
+	}
+	URefitBvh(gBvh, gCullingBounds, gChangedItems);
+
+	//Draw items whose world box is outside the view frustum go no further
+	const auto cullStart = chrono::steady_clock::now();
+	gVisibleItems.clear();
+	const Frustum frustum = UExtractFrustum(projection * view);
+	if (gCulling == CULLING_BVH)
+		UCullBvh(gBvh, gCullingBounds, frustum, gVisibleItems);
+	else
+		UCullBounds(gCullingBounds, frustum, gCulling, gVisibleItems);
+	stats.cullMs = chrono::duration<double, milli>(chrono::steady_clock::now() - cullStart).count();
+	stats.visible = static_cast<int>(gVisibleItems.size());
+	stats.culled = static_cast<int>(gScene.drawItems.size()) - stats.visible;
+
+	//Round primitives pick the level of detail that suits their size on screen; everything else draws its mesh
+	gLodLevels.resize(gScene.drawItems.size(), -1);
+	gDrawMeshes.resize(gScene.drawItems.size());
+	for (uint32_t i : gVisibleItems) {
+		const DrawItem& item = gScene.drawItems[i];
+		const MeshLodChain& lod = gMesh.lods[item.mesh];
+		if (lod.count == 0) {
+			gDrawMeshes[i] = item.mesh;
+			continue;
+		}
 
-	scale = glm::scale(glm::vec3(10.0f, 10.0f, 10.0f));
-	rotation = glm::rotate(0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
-	translation = glm::translate(glm::vec3(0.0f, 4.0f, 0.0f));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		const glm::vec3 viewCenter = glm::vec3(view * item.world * glm::vec4(gMesh.meshes[item.mesh].bounds.center, 1.0f));
+		const float scale = max(glm::length(glm::vec3(item.world[0])), glm::length(glm::vec3(item.world[2])));
+		const float pixels = UProjectedDiameter(projection, viewCenter, lod.radius * scale, static_cast<float>(viewport[3]));
+		gLodLevels[i] = USelectLodLevel(pixels, gLodLevels[i]);
+		gDrawMeshes[i] = lod.meshes[gLodLevels[i]];
+	}
 
-	glBindVertexArray(gMesh.vao[2]);
-	glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[2]);
+	//Queue every visible draw item keyed by shader variant, mesh and depth, then submit in key order. Textures are
+	//layers of one array selected per instance, so they no longer split the sort
+	gRenderQueue.Clear();
+	for (uint32_t i : gVisibleItems) {
+		const DrawItem& item = gScene.drawItems[i];
+		float viewDepth = -(view * item.world[3]).z;
+		const int program = UDrawProgram(item.material, gMesh.meshes[gDrawMeshes[i]].format);
+		gRenderQueue.Push(UMakeSortKey(program, 0, gDrawMeshes[i], viewDepth, FAR_PLANE), i, program);
+	}
+	gRenderQueue.Sort();
 
-	//TISSUE BOX
 	//Texture
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tissueTextureId);
-
-	scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-	rotation = glm::rotate(0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
-	translation = glm::translate(glm::vec3(1.5f, -0.5f, 0.5f));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+	glBindTexture(GL_TEXTURE_2D_ARRAY, gTextureArray.id);
+	++stats.textureBinds;
+
+	//Consecutive commands with the same program and mesh collapse into one instanced draw
+	gInstances.clear();
+	gBatches.clear();
+	for (const RenderCommand& command : gRenderQueue.Commands()) {
+		const DrawItem& item = gScene.drawItems[command.item];
+		const int drawMesh = gDrawMeshes[command.item];
+		const int program = static_cast<int>(command.program);
+
+		if (gBatches.empty() || gBatches.back().mesh != drawMesh || gBatches.back().program != program) {
+			DrawBatch batch;
+			batch.mesh = drawMesh;
+			batch.program = program;
+			batch.firstInstance = static_cast<uint32_t>(gInstances.size());
+			gBatches.push_back(batch);
+		}
 
-	glBindVertexArray(gMesh.vao[3]);
-	glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[3]);
+		//Compact meshes fold their position dequantisation into the model matrix
+		const GLIndexedMesh& part = gMesh.meshes[drawMesh];
+		const glm::mat4 model = part.format == VERTEX_FORMAT_COMPACT ? item.world * part.dequantize : item.world;
+		gInstances.push_back(UMakeInstance(model, item.normalMatrix, gMaterialTextures[item.material], gUVScale));
+		++gBatches.back().instanceCount;
+	}
 
-	//BOTTLE BODY
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, bottleTextureId);
-
-	scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-	rotation = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-	translation = glm::translate(glm::vec3(1.3f, 0.3f, -0.4f));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glBindVertexArray(gMesh.vao[4]);
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, gMesh.nVertices[4]);
-
-	//TOP OF BOTTLE
-	scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-	rotation = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	translation = glm::translate(glm::vec3(1.3f, 0.3f, -1.15f));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glBindVertexArray(gMesh.vao[5]);
-	glDrawArrays(GL_TRIANGLE_FAN, 0, gMesh.nVertices[5]);
-
-	//BOTTOM OF BOTTLE
-	scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-	rotation = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	translation = glm::translate(glm::vec3(1.3f, 0.3f, 0.35f));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glBindVertexArray(gMesh.vao[6]);
-	glDrawArrays(GL_TRIANGLE_FAN, 0, gMesh.nVertices[6]);
-
-	//CAP BODY
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, capTextureId);
-
-	scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-	rotation = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-	translation = glm::translate(glm::vec3(1.3f, 0.3f, 0.388));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glBindVertexArray(gMesh.vao[7]);
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, gMesh.nVertices[7]);
-
-	//CAP TOP
-	scale = glm::scale(glm::vec3(1.0f, 1.0f, 1.0f));
-	rotation = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	translation = glm::translate(glm::vec3(1.3f, 0.3f, 0.4255f));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glBindVertexArray(gMesh.vao[8]);
-	glDrawArrays(GL_TRIANGLE_FAN, 0, gMesh.nVertices[8]);
-
-	//WATCH (HAND 1)
-	//Texture
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, watchTextureId);
-
-	scale = glm::scale(glm::vec3(1.0f, 1.0f, 0.75f));
-	rotation = glm::rotate(0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
-	translation = glm::translate(glm::vec3(-0.3f, -0.97f, -0.32f));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glBindVertexArray(gMesh.vao[9]);
-	glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[9]);
-
-	//WATCH (HAND 2)
-	scale = glm::scale(glm::vec3(1.0f, 1.0f, 0.5f));
-	rotation = glm::rotate(0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
-	translation = glm::translate(glm::vec3(-0.3f, -0.97f, 0.68f));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-	glBindVertexArray(gMesh.vao[9]);
-	glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[9]);
-
-	//WATCH FACE BODY
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, watchTextureId);
+	//Binds a draw program's variant, or the generic one while it compiles, when it differs from the bound program.
+	//Only the generic variant has the normal encoding uniform; the others ignore the call
+	GLuint boundProgram = 0;
+	int boundDrawProgram = -1;
+	auto bindProgram = [&](int drawProgram) {
+		if (drawProgram == boundDrawProgram)
+			return;
+		const GLShaderProgram& program = UShaderVariantProgram(gShaderVariants, drawProgram / 2, gGenericVariant);
+		if (program.id != boundProgram) {
+			glUseProgram(program.id);
+			boundProgram = program.id;
+			++stats.programBinds;
+		}
+		glUniform1i(program.octahedralNormalsLoc, drawProgram % 2 == VERTEX_FORMAT_COMPACT);
+		boundDrawProgram = drawProgram;
+	};
 
-	scale = glm::scale(glm::vec3(2.0f, 1.0f, 2.0f));
-	rotation = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	translation = glm::translate(glm::vec3(-0.3f, -0.955f, -0.22));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+	//All per-instance data for the frame goes up in one upload. The occlusion passes compact survivors into one slot
+	//per instance each, and the second pass's base instances index past the first's
+	UUploadInstances(gInstanceBuffer, gInstances, gOcclusion ? gInstances.size() * 2 : 0);
+
+	if (gMultiDraw) {
+		if (gOcclusion)
+			UTakeOcclusionReadback(gOcclusionCuller, gOcclusionDrawn);
+
+		//Each batch becomes an indirect command, in batch order. Batches sharing a draw program share its vertex format
+		//too, so each run of them is one multi-draw
+		gIndirectCommands.clear();
+		gDrawGroups.clear();
+		for (size_t i = 0; i < gBatches.size(); ++i) {
+			const DrawBatch& batch = gBatches[i];
+			const MeshPoolRange& range = gMeshPool.ranges[batch.mesh];
+			if (gDrawGroups.empty() || gDrawGroups.back().program != batch.program) {
+				MultiDrawGroup group;
+				group.program = batch.program;
+				group.format = range.format;
+				group.firstCommand = i;
+				gDrawGroups.push_back(group);
+			}
+			++gDrawGroups.back().commandCount;
+			gIndirectCommands.push_back(UMakeIndirectCommand(gMeshPool, batch.mesh, batch.instanceCount, batch.firstInstance));
+			stats.instances += batch.instanceCount;
+			stats.vertices += static_cast<long long>(range.indexCount) * batch.instanceCount;
+			stats.triangles += static_cast<long long>(range.indexCount / 3) * batch.instanceCount;
+		}
+		const size_t commandCount = gIndirectCommands.size();
+
+		//With occlusion culling the commands start empty and are uploaded twice, once per pass; the compute shader
+		//counts in the instances it lets through. The second pass's instances go after all of the first's
+		if (gOcclusion) {
+			for (DrawElementsIndirectCommand& command : gIndirectCommands)
+				command.instanceCount = 0;
+			for (size_t i = 0; i < commandCount; ++i) {
+				DrawElementsIndirectCommand command = gIndirectCommands[i];
+				command.baseInstance += static_cast<GLuint>(gInstances.size());
+				gIndirectCommands.push_back(command);
+			}
+
+			gOcclusionCandidates.resize(gInstances.size());
+			size_t instance = 0;
+			for (size_t i = 0; i < gBatches.size(); ++i) {
+				const DrawBatch& batch = gBatches[i];
+				for (uint32_t j = 0; j < batch.instanceCount; ++j, ++instance) {
+					const uint32_t item = gRenderQueue.Commands()[instance].item;
+					OcclusionCandidate& candidate = gOcclusionCandidates[instance];
+					candidate.center = glm::vec4(gCullingBounds.centerX[item], gCullingBounds.centerY[item], gCullingBounds.centerZ[item], 0.0f);
+					candidate.extent = glm::vec4(gCullingBounds.extentX[item], gCullingBounds.extentY[item], gCullingBounds.extentZ[item], 0.0f);
+					candidate.item = item;
+					candidate.instance = static_cast<uint32_t>(instance);
+					candidate.command = static_cast<uint32_t>(i);
+				}
+			}
+			UUploadOcclusionCandidates(gOcclusionCuller, gOcclusionCandidates, gInstances.size() * 2);
+
+			//Until the first frame comes back the figures are the frustum-visible ones
+			if (gOcclusionDrawn.tested > 0) {
+				stats.instances = static_cast<int>(gOcclusionDrawn.instances);
+				stats.vertices = gOcclusionDrawn.vertices;
+				stats.triangles = gOcclusionDrawn.triangles;
+				stats.occluded = static_cast<int>(gOcclusionDrawn.tested - gOcclusionDrawn.instances);
+			}
+		}
+		UUploadIndirectCommands(gMeshPool, gIndirectCommands);
+
+		auto drawCommands = [&](size_t commandOffset) {
+			int boundFormat = -1;
+			for (const MultiDrawGroup& group : gDrawGroups) {
+				bindProgram(group.program);
+				if (group.format != boundFormat) {
+					glBindVertexArray(gMeshPool.groups[group.format].vao);
+					boundFormat = group.format;
+					++stats.vaoBinds;
+				}
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)((commandOffset + group.firstCommand) * sizeof(DrawElementsIndirectCommand)),
+					static_cast<GLsizei>(group.commandCount), 0);
+				++stats.drawCalls;
+				stats.indirectCommands += static_cast<int>(group.commandCount);
+			}
+		};
+
+		if (gOcclusion) {
+			//Pass 1 draws what was visible last frame, pass 2 what the pyramid built from pass 1's depth newly shows.
+			//The culling passes bind their own programs
+			URunOcclusionPass(gOcclusionCuller, 0, gOcclusionCandidates.size(), gInstanceBuffer.ssbo, gMeshPool.indirectBuffer, 0);
+			drawCommands(0);
+
+			UBuildHiZ(gOcclusionCuller, viewport[2], viewport[3]);
+			URunOcclusionPass(gOcclusionCuller, 1, gOcclusionCandidates.size(), gInstanceBuffer.ssbo, gMeshPool.indirectBuffer, commandCount);
+			boundProgram = 0;
+			boundDrawProgram = -1;
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gMeshPool.indirectBuffer);
+			drawCommands(commandCount);
+			UQueueOcclusionReadback(gOcclusionCuller, gMeshPool.indirectBuffer, commandCount * 2, gOcclusionCandidates.size());
+		}
+		else {
+			drawCommands(0);
+		}
 
-	glBindVertexArray(gMesh.vao[7]);
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, gMesh.nVertices[7]);
+		gRenderStats = stats;
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		glBindVertexArray(0);
+		return;
+	}
 
-	//WATCH FACE TOP
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, watchFaceTextureId);
+	//Binds are only issued when the sorted neighbour used different state
+	int boundMesh = -1;
+	for (const DrawBatch& batch : gBatches) {
+		bindProgram(batch.program);
+		if (batch.mesh != boundMesh) {
+			glBindVertexArray(gMesh.meshes[batch.mesh].vao);
+			boundMesh = batch.mesh;
+			++stats.vaoBinds;
+		}
 
-	scale = glm::scale(glm::vec3(2.0f, 2.0f, 2.0f));
-	rotation = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-	translation = glm::translate(glm::vec3(-0.3f, -0.919f, -0.22));
-	model = translation * rotation * scale;
-	modelLoc = glGetUniformLocation(gProgramId, "model");
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+		//The base instance selects this batch's slice of the instance buffer
+		const GLIndexedMesh& part = gMesh.meshes[batch.mesh];
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, part.indexCount, part.indexType, 0, batch.instanceCount, batch.firstInstance);
+		++stats.drawCalls;
+		stats.instances += batch.instanceCount;
+		stats.vertices += static_cast<long long>(part.indexCount) * batch.instanceCount;
+		stats.triangles += static_cast<long long>(part.indexCount / 3) * batch.instanceCount;
+	}
 
-	glBindVertexArray(gMesh.vao[8]);
-	glDrawArrays(GL_TRIANGLE_FAN, 0, gMesh.nVertices[8]);
+	gRenderStats = stats;
 
 	//Deactive the VAO
 	glBindVertexArray(0);
-
-	//GLFW swap buffers and poll events
-	glfwSwapBuffers(gWindow);
 }
 
-//Implement UCreateMesh
-void UCreateMesh(GLMesh &mesh){
-	// Generate cylinder geometry
-	const float pi = glm::pi<float>();
-	const int numSegments = 20; // The number of segments that make up the cylinder
-	const float radius = 0.3f;  // Radius of the cylinder
-	const float height = 1.5f;  // Height of the cylinder
-
-	// Arrays to store vertex, normal, and texture coordinate data
-	std::vector<glm::vec3> sideVertices;
-	std::vector<glm::vec3> sideNormals;
-	std::vector<glm::vec2> sideTexCoords;
-
-	// Generate side vertices, normals, and texture coordinates
-	for (int i = 0; i < numSegments; ++i) {
-		float theta1 = 2.0f * pi * static_cast<float>(i) / numSegments;
-		float theta2 = 2.0f * pi * static_cast<float>(i + 1) / numSegments;
-
-		// Calculate vertex positions for the side
-		glm::vec3 topVertex1(radius * cos(theta1), height / 2.0f, radius * sin(theta1));
-		glm::vec3 topVertex2(radius * cos(theta2), height / 2.0f, radius * sin(theta2));
-		glm::vec3 bottomVertex1(radius * cos(theta1), -height / 2.0f, radius * sin(theta1));
-		glm::vec3 bottomVertex2(radius * cos(theta2), -height / 2.0f, radius * sin(theta2));
-
-		// Calculate normal vectors for the side (lateral) surface
-		glm::vec3 sideNormal1 = glm::normalize(glm::vec3(topVertex1.x, 0.0f, topVertex1.z));
-		glm::vec3 sideNormal2 = glm::normalize(glm::vec3(topVertex2.x, 0.0f, topVertex2.z));
-
-		// Calculate texture coordinates for the side
-		float u1 = static_cast<float>(i) / numSegments;
-		float u2 = static_cast<float>(i + 1) / numSegments;
-
-		// Add vertices, normals, and texture coordinates to the arrays
-		sideVertices.push_back(topVertex1);
-		sideVertices.push_back(bottomVertex1);
-		sideVertices.push_back(topVertex2);
-		sideVertices.push_back(bottomVertex2);
-
-		sideNormals.push_back(sideNormal1);
-		sideNormals.push_back(sideNormal1);
-		sideNormals.push_back(sideNormal2);
-		sideNormals.push_back(sideNormal2);
-
-		sideTexCoords.push_back(glm::vec2(u1, 0.0f));
-		sideTexCoords.push_back(glm::vec2(u1, 1.0f));
-		sideTexCoords.push_back(glm::vec2(u2, 0.0f));
-		sideTexCoords.push_back(glm::vec2(u2, 1.0f));
-	}
+//Builds the generic shader variant, then queues the smallest variant of every material for each vertex layout its
+//draw items use, and with --precompile-shaders every variant of the manifest
+bool UCreateSceneShaders() {
+	if (!ULoadShaderTemplates(SHADER_DIRECTORY))
+		return false;
 
-	// Arrays to store vertex, normal, and texture coordinate data for the top and bottom circles
-	std::vector<glm::vec3> circleVertices;
-	std::vector<glm::vec3> circleNormals;
-	std::vector<glm::vec2> circleTexCoords;
+	function<bool()> makeCurrent;
+	function<void()> release;
+	UCreateCompilerContext(makeCurrent, release);
+	UCreateShaderVariants(gShaderVariants, gShaderCompile, makeCurrent, release);
 
-	for (int i = 0; i < numSegments; ++i) {
-		float theta = 2.0f * pi * static_cast<float>(i) / numSegments;
-		float x = radius * cos(theta);
-		float y = radius * sin(theta);
+	if (gShaderReload == 1 || (gShaderReload < 0 && !gHeadless))
+		UCreateFileWatcher(gShaderWatcher, SHADER_DIRECTORY, { SHADER_VERTEX_TEMPLATE, SHADER_FRAGMENT_TEMPLATE });
 
-		// Calculate vertex positions for the circle
-		glm::vec3 vertex(x, y, 0.0f);
+	gGenericVariant = URequestShaderVariant(gShaderVariants, UGenericShaderVariant(gShaderNormals));
+	if (!UBuildShaderVariant(gShaderVariants, gGenericVariant))
+		return false;
 
-		// Calculate normal vectors for the circle (0, 0, 1) since it's in the XY plane
-		glm::vec3 normal(0.0f, 0.0f, 1.0f);
+	int globalLights = 0;
+	bool boundedLights = false;
+	for (const SceneLight& light : gScene.lights) {
+		if (light.type == LIGHT_DIRECTIONAL || light.range <= 0.0f)
+			++globalLights;
+		else
+			boundedLights = true;
+	}
 
-		// Calculate texture coordinates
-		float u = static_cast<float>(i) / numSegments;
-		float v = 0.0f; // Texture coordinate in this case can be set to 0
+	gMaterialVariants.assign(gScene.materials.size() * 2, -1);
+	if (gSpecializedShaders) {
+		for (const DrawItem& item : gScene.drawItems) {
+			const int format = gMesh.meshes[item.mesh].format;
+			int& variant = gMaterialVariants[item.material * 2 + format];
+			if (variant >= 0)
+				continue;
+			const SceneMaterial& material = gScene.materials[item.material];
+			variant = URequestShaderVariant(gShaderVariants, USelectShaderVariant(material.texture >= 0, material.specular,
+				format == VERTEX_FORMAT_COMPACT, gShaderNormals, globalLights, boundedLights));
+		}
+	}
 
-		// Add vertices, normals, and texture coordinates to the arrays
-		circleVertices.push_back(vertex);
-		circleNormals.push_back(normal);
-		circleTexCoords.push_back(glm::vec2(u, v));
+	if (!gShaderManifest.empty()) {
+		vector<ShaderVariant> manifest;
+		if (!ULoadShaderManifest(gShaderManifest.c_str(), manifest))
+			return false;
+		for (const ShaderVariant& variant : manifest)
+			URequestShaderVariant(gShaderVariants, variant);
 	}
+	gVariantsPending = true;
+	return true;
+}
 
-	// Arrays to store vertex, normal, and texture coordinate data for the top and bottom circles
-	std::vector<glm::vec3> circleVerticesB;
-	std::vector<glm::vec3> circleNormalsB;
-	std::vector<glm::vec2> circleTexCoordsB;
+//Context in the main one's share group for the shader compile worker, when the variants may compile on it: a hidden
+//window's, or the headless context's sibling. Leaves the hooks empty otherwise
+bool UCreateCompilerContext(function<bool()>& makeCurrent, function<void()>& release) {
+	const bool driverThreads = GLEW_KHR_parallel_shader_compile != 0;
+	if (gShaderCompile == SHADER_COMPILE_MAIN || (gShaderCompile != SHADER_COMPILE_WORKER && driverThreads))
+		return false;
 
-	for (int i = 0; i < numSegments; ++i) {
-		float theta = 2.0f * pi * static_cast<float>(i) / numSegments;
-		float x = radius * cos(theta);
-		float y = radius * sin(theta);
+	if (gHeadless) {
+		if (!UCreateHeadlessSharedContext())
+			return false;
+		makeCurrent = UMakeHeadlessSharedContextCurrent;
+		release = UReleaseHeadlessSharedContext;
+		return true;
+	}
 
-		// Calculate vertex positions for the circle
-		glm::vec3 vertex(x, y, 0.0f);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	gCompilerWindow = glfwCreateWindow(1, 1, "shader compiler", NULL, gWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (gCompilerWindow == NULL) {
+		cout << "Failed to create the shader compiler's shared context" << endl;
+		return false;
+	}
+	makeCurrent = [] { glfwMakeContextCurrent(gCompilerWindow); return true; };
+	release = [] { glfwMakeContextCurrent(NULL); };
+	return true;
+}
 
-		// Calculate normal vectors for the circle (0, 0, 1) since it's in the XY plane
-		glm::vec3 normal(0.0f, 0.0f, 1.0f);
+//One line per variant once none is left compiling
+void UReportShaderVariants() {
+	int cached = 0;
+	double slowest = 0.0;
+	for (const GLShaderVariant& entry : gShaderVariants.variants) {
+		ostringstream line;
+		line << "INFO: Shader variant '" << UShaderVariantName(entry.variant) << "' " << (entry.ready ? "ready" : "failed") << " in "
+			<< fixed << setprecision(1) << entry.compileMs << " ms" << (entry.cached ? " (cached)" : "");
+		cout << line.str() << endl;
+		cached += entry.cached ? 1 : 0;
+		slowest = max(slowest, entry.compileMs);
+	}
 
-		// Calculate texture coordinates
-		float u = static_cast<float>(i) / numSegments;
-		float v = 0.0f; // Texture coordinate in this case can be set to 0
+	ostringstream summary;
+	summary << "INFO: " << gShaderVariants.variants.size() << " shader variants, " << cached << " from the program cache, "
+		<< (gShaderVariants.mode == SHADER_COMPILE_DRIVER ? "compiled on driver threads" : gShaderVariants.mode == SHADER_COMPILE_WORKER ? "compiled on a worker thread"
+			: "compiled one per frame") << ", slowest " << fixed << setprecision(1) << slowest << " ms";
+	cout << summary.str() << endl;
+}
 
-		// Add vertices, normals, and texture coordinates to the arrays
-		circleVerticesB.push_back(vertex);
-		circleNormalsB.push_back(normal);
-		circleTexCoordsB.push_back(glm::vec2(u, v));
+//Picks up edited shader templates and variants that finished compiling, marking the frame dirty when a program
+//may have changed
+void UUpdateSceneShaders() {
+	//Edited templates rebuild the variants in use; each keeps drawing with its current program until the new one links
+	if (UPollFileWatcher(gShaderWatcher) && UReloadShaderVariants(gShaderVariants, SHADER_DIRECTORY) > 0)
+		gShadersReloading = true;
+
+	//Variants still compiling in the background are picked up as they finish; until then their draws use the
+	//generic one
+	if ((gVariantsPending || gShadersReloading) && UPollShaderVariants(gShaderVariants, false) == 0) {
+		if (gVariantsPending)
+			UReportShaderVariants();
+		gVariantsPending = gShadersReloading = false;
 	}
 
-	//CAP
-	// Generate cylinder geometry
-	const int numSegmentsB = 20; // The number of segments that make up the cylinder
-	const float radiusB = 0.075f;  // Radius of the cylinder
-	const float heightB = 0.075f;  // Height of the cylinder
-
-	// Arrays to store vertex, normal, and texture coordinate data
-	std::vector<glm::vec3> sideVerticesB;
-	std::vector<glm::vec3> sideNormalsB;
-	std::vector<glm::vec2> sideTexCoordsB;
-
-	// Generate side vertices, normals, and texture coordinates
-	for (int i = 0; i < numSegmentsB; ++i) {
-		float theta1 = 2.0f * pi * static_cast<float>(i) / numSegmentsB;
-		float theta2 = 2.0f * pi * static_cast<float>(i + 1) / numSegmentsB;
-
-		// Calculate vertex positions for the side
-		glm::vec3 topVertex1(radiusB * cos(theta1), heightB / 2.0f, radiusB * sin(theta1));
-		glm::vec3 topVertex2(radiusB * cos(theta2), heightB / 2.0f, radiusB * sin(theta2));
-		glm::vec3 bottomVertex1(radiusB * cos(theta1), -heightB / 2.0f, radiusB * sin(theta1));
-		glm::vec3 bottomVertex2(radiusB * cos(theta2), -heightB / 2.0f, radiusB * sin(theta2));
-
-		// Calculate normal vectors for the side (lateral) surface
-		glm::vec3 sideNormal1 = glm::normalize(glm::vec3(topVertex1.x, 0.0f, topVertex1.z));
-		glm::vec3 sideNormal2 = glm::normalize(glm::vec3(topVertex2.x, 0.0f, topVertex2.z));
-
-		// Calculate texture coordinates for the side
-		float u1 = static_cast<float>(i) / numSegmentsB;
-		float u2 = static_cast<float>(i + 1) / numSegmentsB;
-
-		// Add vertices, normals, and texture coordinates to the arrays
-		sideVerticesB.push_back(topVertex1);
-		sideVerticesB.push_back(bottomVertex1);
-		sideVerticesB.push_back(topVertex2);
-		sideVerticesB.push_back(bottomVertex2);
-
-		sideNormalsB.push_back(sideNormal1);
-		sideNormalsB.push_back(sideNormal1);
-		sideNormalsB.push_back(sideNormal2);
-		sideNormalsB.push_back(sideNormal2);
-
-		sideTexCoordsB.push_back(glm::vec2(u1, 0.0f));
-		sideTexCoordsB.push_back(glm::vec2(u1, 1.0f));
-		sideTexCoordsB.push_back(glm::vec2(u2, 0.0f));
-		sideTexCoordsB.push_back(glm::vec2(u2, 1.0f));
+	if (gShaderVariants.builds != gShaderBuilds) {
+		gShaderBuilds = gShaderVariants.builds;
+		gFrameDirty |= FRAME_DIRTY_ASSETS;
 	}
+}
 
-	// Arrays to store vertex, normal, and texture coordinate data for the top and bottom circles
-	std::vector<glm::vec3> circleVerticesC;
-	std::vector<glm::vec3> circleNormalsC;
-	std::vector<glm::vec2> circleTexCoordsC;
-
-	for (int i = 0; i < numSegments; ++i) {
-		float theta = 2.0f * pi * static_cast<float>(i) / numSegments;
-		float x = radiusB * cos(theta);
-		float y = radiusB * sin(theta);
-
-		// Calculate vertex positions for the circle
-		glm::vec3 vertex(x, y, 0.0f);
+//Sort key program of a draw: its material's shader variant for the mesh's vertex layout (the generic one when
+//--shader-variants=generic), times two, plus the layout, so draws in one program run never mix layouts
+int UDrawProgram(int material, int format) {
+	int variant = gMaterialVariants[material * 2 + format];
+	if (variant < 0)
+		variant = gGenericVariant;
+	return variant * 2 + format;
+}
 
-		// Calculate normal vectors for the circle (0, 0, 1) since it's in the XY plane
-		glm::vec3 normal(0.0f, 0.0f, 1.0f);
+//Adds a stretch of the render loop to the CPU usage the stats report
+void UAddCpuUsage(bool idle, double wallSeconds, double cpuSeconds) {
+	for (CpuUsage* usage : { &gOverlayCpu, &gRunCpu }) {
+		(idle ? usage->idleWall : usage->busyWall) += wallSeconds;
+		(idle ? usage->idleCpu : usage->busyCpu) += cpuSeconds;
+	}
+}
 
-		// Calculate texture coordinates
-		float u = static_cast<float>(i) / numSegments;
-		float v = 0.0f; // Texture coordinate in this case can be set to 0
+//Shows frame rate, process CPU use and render queue counters in the window title, refreshed twice a second. On
+//demand the CPU use while no frame was drawn is shown as well
+void UUpdateStatsOverlay(float currentTime, bool drewFrame) {
+	if (drewFrame)
+		++gOverlayFrames;
+
+	float elapsed = currentTime - gOverlayLastUpdate;
+	if (elapsed < 0.5f)
+		return;
+
+	const double wall = gOverlayCpu.busyWall + gOverlayCpu.idleWall;
+	ostringstream title;
+	title << WINDOW_TITLE << " | " << fixed << setprecision(1) << gOverlayFrames / elapsed << " fps"
+		<< " | CPU " << (wall > 0.0 ? 100.0 * (gOverlayCpu.busyCpu + gOverlayCpu.idleCpu) / wall : 0.0) << "%";
+	if (gRenderOnDemand)
+		title << ", idle " << (gOverlayCpu.idleWall > 0.0 ? 100.0 * gOverlayCpu.idleCpu / gOverlayCpu.idleWall : 0.0) << "%";
+	title << " | " << gRenderStats.drawCalls << " draws";
+	if (gMultiDraw)
+		title << " (" << gRenderStats.indirectCommands << " indirect)";
+	title << " | " << gRenderStats.visible << " visible, " << gRenderStats.culled << " culled";
+	if (gOcclusion)
+		title << ", " << gRenderStats.occluded << " occluded";
+	title << " | " << gRenderStats.instances << " instances, " << gRenderStats.triangles << " triangles"
+		<< " | " << gRenderStats.StateChanges() << " state changes"
+		<< " (" << gRenderStats.textureBinds << " tex, " << gRenderStats.vaoBinds << " vao)"
+		<< " | " << gRenderStats.lights << " lights";
+	glfwSetWindowTitle(gWindow, title.str().c_str());
+
+	gOverlayLastUpdate = currentTime;
+	gOverlayFrames = 0;
+	gOverlayCpu = CpuUsage();
+}
 
-		// Add vertices, normals, and texture coordinates to the arrays
-		circleVerticesC.push_back(vertex);
-		circleNormalsC.push_back(normal);
-		circleTexCoordsC.push_back(glm::vec2(u, v));
-	}
+//Nearest draw item under a point given in normalised device coordinates, using the last frame's camera. The
+//hierarchy narrows the search to items whose world box the ray crosses; those are tested against their mesh box in
+//object space, which follows the item's rotation. Returns -1 when the ray hits nothing
+int UPickDrawItem(float ndcX, float ndcY, float& distance) {
+	const glm::mat4 toWorld = glm::inverse(gFrameProjection * gFrameView);
+	glm::vec4 nearPoint = toWorld * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+	glm::vec4 farPoint = toWorld * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+	const glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+	const glm::vec3 end = glm::vec3(farPoint) / farPoint.w;
+	const float length = glm::length(end - origin);
+	const glm::vec3 direction = (end - origin) / length;
+
+	//The object-space ray keeps the world ray's parameter, so hit distances compare directly
+	auto hitDistance = [&](uint32_t i) {
+		const DrawItem& item = gScene.drawItems[i];
+		const MeshBounds& bounds = gMesh.meshes[item.mesh].bounds;
+		const glm::mat4 toObject = glm::inverse(item.world);
+		const glm::vec3 objectOrigin = glm::vec3(toObject * glm::vec4(origin, 1.0f));
+		const glm::vec3 objectDirection = glm::vec3(toObject * glm::vec4(direction, 0.0f));
+		return URayBox(bounds.min, bounds.max, objectOrigin, 1.0f / objectDirection, length);
+	};
+	return URaycastBvh(gBvh, gCullingBounds, origin, direction, length, hitDistance, distance);
+}
 
+//Implement UCreateMesh
+void UCreateMesh(GLMesh &mesh, const vector<bool>& compactMeshes){
 	//Position, texture and normal data
 	GLfloat pyramidVerts[] = {
 		//Vertex Positions		//Texture coords		//Normal Coords
@@ -1096,401 +1588,126 @@ void UCreateMesh(GLMesh &mesh){
 		-0.1f, -0.02f, -2.0f,  1.0f, 0.0f,				0.0f, -1.0f, 0.0f		//  7 bl back
 	};
 
-	const GLuint floatsPerVertex = 3;
-	const GLuint floatsPerUV = 2;
-	const GLuint floatsPerNormal = 3;
-
-	mesh.nVertices[0] = sizeof(pyramidVerts) / sizeof(pyramidVerts[0]) * (floatsPerVertex + floatsPerUV);
-	mesh.nVertices[1] = sizeof(cubeVerts) / sizeof(cubeVerts[0]) * (floatsPerVertex + floatsPerUV);
-	mesh.nVertices[2] = sizeof(planeVerts) / sizeof(planeVerts[0]) * (floatsPerVertex + floatsPerUV);
-	mesh.nVertices[3] = sizeof(boxVerts) / sizeof(boxVerts[0]) * (floatsPerVertex + floatsPerUV);
-	mesh.nVertices[4] = sideVertices.size();
-	mesh.nVertices[5] = circleVertices.size();
-	mesh.nVertices[6] = circleVerticesB.size();
-	mesh.nVertices[7] = sideVerticesB.size();
-	mesh.nVertices[8] = circleNormalsC.size();
-	mesh.nVertices[9] = sizeof(watchVerts) / sizeof(watchVerts[0]) * (floatsPerVertex + floatsPerUV);
-	mesh.nVertices[10] = sizeof(watchVerts) / sizeof(watchVerts[0]) * (floatsPerVertex + floatsPerUV);
-
-	//Strides between vertex coordinates is 6(x, y, z, r, g, b, a)
-	GLint stride = sizeof(float) * (floatsPerVertex + floatsPerUV + floatsPerNormal);
-
-#pragma region Pyramid
-	//Vertex Array for Pyramid
-	glGenVertexArrays(1, &mesh.vao[0]);
-	glGenBuffers(1, &mesh.vbos[0]);
-	glBindVertexArray(mesh.vao[0]);
-
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]); //Activate
-	glBufferData(GL_ARRAY_BUFFER, sizeof(pyramidVerts), pyramidVerts, GL_STATIC_DRAW);
-
-	//Create vertex attribute pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(1);
-
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float) * floatsPerVertex));
-	glEnableVertexAttribArray(2);
-#pragma endregion
-
-#pragma region Cube
-	//Vertex Array for Cube
-	glGenVertexArrays(1, &mesh.vao[1]);
-	glGenBuffers(1, &mesh.vbos[1]);
-	glBindVertexArray(mesh.vao[1]);
-
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[1]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVerts), cubeVerts, GL_STATIC_DRAW);
-
-	//Create vertex attribute pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(1);
-
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float) * floatsPerVertex));
-	glEnableVertexAttribArray(2);
-
-#pragma endregion
-
-#pragma region Plane
-	//Vertex Array for Plane
-	glGenVertexArrays(1, &mesh.vao[2]);
-	glGenBuffers(1, &mesh.vbos[2]);
-	glBindVertexArray(mesh.vao[2]);
-
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[2]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(planeVerts), planeVerts, GL_STATIC_DRAW);
-
-	//Create vertex attribute pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(1);
-
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(2);
-
-#pragma endregion
-
-#pragma region Box
-	//Vertex Array for Plane
-	glGenVertexArrays(1, &mesh.vao[3]);
-	glGenBuffers(1, &mesh.vbos[3]);
-	glBindVertexArray(mesh.vao[3]);
-
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[3]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(boxVerts), boxVerts, GL_STATIC_DRAW);
-
-	//Create vertex attribute pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
-
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(1);
-
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(2);
-
-#pragma endregion
-
-#pragma region Bottle Body
-	//Vertex Array for Bottle
-	glGenVertexArrays(1, &mesh.vao[4]);
-	glGenBuffers(1, &mesh.vbos[4]);
-	glBindVertexArray(mesh.vao[4]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[4]);
-
-	// Load vertex data into the VBO
-	glBufferData(GL_ARRAY_BUFFER, sideVertices.size() * sizeof(glm::vec3), &sideVertices[0], GL_STATIC_DRAW);
-
-	// Set up attribute pointers
-	// Vertex positons
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	//Normals
-	glGenBuffers(1, &mesh.vbos[5]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[5]);
-	glBufferData(GL_ARRAY_BUFFER, sideNormals.size() * sizeof(glm::vec3), &sideNormals[0], GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	//Texture
-	glGenBuffers(1, &mesh.vbos[6]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[6]);
-	glBufferData(GL_ARRAY_BUFFER, sideTexCoords.size() * sizeof(glm::vec2), &sideTexCoords[0], GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-#pragma endregion
-
-#pragma region Bottle Top and Bottom
-	// Vertex Array for top circle
-	glGenVertexArrays(1, &mesh.vao[5]);
-	glGenBuffers(1, &mesh.vbos[7]);
-	glBindVertexArray(mesh.vao[5]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[7]);
-
-	// Load vertex data into the VBO
-	glBufferData(GL_ARRAY_BUFFER, circleVertices.size() * sizeof(glm::vec3), &circleVertices[0], GL_STATIC_DRAW);
-
-	// Set up attribute pointers
-	// Vertex positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	// Normals
-	glGenBuffers(1, &mesh.vbos[8]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[8]);
-	glBufferData(GL_ARRAY_BUFFER, circleNormals.size() * sizeof(glm::vec3), &circleNormals[0], GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	// Texture
-	glGenBuffers(1, &mesh.vbos[9]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[9]);
-	glBufferData(GL_ARRAY_BUFFER, circleTexCoords.size() * sizeof(glm::vec2), &circleTexCoords[0], GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-	// Vertex Array for bottom circle
-	glGenVertexArrays(1, &mesh.vao[6]);
-	glGenBuffers(1, &mesh.vbos[10]);
-	glBindVertexArray(mesh.vao[6]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[10]);
-
-	// Load vertex data into the VBO
-	glBufferData(GL_ARRAY_BUFFER, circleVerticesB.size() * sizeof(glm::vec3), &circleVerticesB[0], GL_STATIC_DRAW);
-
-	// Set up attribute pointers
-	// Vertex positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	// Normals
-	glGenBuffers(1, &mesh.vbos[11]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[11]);
-	glBufferData(GL_ARRAY_BUFFER, circleNormalsB.size() * sizeof(glm::vec3), &circleNormalsB[0], GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	// Texture
-	glGenBuffers(1, &mesh.vbos[12]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[12]);
-	glBufferData(GL_ARRAY_BUFFER, circleTexCoordsB.size() * sizeof(glm::vec2), &circleTexCoordsB[0], GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-#pragma endregion
-
-#pragma region Cap Body
-	//Vertex Array for Bottle
-	glGenVertexArrays(1, &mesh.vao[7]);
-	glGenBuffers(1, &mesh.vbos[13]);
-	glBindVertexArray(mesh.vao[7]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[13]);
-
-	// Load vertex data into the VBO
-	glBufferData(GL_ARRAY_BUFFER, sideVerticesB.size() * sizeof(glm::vec3), &sideVerticesB[0], GL_STATIC_DRAW);
-
-	// Set up attribute pointers
-	// Vertex positons
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	//Normals
-	glGenBuffers(1, &mesh.vbos[14]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[14]);
-	glBufferData(GL_ARRAY_BUFFER, sideNormalsB.size() * sizeof(glm::vec3), &sideNormalsB[0], GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	//Texture
-	glGenBuffers(1, &mesh.vbos[15]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[15]);
-	glBufferData(GL_ARRAY_BUFFER, sideTexCoordsB.size() * sizeof(glm::vec2), &sideTexCoordsB[0], GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-#pragma endregion
-
-#pragma region CAP Top
-	// Vertex Array for top circle
-	glGenVertexArrays(1, &mesh.vao[8]);
-	glGenBuffers(1, &mesh.vbos[16]);
-	glBindVertexArray(mesh.vao[8]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[16]);
-
-	// Load vertex data into the VBO
-	glBufferData(GL_ARRAY_BUFFER, circleVerticesC.size() * sizeof(glm::vec3), &circleVerticesC[0], GL_STATIC_DRAW);
-
-	// Set up attribute pointers
-	// Vertex positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	// Normals
-	glGenBuffers(1, &mesh.vbos[17]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[17]);
-	glBufferData(GL_ARRAY_BUFFER, circleNormalsC.size() * sizeof(glm::vec3), &circleNormalsC[0], GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	// Texture
-	glGenBuffers(1, &mesh.vbos[18]);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[18]);
-	glBufferData(GL_ARRAY_BUFFER, circleTexCoordsC.size() * sizeof(glm::vec2), &circleTexCoordsC[0], GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-#pragma endregion
-
-#pragma region Watch Hands
-	//Vertex Array for Plane
-	glGenVertexArrays(1, &mesh.vao[9]);
-	glGenBuffers(1, &mesh.vbos[19]);
-	glBindVertexArray(mesh.vao[9]);
+	//Hand-written tables, laid out position (3), texture coordinate (2), normal (3) per vertex
+	map<string, MeshData> tableMeshes;
+	tableMeshes["pyramid"] = UMeshFromInterleaved(pyramidVerts, sizeof(pyramidVerts) / sizeof(pyramidVerts[0]));
+	tableMeshes["cube"] = UMeshFromInterleaved(cubeVerts, sizeof(cubeVerts) / sizeof(cubeVerts[0]));
+	tableMeshes["plane"] = UMeshFromInterleaved(planeVerts, sizeof(planeVerts) / sizeof(planeVerts[0]));
+	tableMeshes["box"] = UMeshFromInterleaved(boxVerts, sizeof(boxVerts) / sizeof(boxVerts[0]));
+	tableMeshes["watchHand"] = UMeshFromInterleaved(watchVerts, sizeof(watchVerts) / sizeof(watchVerts[0]));
+
+	//Everything else comes from the primitive library (see PrimitiveDesc for what size means per shape). Meshes
+	//that are measured at their authored detail turn levels of detail off
+	const map<string, PrimitiveMesh> primitiveMeshes = {
+		{ "bottleBody",		{ { PRIMITIVE_CYLINDER, glm::vec3(0.3f, 1.5f, 0.0f), 20, 1, false }, true } },
+		{ "bottleTop",		{ { PRIMITIVE_DISC, glm::vec3(0.3f, 0.0f, 0.0f), 20, 1, false }, true } },
+		{ "bottleBottom",	{ { PRIMITIVE_DISC, glm::vec3(0.3f, 0.0f, 0.0f), 20, 1, false }, true } },
+		{ "capBody",		{ { PRIMITIVE_CYLINDER, glm::vec3(0.075f, 0.075f, 0.0f), 20, 1, false }, true } },
+		{ "capTop",			{ { PRIMITIVE_DISC, glm::vec3(0.075f, 0.0f, 0.0f), 20, 1, false }, true } },
+		{ "denseCylinder",	{ { PRIMITIVE_CYLINDER, glm::vec3(0.5f, 1.0f, 0.0f), 256, 128, false }, false } },	//Vertex throughput benchmark (scenes/cylinders.scene)
+		{ "cylinder",		{ { PRIMITIVE_CYLINDER, glm::vec3(0.5f, 1.0f, 0.0f), 32, 1, true }, true } },
+		{ "disc",			{ { PRIMITIVE_DISC, glm::vec3(0.5f, 0.0f, 0.0f), 32, 1, false }, true } },
+		{ "cone",			{ { PRIMITIVE_CONE, glm::vec3(0.5f, 1.0f, 0.0f), 32, 4, true }, true } },
+		{ "cuboid",			{ { PRIMITIVE_BOX, glm::vec3(1.0f), 1, 1, false }, true } },
+		{ "squarePyramid",	{ { PRIMITIVE_PYRAMID, glm::vec3(1.0f), 1, 1, false }, true } },
+		{ "sphere",			{ { PRIMITIVE_SPHERE, glm::vec3(0.5f, 0.0f, 0.0f), 32, 16, false }, true } },
+		{ "torus",			{ { PRIMITIVE_TORUS, glm::vec3(0.35f, 0.15f, 0.0f), 32, 16, false }, true } }
+	};
 
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[19]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(watchVerts), watchVerts, GL_STATIC_DRAW);
+	//Names with the same primitive description and vertex layout are generated and uploaded once
+	map<pair<PrimitiveDesc, VertexFormat>, int> primitiveCache;
+
+	//Welds, cache-optimises and uploads one mesh, returning its meshes entry
+	auto upload = [&](MeshData& part, size_t sourceVertices, VertexFormat format, const string& name) {
+		MeshBuildStats stats = UBuildIndexedMesh(part, sourceVertices);
+		GLIndexedMesh uploaded;
+		UUploadIndexedMesh(part, format, uploaded);
+		mesh.meshes.push_back(uploaded);
+
+		ostringstream report;
+		report << "INFO: Mesh " << name << ": " << stats.sourceVertices << " -> " << stats.vertices << " vertices, "
+			<< stats.triangles << " triangles, ACMR " << fixed << setprecision(3)
+			<< stats.sourceAcmr << " (arrays) -> " << stats.weldedAcmr << " (indexed) -> " << stats.optimizedAcmr << " (optimized), "
+			<< uploaded.vertexBytes << " bytes per vertex";
+		cout << report.str() << endl;
+
+		//Validation measures the compact encoding whether or not the mesh uses it
+		if (gValidateVertices) {
+			VertexEncodingError error = UMeasureCompactError(part);
+			ostringstream validation;
+			validation << "INFO: Mesh " << name << " compact error: position " << scientific << setprecision(2) << error.position
+				<< ", normal " << fixed << setprecision(3) << error.normalDegrees << " degrees, uv " << scientific << setprecision(2) << error.uv;
+			cout << validation.str() << endl;
+		}
+		return static_cast<int>(mesh.meshes.size() - 1);
+	};
 
-	//Create vertex attribute pointers
-	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(0);
+	//Generated and uploaded on first use; drawing a generated primitive without indices would have submitted one
+	//vertex per index
+	auto primitiveEntry = [&](const PrimitiveDesc& desc, VertexFormat format, const string& name) {
+		auto cached = primitiveCache.find(make_pair(desc, format));
+		if (cached != primitiveCache.end())
+			return cached->second;
+		MeshData part = UGeneratePrimitive(desc);
+		const int entry = upload(part, part.indices.size(), format, name);
+		primitiveCache[make_pair(desc, format)] = entry;
+		return entry;
+	};
 
-	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(1);
+	//Every mesh becomes a welded, cache-optimised indexed triangle list with interleaved attributes
+	mesh.meshOfName.assign(MESH_NAMES.size(), -1);
+	map<int, MeshLodChain> lods;
+	for (size_t i = 0; i < MESH_NAMES.size(); ++i) {
+		VertexFormat format = compactMeshes[i] ? VERTEX_FORMAT_COMPACT : VERTEX_FORMAT_FULL;
+
+		auto primitive = primitiveMeshes.find(MESH_NAMES[i]);
+		if (primitive == primitiveMeshes.end()) {
+			MeshData part = move(tableMeshes[MESH_NAMES[i]]);
+			mesh.meshOfName[i] = upload(part, part.vertices.size(), format, MESH_NAMES[i]);
+			continue;
+		}
 
-	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float)* floatsPerVertex));
-	glEnableVertexAttribArray(2);
+		const PrimitiveDesc& desc = primitive->second.desc;
+		auto cached = primitiveCache.find(make_pair(desc, format));
+		if (cached != primitiveCache.end()) {
+			mesh.meshOfName[i] = cached->second;
+			size_t owner = find(mesh.meshOfName.begin(), mesh.meshOfName.end(), cached->second) - mesh.meshOfName.begin();
+			if (owner < i)
+				cout << "INFO: Mesh " << MESH_NAMES[i] << ": same primitive as " << MESH_NAMES[owner] << ", sharing its buffers" << endl;
+			else
+				cout << "INFO: Mesh " << MESH_NAMES[i] << ": same primitive as a level of detail, sharing its buffers" << endl;
+		}
+		else {
+			mesh.meshOfName[i] = primitiveEntry(desc, format, MESH_NAMES[i]);
+		}
 
-#pragma endregion
+		//Round primitives are also built at every level of detail unless their entry turns it off; the authored mesh
+		//is kept for --no-lod
+		if (gLevelOfDetail && primitive->second.lod && UPrimitiveHasLod(desc) && lods.count(mesh.meshOfName[i]) == 0) {
+			MeshLodChain chain;
+			for (int level = 0; level < LOD_LEVELS; ++level)
+				chain.meshes[level] = primitiveEntry(ULodPrimitive(desc, level), format, MESH_NAMES[i] + " lod " + to_string(LOD_SEGMENTS[level]));
+			chain.count = LOD_LEVELS;
+			const MeshBounds& bounds = mesh.meshes[mesh.meshOfName[i]].bounds;
+			chain.radius = max(max(-bounds.min.x, bounds.max.x), max(-bounds.min.z, bounds.max.z));
+			lods[mesh.meshOfName[i]] = chain;
+		}
+	}
 
+	mesh.lods.assign(mesh.meshes.size(), MeshLodChain());
+	for (const auto& lod : lods)
+		mesh.lods[lod.first] = lod.second;
 }
 
 
 
 void UDestroyMesh(GLMesh &mesh){
-	glDeleteVertexArrays(10, mesh.vao);
-	glDeleteBuffers(10, mesh.vbos);
-}
-
-bool UCreateTexture(const char* fileName, GLuint& textureId) {
-	int width, height, channels;
-	unsigned char* image = stbi_load(fileName, &width, &height, &channels, 0);
-	if (image) {
-		flipImageVertically(image, width, height, channels);
-
-		glGenTextures(1, &textureId);
-		glBindTexture(GL_TEXTURE_2D, textureId);
-
-		//Texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		//Texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		if (channels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		else if (channels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			cout << "Not implemented to handle image with " << channels << " channels" << endl;
-			return false;
-		}
-
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture.
-
-		return true;
-	}
-
-	// Error loading the image
-	return false;
+	for (GLIndexedMesh& part : mesh.meshes)
+		UDestroyIndexedMesh(part);
+	mesh.meshes.clear();
 }
 
 void UDestroyTexture(GLuint textureId)
 {
-	glGenTextures(1, &textureId);
+	glDeleteTextures(1, &textureId);
 }
-
-//Implements UCreateShaders
-bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint &programId){
-	//Compilation and linkage error report
-	int success = 0;
-	char infoLog[512];
-
-	//Create shader program object
-	programId = glCreateProgram();
-
-	//Create vertex and fragment shader objects
-	GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-	GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-
-	//Retrive source code
-	glShaderSource(vertexShaderId, 1, &vtxShaderSource, NULL);
-	glShaderSource(fragmentShaderId, 1, &fragShaderSource, NULL);
-
-	//Compile vertex shader and report errors
-	glCompileShader(vertexShaderId);
-
-	glGetShaderiv(vertexShaderId, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(vertexShaderId, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-
-		return false;
-	}
-
-	//Compile fragment shader and report errors
-	glCompileShader(fragmentShaderId);
-
-	glGetShaderiv(fragmentShaderId, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(fragmentShaderId, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-
-		return false;
-	}
-
-	//Attach compiled shaders to program
-	glAttachShader(programId, vertexShaderId);
-	glAttachShader(programId, fragmentShaderId);
-
-	glLinkProgram(programId);		//Link shader program
-	//Check for errors
-	glGetProgramiv(programId, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(programId, sizeof(infoLog), NULL, infoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-
-		return false;
-	}
-
-	glUseProgram(programId);		//Use shader program
-
-	return true;
-}
-
-void UDestroyShaderProgram(GLuint programId) {
-	glDeleteProgram(programId);
-}
\ No newline at end of file
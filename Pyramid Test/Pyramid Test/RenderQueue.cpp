@@ -0,0 +1,67 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+void RenderQueue::Clear() {
+	commands.clear();
+}
+
+void RenderQueue::Push(uint64_t key, uint32_t item, uint32_t program) {
+	RenderCommand command;
+	command.key = key;
+	command.item = item;
+	command.program = program;
+	commands.push_back(command);
+}
+
+void RenderQueue::Sort() {
+	const size_t count = commands.size();
+	if (count < 2)
+		return;
+
+	scratch.resize(count);
+	RenderCommand* source = commands.data();
+	RenderCommand* destination = scratch.data();
+
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t histogram[256];
+		memset(histogram, 0, sizeof(histogram));
+		for (size_t i = 0; i < count; ++i)
+			++histogram[(source[i].key >> shift) & 0xFF];
+
+		//All keys share this byte, so the pass would not move anything
+		if (histogram[(source[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		size_t offset = 0;
+		for (int bucket = 0; bucket < 256; ++bucket) {
+			size_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+			destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+
+		swap(source, destination);
+	}
+
+	//An odd number of executed passes leaves the result in the scratch buffer
+	if (source != commands.data())
+		commands.swap(scratch);
+}
+
+uint64_t UMakeSortKey(uint32_t program, uint32_t texture, uint32_t mesh, float viewDepth, float farPlane) {
+	const uint64_t depthMax = (1ull << SORT_KEY_DEPTH_BITS) - 1;
+	float normalized = min(max(viewDepth / farPlane, 0.0f), 1.0f);
+	uint64_t depth = static_cast<uint64_t>(normalized * depthMax);
+
+	uint64_t key = program & ((1u << SORT_KEY_PROGRAM_BITS) - 1);
+	key = (key << SORT_KEY_TEXTURE_BITS) | (texture & ((1u << SORT_KEY_TEXTURE_BITS) - 1));
+	key = (key << SORT_KEY_MESH_BITS) | (mesh & ((1u << SORT_KEY_MESH_BITS) - 1));
+	key = (key << SORT_KEY_DEPTH_BITS) | depth;
+	return key;
+}
@@ -0,0 +1,67 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+//Sort key layout, most significant first: program | texture | mesh (VAO) | front-to-back depth.
+//Sorting by key groups draws that share state so the submit loop can skip redundant binds.
+const int SORT_KEY_PROGRAM_BITS = 8;
+const int SORT_KEY_TEXTURE_BITS = 16;
+const int SORT_KEY_MESH_BITS = 16;
+const int SORT_KEY_DEPTH_BITS = 24;
+
+struct RenderCommand {
+	uint64_t key;
+	uint32_t item;		//Index of the draw item this command submits
+	uint32_t program;	//Draw program it binds, whole; the key keeps only the low SORT_KEY_PROGRAM_BITS for ordering
+};
+
+//Per-frame submission counters shown in the stats overlay and written to benchmark JSON
+struct RenderStats {
+	int drawCalls = 0;
+	int indirectCommands = 0;	//Draws issued through the multi-draw-indirect calls counted in drawCalls
+	int instances = 0;			//With occlusion culling, the instances drawn, read back a few frames late
+	long long vertices = 0;		//Vertices submitted, summed over instances
+	long long triangles = 0;
+	int programBinds = 0;
+	int textureBinds = 0;
+	int vaoBinds = 0;
+	int lights = 0;
+	int lightAssignments = 0;	//Entries in the clustered light index list
+	int visible = 0;			//Draw items that passed frustum culling
+	int culled = 0;
+	double cullMs = 0.0;
+	int occluded = 0;			//Instances the Hi-Z test hid, read back a few frames late
+
+	int StateChanges() const { return programBinds + textureBinds + vaoBinds; }
+};
+
+//Run of sorted commands sharing a program and mesh, submitted as one instanced draw; each instance picks its
+//texture layer
+struct DrawBatch {
+	int mesh = 0;
+	int program = 0;		//Draw program of its commands
+	uint32_t firstInstance = 0;
+	uint32_t instanceCount = 0;
+};
+
+class RenderQueue {
+public:
+	void Clear();
+	void Push(uint64_t key, uint32_t item, uint32_t program);
+
+	//LSD radix sort on the 64-bit key, 8 bits per pass; passes where every key has the same byte are skipped
+	void Sort();
+
+	const std::vector<RenderCommand>& Commands() const { return commands; }
+
+private:
+	std::vector<RenderCommand> commands;
+	std::vector<RenderCommand> scratch;
+};
+
+//Builds a key from dense state indices and the view-space depth (distance along the view direction)
+uint64_t UMakeSortKey(uint32_t program, uint32_t texture, uint32_t mesh, float viewDepth, float farPlane);
+
+#endif
@@ -0,0 +1,404 @@
+#include "Scene.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+	int FindByName(const vector<string>& names, const string& name) {
+		for (size_t i = 0; i < names.size(); ++i) {
+			if (names[i] == name)
+				return static_cast<int>(i);
+		}
+		return -1;
+	}
+
+	int FindTexture(const Scene& scene, const string& name) {
+		for (size_t i = 0; i < scene.textures.size(); ++i) {
+			if (scene.textures[i].name == name)
+				return static_cast<int>(i);
+		}
+		return -1;
+	}
+
+	int FindMaterial(const Scene& scene, const string& name) {
+		for (size_t i = 0; i < scene.materials.size(); ++i) {
+			if (scene.materials[i].name == name)
+				return static_cast<int>(i);
+		}
+		return -1;
+	}
+
+	//Reads optional transform/parent attributes after the node header; returns false on a malformed attribute
+	bool ParseNodeAttributes(istringstream& in, const Scene& scene, SceneNode& node, string& error) {
+		string attribute;
+		while (in >> attribute) {
+			bool ok = true;
+			if (attribute == "translate")
+				ok = static_cast<bool>(in >> node.translation.x >> node.translation.y >> node.translation.z);
+			else if (attribute == "rotate")
+				ok = static_cast<bool>(in >> node.rotationDegrees >> node.rotationAxis.x >> node.rotationAxis.y >> node.rotationAxis.z);
+			else if (attribute == "scale")
+				ok = static_cast<bool>(in >> node.scale.x >> node.scale.y >> node.scale.z);
+			else if (attribute == "parent") {
+				string parentName;
+				ok = static_cast<bool>(in >> parentName);
+				node.parent = UFindSceneNode(scene, parentName);
+				if (ok && node.parent < 0) {
+					error = "parent " + parentName + " must be declared before " + node.name;
+					return false;
+				}
+			}
+			else
+				ok = false;
+
+			if (!ok) {
+				error = "bad node attribute '" + attribute + "'";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//Appends a node, creating its draw item unless meshName is "-"
+	bool AddNode(Scene& scene, SceneNode node, const vector<string>& meshNames, const string& meshName, const string& materialName, string& error) {
+		if (meshName != "-") {
+			DrawItem item;
+			item.mesh = FindByName(meshNames, meshName);
+			item.material = FindMaterial(scene, materialName);
+			item.node = static_cast<int>(scene.nodes.size());
+
+			if (item.mesh < 0 || item.material < 0) {
+				error = "unknown mesh '" + meshName + "' or material '" + materialName + "'";
+				return false;
+			}
+			item.texture = scene.materials[item.material].texture;
+
+			node.drawItem = static_cast<int>(scene.drawItems.size());
+			scene.drawItems.push_back(item);
+		}
+
+		scene.nodes.push_back(node);
+		return true;
+	}
+
+	//Reads optional material attributes after the material header
+	bool ParseMaterialAttributes(istringstream& in, SceneMaterial& material, string& error) {
+		string attribute;
+		while (in >> attribute) {
+			bool ok = true;
+			if (attribute == "color")
+				ok = static_cast<bool>(in >> material.color.r >> material.color.g >> material.color.b);
+			else if (attribute == "specular") {
+				string value;
+				ok = static_cast<bool>(in >> value) && (value == "on" || value == "off");
+				material.specular = value == "on";
+			}
+			else
+				ok = false;
+
+			if (!ok) {
+				error = "bad material attribute '" + attribute + "'";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//Reads optional light attributes after the light header
+	bool ParseLightAttributes(istringstream& in, SceneLight& light, string& error) {
+		string attribute;
+		while (in >> attribute) {
+			bool ok = true;
+			if (attribute == "range")
+				ok = static_cast<bool>(in >> light.range) && light.range >= 0.0f;
+			else if (attribute == "ambient")
+				ok = static_cast<bool>(in >> light.ambient);
+			else if (attribute == "specular")
+				ok = static_cast<bool>(in >> light.specular);
+			else if (attribute == "highlight")
+				ok = static_cast<bool>(in >> light.highlight);
+			else
+				ok = false;
+
+			if (!ok) {
+				error = "bad light attribute '" + attribute + "'";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//Evenly spaced saturated colours so neighbouring lights in an array are easy to tell apart
+	glm::vec3 HueColor(float hue) {
+		glm::vec3 color;
+		for (int channel = 0; channel < 3; ++channel) {
+			float h = fmod(hue * 6.0f + (6 - channel * 2) % 6, 6.0f);
+			color[channel] = glm::clamp(fabs(h - 3.0f) - 1.0f, 0.0f, 1.0f);
+		}
+		return color;
+	}
+
+	glm::mat4 LocalMatrix(const SceneNode& node) {
+		glm::mat4 scale = glm::scale(node.scale);
+		glm::mat4 rotation = glm::rotate(glm::radians(node.rotationDegrees), node.rotationAxis);
+		glm::mat4 translation = glm::translate(node.translation);
+		return translation * rotation * scale;
+	}
+}
+
+//Scene files hold one statement per line, '#' starts a comment:
+//  texture <name> <path>
+//    also declares a textured material of the same name
+//  material <name> <texture|-> [color r g b] [specular on|off]
+//    '-' draws the flat colour (default white) instead of a texture; specular defaults to on
+//  node <name> <mesh|-> <material|-> [translate x y z] [rotate degrees ax ay az] [scale x y z] [parent <name>]
+//  array <name> <mesh> <material> <countX> <countZ> <spacingX> <spacingZ> [node attributes]
+//    places countX * countZ copies on an XZ grid centred on the translation
+//  light <name> <point|directional> <x y z> <r g b> [range r] [ambient a] [specular s] [highlight h]
+//  lightarray <name> <countX> <countZ> <spacingX> <spacingZ> <x y z> [light attributes]
+//    places countX * countZ coloured point lights on an XZ grid centred on x y z
+//  compact <mesh> [<mesh> ...]
+//    stores the listed meshes in the compact vertex layout
+bool ULoadScene(const char* fileName, const vector<string>& meshNames, Scene& scene) {
+	ifstream file(fileName);
+	if (!file) {
+		cout << "Failed to open scene " << fileName << endl;
+		return false;
+	}
+
+	scene = Scene();
+	scene.compactMeshes.assign(meshNames.size(), false);
+
+	string line;
+	int lineNumber = 0;
+	while (getline(file, line)) {
+		++lineNumber;
+
+		size_t comment = line.find('#');
+		if (comment != string::npos)
+			line.erase(comment);
+
+		istringstream in(line);
+		string keyword;
+		if (!(in >> keyword))
+			continue;
+
+		if (keyword == "texture") {
+			SceneTexture texture;
+			if (!(in >> texture.name >> texture.path)) {
+				cout << fileName << ":" << lineNumber << ": expected 'texture <name> <path>'" << endl;
+				return false;
+			}
+			scene.textures.push_back(texture);
+
+			SceneMaterial material;
+			material.name = texture.name;
+			material.texture = static_cast<int>(scene.textures.size() - 1);
+			scene.materials.push_back(material);
+		}
+		else if (keyword == "material") {
+			SceneMaterial material;
+			string textureName;
+			if (!(in >> material.name >> textureName)) {
+				cout << fileName << ":" << lineNumber << ": expected 'material <name> <texture|->'" << endl;
+				return false;
+			}
+			if (textureName != "-") {
+				material.texture = FindTexture(scene, textureName);
+				if (material.texture < 0) {
+					cout << fileName << ":" << lineNumber << ": unknown texture '" << textureName << "'" << endl;
+					return false;
+				}
+			}
+
+			string error;
+			if (!ParseMaterialAttributes(in, material, error)) {
+				cout << fileName << ":" << lineNumber << ": " << error << endl;
+				return false;
+			}
+			scene.materials.push_back(material);
+		}
+		else if (keyword == "node") {
+			SceneNode node;
+			string meshName, materialName;
+			if (!(in >> node.name >> meshName >> materialName)) {
+				cout << fileName << ":" << lineNumber << ": expected 'node <name> <mesh> <material>'" << endl;
+				return false;
+			}
+
+			string error;
+			if (!ParseNodeAttributes(in, scene, node, error) || !AddNode(scene, node, meshNames, meshName, materialName, error)) {
+				cout << fileName << ":" << lineNumber << ": " << error << endl;
+				return false;
+			}
+		}
+		else if (keyword == "array") {
+			SceneNode node;
+			string meshName, materialName;
+			int countX = 0, countZ = 0;
+			float spacingX = 0.0f, spacingZ = 0.0f;
+			if (!(in >> node.name >> meshName >> materialName >> countX >> countZ >> spacingX >> spacingZ) || countX <= 0 || countZ <= 0) {
+				cout << fileName << ":" << lineNumber << ": expected 'array <name> <mesh> <material> <countX> <countZ> <spacingX> <spacingZ>'" << endl;
+				return false;
+			}
+
+			string error;
+			if (!ParseNodeAttributes(in, scene, node, error)) {
+				cout << fileName << ":" << lineNumber << ": " << error << endl;
+				return false;
+			}
+
+			const string baseName = node.name;
+			const glm::vec3 center = node.translation;
+			scene.nodes.reserve(scene.nodes.size() + countX * countZ);
+			scene.drawItems.reserve(scene.drawItems.size() + countX * countZ);
+			for (int z = 0; z < countZ; ++z) {
+				for (int x = 0; x < countX; ++x) {
+					node.name = baseName + "_" + to_string(z * countX + x);
+					node.translation = center + glm::vec3((x - (countX - 1) * 0.5f) * spacingX, 0.0f, (z - (countZ - 1) * 0.5f) * spacingZ);
+					if (!AddNode(scene, node, meshNames, meshName, materialName, error)) {
+						cout << fileName << ":" << lineNumber << ": " << error << endl;
+						return false;
+					}
+				}
+			}
+		}
+		else if (keyword == "light") {
+			SceneLight light;
+			string type;
+			if (!(in >> light.name >> type >> light.position.x >> light.position.y >> light.position.z >> light.color.r >> light.color.g >> light.color.b)
+				|| (type != "point" && type != "directional")) {
+				cout << fileName << ":" << lineNumber << ": expected 'light <name> <point|directional> <x y z> <r g b>'" << endl;
+				return false;
+			}
+			light.type = type == "point" ? LIGHT_POINT : LIGHT_DIRECTIONAL;
+
+			string error;
+			if (!ParseLightAttributes(in, light, error)) {
+				cout << fileName << ":" << lineNumber << ": " << error << endl;
+				return false;
+			}
+			scene.lights.push_back(light);
+		}
+		else if (keyword == "lightarray") {
+			SceneLight light;
+			int countX = 0, countZ = 0;
+			float spacingX = 0.0f, spacingZ = 0.0f;
+			glm::vec3 center;
+			if (!(in >> light.name >> countX >> countZ >> spacingX >> spacingZ >> center.x >> center.y >> center.z) || countX <= 0 || countZ <= 0) {
+				cout << fileName << ":" << lineNumber << ": expected 'lightarray <name> <countX> <countZ> <spacingX> <spacingZ> <x y z>'" << endl;
+				return false;
+			}
+
+			string error;
+			if (!ParseLightAttributes(in, light, error)) {
+				cout << fileName << ":" << lineNumber << ": " << error << endl;
+				return false;
+			}
+
+			const string baseName = light.name;
+			const int count = countX * countZ;
+			for (int z = 0; z < countZ; ++z) {
+				for (int x = 0; x < countX; ++x) {
+					int index = z * countX + x;
+					light.name = baseName + "_" + to_string(index);
+					light.position = center + glm::vec3((x - (countX - 1) * 0.5f) * spacingX, 0.0f, (z - (countZ - 1) * 0.5f) * spacingZ);
+					light.color = HueColor(static_cast<float>(index) / count);
+					scene.lights.push_back(light);
+				}
+			}
+		}
+		else if (keyword == "compact") {
+			string meshName;
+			while (in >> meshName) {
+				int mesh = FindByName(meshNames, meshName);
+				if (mesh < 0) {
+					cout << fileName << ":" << lineNumber << ": unknown mesh '" << meshName << "'" << endl;
+					return false;
+				}
+				scene.compactMeshes[mesh] = true;
+			}
+		}
+		else {
+			cout << fileName << ":" << lineNumber << ": unknown statement '" << keyword << "'" << endl;
+			return false;
+		}
+	}
+
+	scene.dirty = true;
+	UUpdateSceneTransforms(scene);
+
+	return true;
+}
+
+int UFindSceneNode(const Scene& scene, const string& name) {
+	for (size_t i = 0; i < scene.nodes.size(); ++i) {
+		if (scene.nodes[i].name == name)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+void USetNodeTransform(Scene& scene, int node, glm::vec3 translation, glm::vec3 rotationAxis, float rotationDegrees, glm::vec3 scale) {
+	SceneNode& target = scene.nodes[node];
+	target.translation = translation;
+	target.rotationAxis = rotationAxis;
+	target.rotationDegrees = rotationDegrees;
+	target.scale = scale;
+	target.dirty = true;
+	scene.dirty = true;
+}
+
+void UUpdateSceneTransforms(Scene& scene, vector<uint32_t>* changedItems) {
+	if (!scene.dirty)
+		return;
+
+	//A node is recomputed when it or any ancestor changed; parents precede children so one pass is enough
+	vector<char> changed(scene.nodes.size(), 0);
+	for (size_t i = 0; i < scene.nodes.size(); ++i) {
+		SceneNode& node = scene.nodes[i];
+		bool parentChanged = node.parent >= 0 && changed[node.parent];
+		if (!node.dirty && !parentChanged)
+			continue;
+
+		node.world = LocalMatrix(node);
+		if (node.parent >= 0)
+			node.world = scene.nodes[node.parent].world * node.world;
+		node.dirty = false;
+		changed[i] = 1;
+
+		if (node.drawItem >= 0) {
+			scene.drawItems[node.drawItem].world = node.world;
+			scene.drawItems[node.drawItem].normalMatrix = UNormalMatrix(node.world);
+			if (changedItems)
+				changedItems->push_back(static_cast<uint32_t>(node.drawItem));
+		}
+	}
+
+	scene.dirty = false;
+}
+
+glm::mat3 UNormalMatrix(const glm::mat4& world) {
+	glm::vec3 x(world[0]);
+	glm::vec3 y(world[1]);
+	glm::vec3 z(world[2]);
+
+	//Orthogonal axes of equal length: the inverse transpose is the matrix itself divided by the squared scale
+	const float lengthSq = glm::dot(x, x);
+	const float tolerance = 1e-4f * lengthSq;
+	if (fabs(glm::dot(y, y) - lengthSq) <= tolerance && fabs(glm::dot(z, z) - lengthSq) <= tolerance
+		&& fabs(glm::dot(x, y)) <= tolerance && fabs(glm::dot(y, z)) <= tolerance && fabs(glm::dot(z, x)) <= tolerance)
+		return glm::mat3(world) * (1.0f / lengthSq);
+
+	//General case: the cofactor matrix over the determinant equals transpose(inverse(m))
+	glm::vec3 cx = glm::cross(y, z);
+	glm::vec3 cy = glm::cross(z, x);
+	glm::vec3 cz = glm::cross(x, y);
+	return glm::mat3(cx, cy, cz) * (1.0f / glm::dot(x, cx));
+}
@@ -0,0 +1,93 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Transform node. Parents always come before their children, so one forward pass updates the hierarchy
+struct SceneNode {
+	std::string name;
+	int parent = -1;
+	int drawItem = -1;		//Index into Scene::drawItems, -1 for pure grouping nodes
+
+	glm::vec3 translation = glm::vec3(0.0f);
+	glm::vec3 rotationAxis = glm::vec3(1.0f, 1.0f, 1.0f);
+	float rotationDegrees = 0.0f;
+	glm::vec3 scale = glm::vec3(1.0f);
+
+	glm::mat4 world = glm::mat4(1.0f);
+	bool dirty = true;
+};
+
+//Everything needed to submit one draw, kept in a flat array
+struct DrawItem {
+	int mesh = 0;			//Index into GLMesh
+	int material = 0;		//Index into Scene::materials
+	int texture = 0;		//Index into Scene::textures, -1 when the material is untextured
+	int node = 0;
+	glm::mat4 world = glm::mat4(1.0f);	//Cached copy of the node's world matrix
+	glm::mat3 normalMatrix = glm::mat3(1.0f);	//Inverse transpose of the world matrix's upper 3x3
+};
+
+enum LightType {
+	LIGHT_POINT = 0,
+	LIGHT_DIRECTIONAL = 1
+};
+
+//Phong light. Point lights with a range fade to zero at that distance; range 0 (and every
+//directional light) reaches the whole scene and skips clustered culling
+struct SceneLight {
+	std::string name;
+	LightType type = LIGHT_POINT;
+	glm::vec3 position = glm::vec3(0.0f);	//Direction the light travels for directional lights
+	glm::vec3 color = glm::vec3(1.0f);
+	float range = 0.0f;
+	float ambient = 0.0f;		//Ambient strength
+	float specular = 0.1f;		//Specular strength
+	float highlight = 16.0f;	//Specular exponent
+};
+
+struct SceneTexture {
+	std::string name;
+	std::string path;
+	GLuint id = 0;			//Until packed into the scene's texture array, whose layer is this texture's index
+	bool rowsTopDown = false;	//Uploaded without the vertical flip, the shader mirrors v instead
+};
+
+//Surface of a draw item; picks the shader variant it is drawn with. Every texture statement also declares a
+//textured, specular material of the same name, so nodes may name either
+struct SceneMaterial {
+	std::string name;
+	int texture = -1;		//Index into Scene::textures, -1 for a flat colour
+	glm::vec3 color = glm::vec3(1.0f);	//Flat colour of untextured materials
+	bool specular = true;
+};
+
+struct Scene {
+	std::vector<SceneTexture> textures;
+	std::vector<SceneMaterial> materials;
+	std::vector<SceneLight> lights;
+	std::vector<SceneNode> nodes;
+	std::vector<DrawItem> drawItems;
+	std::vector<bool> compactMeshes;	//Indexed like GLMesh; meshes the scene wants in the compact vertex layout
+	bool dirty = true;		//Set when any node changed since the last UUpdateSceneTransforms
+};
+
+//Loads a text scene description. meshNames maps mesh names used in the file to GLMesh indices
+bool ULoadScene(const char* fileName, const std::vector<std::string>& meshNames, Scene& scene);
+
+int UFindSceneNode(const Scene& scene, const std::string& name);
+void USetNodeTransform(Scene& scene, int node, glm::vec3 translation, glm::vec3 rotationAxis, float rotationDegrees, glm::vec3 scale);
+
+//Recomputes world matrices of dirty nodes (and their descendants) only. changedItems, when given, receives the
+//draw items whose world matrix was rebuilt
+void UUpdateSceneTransforms(Scene& scene, std::vector<uint32_t>* changedItems = nullptr);
+
+//Matrix that takes object-space normals to world space; rotation with uniform scale skips the inverse
+glm::mat3 UNormalMatrix(const glm::mat4& world);
+
+#endif
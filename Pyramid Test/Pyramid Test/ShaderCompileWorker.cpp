@@ -0,0 +1,123 @@
+#include "ShaderCompileWorker.h"
+
+using namespace std;
+
+//Only joins; without a context at exit there is nothing to delete the leftover objects with
+ShaderCompileWorker::~ShaderCompileWorker() {
+	if (!Running())
+		return;
+
+	{
+		lock_guard<mutex> lock(jobMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	worker.join();
+}
+
+bool ShaderCompileWorker::Start(const function<bool()>& makeCurrent, const function<void()>& release) {
+	Stop();
+
+	stopping = false;
+	startResult = 0;
+	worker = thread(&ShaderCompileWorker::WorkerLoop, this, makeCurrent, release);
+
+	unique_lock<mutex> lock(jobMutex);
+	done.wait(lock, [this] { return startResult != 0; });
+	if (startResult > 0)
+		return true;
+
+	lock.unlock();
+	worker.join();
+	return false;
+}
+
+void ShaderCompileWorker::Stop() {
+	if (!Running())
+		return;
+
+	{
+		lock_guard<mutex> lock(jobMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	worker.join();
+
+	//The share group outlives the worker's context, so what it linked is deleted from this one
+	for (Job& job : finished) {
+		glDeleteShader(job.pending.vertexShader);
+		glDeleteShader(job.pending.fragmentShader);
+		glDeleteProgram(job.pending.id);
+	}
+	finished.clear();
+	queued.clear();
+}
+
+int ShaderCompileWorker::Queue(const string& vertexSource, const string& fragmentSource) {
+	Job job;
+	job.ticket = nextTicket++;
+	job.vertexSource = vertexSource;
+	job.fragmentSource = fragmentSource;
+	const int ticket = job.ticket;
+	{
+		lock_guard<mutex> lock(jobMutex);
+		queued.push_back(move(job));
+	}
+	wake.notify_one();
+	return ticket;
+}
+
+bool ShaderCompileWorker::Take(int ticket, GLPendingProgram& pending, bool wait) {
+	unique_lock<mutex> lock(jobMutex);
+	for (;;) {
+		for (size_t i = 0; i < finished.size(); ++i) {
+			if (finished[i].ticket != ticket)
+				continue;
+
+			pending.id = finished[i].pending.id;
+			pending.vertexShader = finished[i].pending.vertexShader;
+			pending.fragmentShader = finished[i].pending.fragmentShader;
+			finished.erase(finished.begin() + i);
+			return true;
+		}
+		if (!wait)
+			return false;
+		done.wait(lock);
+	}
+}
+
+void ShaderCompileWorker::WorkerLoop(function<bool()> makeCurrent, function<void()> release) {
+	const bool current = makeCurrent();
+	{
+		lock_guard<mutex> lock(jobMutex);
+		startResult = current ? 1 : -1;
+	}
+	done.notify_all();
+	if (!current)
+		return;
+
+	for (;;) {
+		Job job;
+		{
+			unique_lock<mutex> lock(jobMutex);
+			wake.wait(lock, [this] { return stopping || !queued.empty(); });
+			if (stopping)
+				break;
+			job = move(queued.front());
+			queued.pop_front();
+		}
+
+		UCompileShaderProgram(job.vertexSource.c_str(), job.fragmentSource.c_str(), job.pending);
+
+		//Another context only sees the program in its final state once this one has finished building it
+		glFinish();
+
+		{
+			lock_guard<mutex> lock(jobMutex);
+			finished.push_back(move(job));
+		}
+		done.notify_all();
+	}
+
+	release();
+}
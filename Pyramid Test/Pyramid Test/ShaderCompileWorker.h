@@ -0,0 +1,58 @@
+#ifndef SHADER_COMPILE_WORKER_H
+#define SHADER_COMPILE_WORKER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ShaderProgram.h"
+
+//Compiles and links shader programs on a thread of its own, for drivers without KHR_parallel_shader_compile. The
+//thread owns a second context in the main context's share group, so the programs it links can be used by the main
+//thread once a job is taken. Status queries and uniform setup stay with UFinishShaderProgram on the main thread
+class ShaderCompileWorker {
+public:
+	~ShaderCompileWorker();
+
+	//makeCurrent runs first thing on the worker thread and makes the shared context current there, release runs
+	//before it exits. False when the context could not be made current; the worker is not running then
+	bool Start(const std::function<bool()>& makeCurrent, const std::function<void()>& release);
+
+	//Joins the thread and deletes the objects of jobs nobody took. Needs the main context current
+	void Stop();
+
+	bool Running() const { return worker.joinable(); }
+
+	//Queues a compile and link of the two sources, returning the ticket to take it with
+	int Queue(const std::string& vertexSource, const std::string& fragmentSource);
+
+	//True once the job is done: pending gets its program and shaders, unchecked, and the ticket is forgotten. wait
+	//blocks until then
+	bool Take(int ticket, GLPendingProgram& pending, bool wait);
+
+private:
+	struct Job {
+		int ticket = 0;
+		std::string vertexSource;
+		std::string fragmentSource;
+		GLPendingProgram pending;
+	};
+
+	void WorkerLoop(std::function<bool()> makeCurrent, std::function<void()> release);
+
+	std::thread worker;
+	std::mutex jobMutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	std::deque<Job> queued;
+	std::vector<Job> finished;
+	int nextTicket = 0;
+	int startResult = 0;		//0 while the worker is still starting, 1 when its context is current, -1 when not
+	bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "ShaderProgram.h"
+
+#include "ProgramCache.h"
+
+#include <iostream>
+
+//Implements UCreateShaders
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLShaderProgram& program) {
+	GLPendingProgram pending;
+	UBeginShaderProgram(vtxShaderSource, fragShaderSource, pending);
+	return UFinishShaderProgram(pending, program);
+}
+
+void UBeginShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLPendingProgram& pending) {
+	if (!UBeginCachedShaderProgram(vtxShaderSource, fragShaderSource, pending))
+		UCompileShaderProgram(vtxShaderSource, fragShaderSource, pending);
+}
+
+bool UBeginCachedShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLPendingProgram& pending) {
+	pending = GLPendingProgram();
+
+	//A binary the driver linked on an earlier run skips compiling and linking altogether
+	const char* sources[] = { vtxShaderSource, fragShaderSource };
+	pending.cacheKey = UProgramCacheKey(sources, 2);
+	pending.id = ULoadCachedProgram(pending.cacheKey);
+	pending.cached = pending.id != 0;
+	return pending.cached;
+}
+
+void UCompileShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLPendingProgram& pending) {
+	//Create shader program object
+	pending.id = glCreateProgram();
+	UPrepareCachedProgram(pending.id);
+
+	//Create vertex and fragment shader objects
+	pending.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	pending.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+
+	//Retrive source code
+	glShaderSource(pending.vertexShader, 1, &vtxShaderSource, NULL);
+	glShaderSource(pending.fragmentShader, 1, &fragShaderSource, NULL);
+
+	//Compile and link without reading any status back, which would wait for the driver
+	glCompileShader(pending.vertexShader);
+	glCompileShader(pending.fragmentShader);
+	glAttachShader(pending.id, pending.vertexShader);
+	glAttachShader(pending.id, pending.fragmentShader);
+	glLinkProgram(pending.id);
+}
+
+bool UIsShaderProgramReady(const GLPendingProgram& pending) {
+	if (pending.cached || !GLEW_KHR_parallel_shader_compile)
+		return true;
+
+	GLint done = GL_FALSE;
+	glGetProgramiv(pending.id, GL_COMPLETION_STATUS_KHR, &done);
+	return done != GL_FALSE;
+}
+
+bool UFinishShaderProgram(GLPendingProgram& pending, GLShaderProgram& program) {
+	//Compilation and linkage error report
+	int success = 0;
+	char infoLog[512];
+
+	const GLuint programId = pending.id;
+	program.id = programId;
+
+	if (!pending.cached) {
+		//Report compile errors
+		glGetShaderiv(pending.vertexShader, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(pending.vertexShader, 512, NULL, infoLog);
+			std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+		}
+		else {
+			glGetShaderiv(pending.fragmentShader, GL_COMPILE_STATUS, &success);
+			if (!success) {
+				glGetShaderInfoLog(pending.fragmentShader, 512, NULL, infoLog);
+				std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+			}
+		}
+		glDeleteShader(pending.vertexShader);		//Stay alive while attached
+		glDeleteShader(pending.fragmentShader);
+		pending.vertexShader = pending.fragmentShader = 0;
+		if (!success)
+			return false;
+
+		//Check for link errors
+		glGetProgramiv(programId, GL_LINK_STATUS, &success);
+		if (!success) {
+			glGetProgramInfoLog(programId, sizeof(infoLog), NULL, infoLog);
+			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+
+			return false;
+		}
+		UStoreCachedProgram(pending.cacheKey, programId);
+	}
+
+	glUseProgram(programId);		//Use shader program
+
+	//Resolve uniform locations once; per-frame values live in the FrameData block and
+	//model matrices arrive as instance attributes
+	program.textureLoc = glGetUniformLocation(programId, "uTexture");
+	program.octahedralNormalsLoc = glGetUniformLocation(programId, "octahedralNormals");
+
+	//Every program samples the scene's texture array from unit 0
+	glUniform1i(program.textureLoc, 0);
+
+	return true;
+}
+
+void UDestroyShaderProgram(GLShaderProgram& program) {
+	glDeleteProgram(program.id);
+	program = GLShaderProgram();
+}
+
+bool UCreateComputeProgram(const char* source, GLuint& program) {
+	int success = 0;
+	char infoLog[512];
+
+	const uint64_t cacheKey = UProgramCacheKey(&source, 1);
+	program = ULoadCachedProgram(cacheKey);
+	if (program != 0)
+		return true;
+
+	GLuint shaderId = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(shaderId, 1, &source, NULL);
+	glCompileShader(shaderId);
+	glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		glGetShaderInfoLog(shaderId, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+		glDeleteShader(shaderId);
+		return false;
+	}
+
+	program = glCreateProgram();
+	UPrepareCachedProgram(program);
+	glAttachShader(program, shaderId);
+	glLinkProgram(program);
+	glDeleteShader(shaderId);		//Stays alive while attached
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		glDeleteProgram(program);
+		program = 0;
+		return false;
+	}
+	UStoreCachedProgram(cacheKey, program);
+	return true;
+}
+
+void UCreateFrameUniforms(GLFrameUniforms& uniforms) {
+	glGenBuffers(1, &uniforms.ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, uniforms.ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	//The binding point matches layout(binding = 0) in the shaders, so it is set once for every program
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, uniforms.ubo);
+}
+
+void UUpdateFrameUniforms(const GLFrameUniforms& uniforms, const FrameData& data) {
+	glBindBuffer(GL_UNIFORM_BUFFER, uniforms.ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UDestroyFrameUniforms(GLFrameUniforms& uniforms) {
+	glDeleteBuffers(1, &uniforms.ubo);
+	uniforms.ubo = 0;
+}
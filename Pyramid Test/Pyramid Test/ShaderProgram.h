@@ -0,0 +1,67 @@
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+//Uniform buffer binding point of the FrameData block shared by every scene shader
+const GLuint FRAME_DATA_BINDING = 0;
+
+//CPU mirror of the std140 FrameData uniform block (vec3 members are padded to 16 bytes)
+struct FrameData {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPosition;
+	float pad0;
+	glm::ivec4 clusterGrid;		//Light cluster tiles x, tiles y, depth slices, tile size in pixels (see LightGrid)
+	glm::vec2 clusterDepth;		//Depth of the first slice, slices per unit of log depth
+	int globalLightCount;		//Lights at the start of the light buffer that every fragment evaluates
+	int pad1;
+};
+
+//Linked program with its uniform locations resolved once after linking
+struct GLShaderProgram {
+	GLuint id = 0;
+	GLint textureLoc = -1;
+	GLint octahedralNormalsLoc = -1;	//Set per mesh: normals arrive octahedral encoded (compact vertex layout)
+};
+
+//Uniform buffer holding FrameData, written once per frame
+struct GLFrameUniforms {
+	GLuint ubo = 0;
+};
+
+//Program whose shaders have been handed to the driver but whose compile and link results have not been read yet
+struct GLPendingProgram {
+	GLuint id = 0;
+	GLuint vertexShader = 0;
+	GLuint fragmentShader = 0;
+	uint64_t cacheKey = 0;
+	bool cached = false;	//Loaded from the program cache, already linked
+};
+
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLShaderProgram& program);
+
+//UCreateShaderProgram in two halves. Begin queues the compile and link without waiting on them; with
+//KHR_parallel_shader_compile the driver works on them on its own threads until UIsShaderProgramReady says they are
+//done, otherwise Finish waits. Finish reports errors, stores the binary in the program cache and resolves uniforms
+void UBeginShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLPendingProgram& pending);
+
+//The two steps of Begin, for callers that compile elsewhere: the program cache lookup, true on a hit, and the
+//compile and link of a miss. The compile only needs a context sharing objects with the one that finishes it
+bool UBeginCachedShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLPendingProgram& pending);
+void UCompileShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLPendingProgram& pending);
+bool UIsShaderProgramReady(const GLPendingProgram& pending);
+bool UFinishShaderProgram(GLPendingProgram& pending, GLShaderProgram& program);
+void UDestroyShaderProgram(GLShaderProgram& program);
+
+//Compiles and links a compute shader into program, printing the log on failure
+bool UCreateComputeProgram(const char* source, GLuint& program);
+
+void UCreateFrameUniforms(GLFrameUniforms& uniforms);
+void UUpdateFrameUniforms(const GLFrameUniforms& uniforms, const FrameData& data);
+void UDestroyFrameUniforms(GLFrameUniforms& uniforms);
+
+#endif
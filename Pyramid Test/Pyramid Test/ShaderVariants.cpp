@@ -0,0 +1,361 @@
+#include "ShaderVariants.h"
+
+#include "Instancing.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+	//Template text as read from the shader directory
+	string gVertexTemplate;
+	string gFragmentTemplate;
+
+	//Feature words of the manifest spelling, in the order names are written
+	const struct {
+		ShaderFeature feature;
+		const char* name;
+	} FEATURE_NAMES[] = {
+		{ SHADER_FEATURE_GENERIC, "generic" },
+		{ SHADER_FEATURE_TEXTURED, "textured" },
+		{ SHADER_FEATURE_SPECULAR, "specular" },
+		{ SHADER_FEATURE_COMPACT_NORMALS, "compact" },
+		{ SHADER_FEATURE_CLUSTERED_LIGHTS, "clustered" },
+		{ SHADER_FEATURE_SHADER_NORMALS, "shader-normals" }
+	};
+
+	string Defines(const ShaderVariant& variant) {
+		const bool generic = (variant.features & SHADER_FEATURE_GENERIC) != 0;
+		auto flag = [&](ShaderFeature feature) { return generic || (variant.features & feature) != 0 ? 1 : 0; };
+
+		ostringstream defines;
+		defines << "#define GENERIC " << (generic ? 1 : 0) << "\n"
+			<< "#define TEXTURED " << flag(SHADER_FEATURE_TEXTURED) << "\n"
+			<< "#define SPECULAR " << flag(SHADER_FEATURE_SPECULAR) << "\n"
+			<< "#define CLUSTERED_LIGHTS " << flag(SHADER_FEATURE_CLUSTERED_LIGHTS) << "\n"
+			<< "#define COMPACT_NORMALS " << (!generic && (variant.features & SHADER_FEATURE_COMPACT_NORMALS) != 0 ? 1 : 0) << "\n"
+			<< "#define SHADER_NORMALS " << ((variant.features & SHADER_FEATURE_SHADER_NORMALS) != 0 ? 1 : 0) << "\n"
+			<< "#define LIGHT_COUNT " << (generic ? SHADER_LOOPED_LIGHTS : variant.lights) << "\n"
+			<< "#define INSTANCE_ROWS_TOP_DOWN " << INSTANCE_ROWS_TOP_DOWN << "u\n"
+			<< "#define INSTANCE_UNTEXTURED " << INSTANCE_UNTEXTURED << "u\n"
+			<< "#define INSTANCE_NO_SPECULAR " << INSTANCE_NO_SPECULAR << "u\n";
+		return defines.str();
+	}
+
+	double MsSince(chrono::steady_clock::time_point start) {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+
+	bool ReadTemplate(const string& path, string& text) {
+		ifstream file(path, ios::binary);
+		if (!file) {
+			cout << "Failed to open shader template " << path << endl;
+			return false;
+		}
+		ostringstream contents;
+		contents << file.rdbuf();
+		text = contents.str();
+
+		//The variant's #defines go after the first line, which GLSL requires to be the #version
+		if (text.compare(0, 8, "#version") != 0 || text.find('\n') == string::npos) {
+			cout << "Shader template " << path << " does not start with a #version line" << endl;
+			return false;
+		}
+		return true;
+	}
+
+	//Variant sources with the defines after the template's #version line; #line 2 keeps compile errors pointing at
+	//lines of the file
+	string Specialize(const string& templateText, const string& defines) {
+		const size_t body = templateText.find('\n') + 1;
+		return templateText.substr(0, body) + defines + "#line 2\n" + templateText.substr(body);
+	}
+
+	//Begins a build of the variant's current sources. onMainThread compiles here whatever the mode, for the
+	//fallback the first frame needs
+	void Start(GLShaderVariants& set, GLShaderVariant& entry, bool onMainThread) {
+		entry.queued = false;
+		entry.building = true;
+		entry.startTime = chrono::steady_clock::now();
+		if (set.mode == SHADER_COMPILE_WORKER && !onMainThread) {
+			//The cache lookup is cheap and stays here; only a miss goes to the worker
+			if (!UBeginCachedShaderProgram(entry.vertexSource.c_str(), entry.fragmentSource.c_str(), entry.pending))
+				entry.ticket = set.worker->Queue(entry.vertexSource, entry.fragmentSource);
+		}
+		else
+			UBeginShaderProgram(entry.vertexSource.c_str(), entry.fragmentSource.c_str(), entry.pending);
+		entry.cached = entry.pending.cached;
+	}
+
+	bool IsBuilt(GLShaderVariants& set, GLShaderVariant& entry, bool wait) {
+		if (entry.ticket >= 0) {
+			if (!set.worker->Take(entry.ticket, entry.pending, wait))
+				return false;
+			entry.ticket = -1;
+			return true;
+		}
+		return wait || UIsShaderProgramReady(entry.pending);
+	}
+
+	//A rebuild replaces the program the variant had only when it linked
+	void Finish(GLShaderVariants& set, GLShaderVariant& entry) {
+		const string name = UShaderVariantName(entry.variant);
+		GLShaderProgram program;
+		if (UFinishShaderProgram(entry.pending, program)) {
+			if (entry.ready) {
+				glDeleteProgram(entry.program.id);
+				ostringstream report;
+				report << "INFO: Shader variant '" << name << "' reloaded in " << fixed << setprecision(1) << MsSince(entry.startTime) << " ms";
+				cout << report.str() << endl;
+			}
+			entry.program = program;
+			entry.ready = true;
+			entry.failed = false;
+		}
+		else {
+			cout << "Failed to build shader variant '" << name << "'" << (entry.ready ? ", drawing with the previous build" : "") << endl;
+			glDeleteProgram(entry.pending.id);
+			entry.failed = !entry.ready;
+		}
+		entry.pending = GLPendingProgram();
+		entry.building = false;
+		++entry.builds;
+		++set.builds;
+		entry.compileMs = MsSince(entry.startTime);
+	}
+}
+
+ShaderVariant UGenericShaderVariant(bool shaderNormals) {
+	ShaderVariant variant;
+	variant.features = SHADER_FEATURE_GENERIC | (shaderNormals ? static_cast<uint32_t>(SHADER_FEATURE_SHADER_NORMALS) : 0u);
+	return variant;
+}
+
+ShaderVariant USelectShaderVariant(bool textured, bool specular, bool compactNormals, bool shaderNormals, int globalLights, bool boundedLights) {
+	ShaderVariant variant;
+	if (textured)
+		variant.features |= SHADER_FEATURE_TEXTURED;
+	if (specular)
+		variant.features |= SHADER_FEATURE_SPECULAR;
+	if (compactNormals)
+		variant.features |= SHADER_FEATURE_COMPACT_NORMALS;
+	if (boundedLights)
+		variant.features |= SHADER_FEATURE_CLUSTERED_LIGHTS;
+	if (shaderNormals)
+		variant.features |= SHADER_FEATURE_SHADER_NORMALS;
+	variant.lights = globalLights <= SHADER_MAX_UNROLLED_LIGHTS ? globalLights : SHADER_LOOPED_LIGHTS;
+	return variant;
+}
+
+string UShaderVariantName(const ShaderVariant& variant) {
+	string name;
+	for (const auto& feature : FEATURE_NAMES) {
+		if ((variant.features & feature.feature) != 0)
+			name += string(name.empty() ? "" : " ") + feature.name;
+	}
+	if ((variant.features & SHADER_FEATURE_GENERIC) == 0) {
+		name += name.empty() ? "" : " ";
+		name += variant.lights == SHADER_LOOPED_LIGHTS ? "lights=loop" : "lights=" + to_string(variant.lights);
+	}
+	return name;
+}
+
+bool ULoadShaderManifest(const char* fileName, vector<ShaderVariant>& variants) {
+	ifstream file(fileName);
+	if (!file) {
+		cout << "Failed to open shader manifest " << fileName << endl;
+		return false;
+	}
+
+	string line;
+	int lineNumber = 0;
+	while (getline(file, line)) {
+		++lineNumber;
+
+		size_t comment = line.find('#');
+		if (comment != string::npos)
+			line.erase(comment);
+
+		istringstream in(line);
+		ShaderVariant variant;
+		string word;
+		bool any = false;
+		while (in >> word) {
+			any = true;
+			bool known = false;
+			for (const auto& feature : FEATURE_NAMES) {
+				if (word == feature.name) {
+					variant.features |= feature.feature;
+					known = true;
+				}
+			}
+			if (word == "lights=loop") {
+				variant.lights = SHADER_LOOPED_LIGHTS;
+				known = true;
+			}
+			else if (word.compare(0, 7, "lights=") == 0 && word.size() > 7) {
+				variant.lights = atoi(word.c_str() + 7);
+				known = variant.lights >= 0 && variant.lights <= SHADER_MAX_UNROLLED_LIGHTS;
+			}
+			if (!known) {
+				cout << fileName << ":" << lineNumber << ": unknown shader feature '" << word << "'" << endl;
+				return false;
+			}
+		}
+		if (any)
+			variants.push_back(variant);
+	}
+	return true;
+}
+
+bool ULoadShaderTemplates(const string& directory) {
+	string vertexText, fragmentText;
+	if (!ReadTemplate(directory + "/" + SHADER_VERTEX_TEMPLATE, vertexText) || !ReadTemplate(directory + "/" + SHADER_FRAGMENT_TEMPLATE, fragmentText))
+		return false;
+	gVertexTemplate = vertexText;
+	gFragmentTemplate = fragmentText;
+	return true;
+}
+
+void UShaderVariantSources(const ShaderVariant& variant, string& vertexSource, string& fragmentSource) {
+	const string defines = Defines(variant);
+	vertexSource = Specialize(gVertexTemplate, defines);
+	fragmentSource = Specialize(gFragmentTemplate, defines);
+}
+
+const char* UShaderCompileModeName(ShaderCompileMode mode) {
+	switch (mode) {
+	case SHADER_COMPILE_DRIVER: return "driver";
+	case SHADER_COMPILE_WORKER: return "worker";
+	case SHADER_COMPILE_MAIN: return "main";
+	default: return "auto";
+	}
+}
+
+void UCreateShaderVariants(GLShaderVariants& set, ShaderCompileMode mode, const function<bool()>& makeWorkerContextCurrent,
+	const function<void()>& releaseWorkerContext) {
+	set = GLShaderVariants();
+
+	const bool driverThreads = GLEW_KHR_parallel_shader_compile != 0;
+	if (mode == SHADER_COMPILE_AUTO)
+		mode = driverThreads ? SHADER_COMPILE_DRIVER : SHADER_COMPILE_WORKER;
+	if (mode == SHADER_COMPILE_DRIVER && !driverThreads) {
+		cout << "INFO: The driver has no KHR_parallel_shader_compile, shaders compile on a worker thread" << endl;
+		mode = SHADER_COMPILE_WORKER;
+	}
+	if (mode == SHADER_COMPILE_WORKER) {
+		set.worker.reset(new ShaderCompileWorker());
+		if (!makeWorkerContextCurrent || !set.worker->Start(makeWorkerContextCurrent, releaseWorkerContext)) {
+			cout << "INFO: No shared context for the shader worker, shaders compile one per frame" << endl;
+			set.worker.reset();
+			mode = SHADER_COMPILE_MAIN;
+		}
+	}
+	set.mode = mode;
+
+	if (mode == SHADER_COMPILE_DRIVER)
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);		//As many threads as the driver likes
+}
+
+void UDestroyShaderVariants(GLShaderVariants& set) {
+	//Jobs still on the worker are its to delete
+	if (set.worker)
+		set.worker->Stop();
+
+	for (GLShaderVariant& entry : set.variants) {
+		if (entry.building && entry.ticket < 0) {
+			glDeleteShader(entry.pending.vertexShader);
+			glDeleteShader(entry.pending.fragmentShader);
+			glDeleteProgram(entry.pending.id);
+		}
+		if (entry.ready)
+			glDeleteProgram(entry.program.id);
+	}
+	set.variants.clear();
+	set.worker.reset();
+}
+
+int UReloadShaderVariants(GLShaderVariants& set, const string& directory) {
+	if (!ULoadShaderTemplates(directory))
+		return 0;
+
+	int rebuilds = 0;
+	for (GLShaderVariant& entry : set.variants) {
+		string vertexSource, fragmentSource;
+		UShaderVariantSources(entry.variant, vertexSource, fragmentSource);
+		if (vertexSource == entry.vertexSource && fragmentSource == entry.fragmentSource)
+			continue;
+
+		//A build already underway finishes with the old sources and is followed by this one
+		entry.vertexSource = vertexSource;
+		entry.fragmentSource = fragmentSource;
+		entry.queued = true;
+		++rebuilds;
+	}
+	return rebuilds;
+}
+
+int URequestShaderVariant(GLShaderVariants& set, const ShaderVariant& variant) {
+	for (size_t i = 0; i < set.variants.size(); ++i) {
+		if (set.variants[i].variant == variant)
+			return static_cast<int>(i);
+	}
+
+	GLShaderVariant entry;
+	entry.variant = variant;
+	UShaderVariantSources(variant, entry.vertexSource, entry.fragmentSource);
+	set.variants.push_back(entry);
+	return static_cast<int>(set.variants.size() - 1);
+}
+
+bool UBuildShaderVariant(GLShaderVariants& set, int index) {
+	GLShaderVariant& entry = set.variants[index];
+	if (entry.building)
+		IsBuilt(set, entry, true);
+	else if (entry.queued)
+		Start(set, entry, true);
+	if (entry.building)
+		Finish(set, entry);
+	return entry.ready;
+}
+
+int UPollShaderVariants(GLShaderVariants& set, bool wait) {
+	int pending = 0;
+	bool builtOne = false;
+	for (GLShaderVariant& entry : set.variants) {
+		if (!entry.queued && !entry.building)
+			continue;
+
+		if (set.mode == SHADER_COMPILE_MAIN) {
+			//Every build blocks, so a frame takes at most one
+			if (wait || !builtOne) {
+				Start(set, entry, true);
+				Finish(set, entry);
+				builtOne = true;
+			}
+			else
+				++pending;
+			continue;
+		}
+
+		if (entry.building && IsBuilt(set, entry, wait))
+			Finish(set, entry);
+		if (entry.queued && !entry.building)
+			Start(set, entry, false);
+		if (entry.building && wait && IsBuilt(set, entry, true))
+			Finish(set, entry);
+		if (entry.building || entry.queued)
+			++pending;
+	}
+	return pending;
+}
+
+const GLShaderProgram& UShaderVariantProgram(const GLShaderVariants& set, int index, int fallback) {
+	if (index >= 0 && set.variants[index].ready)
+		return set.variants[index].program;
+	return set.variants[fallback].program;
+}
@@ -0,0 +1,128 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ShaderCompileWorker.h"
+#include "ShaderProgram.h"
+
+//Template files in the shader directory, each starting with its #version line
+const char* const SHADER_VERTEX_TEMPLATE = "scene.vert";
+const char* const SHADER_FRAGMENT_TEMPLATE = "scene.frag";
+
+//Feature bits of a scene shader variant. Each one becomes a #define of 0 or 1 in front of the shared vertex and
+//fragment templates, so a variant only contains the work its draws need
+enum ShaderFeature : uint32_t {
+	SHADER_FEATURE_TEXTURED = 1 << 0,			//Samples the texture array; without it the instance carries a flat colour
+	SHADER_FEATURE_SPECULAR = 1 << 1,			//Adds each light's specular highlight
+	SHADER_FEATURE_COMPACT_NORMALS = 1 << 2,	//Normals arrive octahedral encoded (compact vertex layout)
+	SHADER_FEATURE_CLUSTERED_LIGHTS = 1 << 3,	//Shades the bounded lights listed for the fragment's cluster
+	SHADER_FEATURE_SHADER_NORMALS = 1 << 4,		//Inverts the model matrix per vertex (the --shader-normals baseline)
+	//Texturing, specular and the normal encoding are read per instance and from the octahedralNormals uniform, the
+	//clustered lights are included and the unbounded ones looped over. Draws anything, so it stands in for variants
+	//still compiling. Implies the three features it decides at run time
+	SHADER_FEATURE_GENERIC = 1 << 5
+};
+
+//Unbounded lights a variant loops over up to FrameData's count instead of unrolling a fixed number
+const int SHADER_LOOPED_LIGHTS = -1;
+const int SHADER_MAX_UNROLLED_LIGHTS = 4;
+
+struct ShaderVariant {
+	uint32_t features = 0;
+	int lights = SHADER_LOOPED_LIGHTS;	//Unbounded lights compiled in, 0 to SHADER_MAX_UNROLLED_LIGHTS
+};
+
+inline bool operator==(const ShaderVariant& a, const ShaderVariant& b) {
+	return a.features == b.features && a.lights == b.lights;
+}
+
+//The fallback every draw can use
+ShaderVariant UGenericShaderVariant(bool shaderNormals);
+
+//Smallest variant that draws a material: textured or not, specular or not, with the vertex layout's normals, for a
+//scene with globalLights unbounded lights and, when boundedLights is set, clustered ones
+ShaderVariant USelectShaderVariant(bool textured, bool specular, bool compactNormals, bool shaderNormals, int globalLights, bool boundedLights);
+
+//Manifest spelling, e.g. "textured specular lights=2" or "generic"
+std::string UShaderVariantName(const ShaderVariant& variant);
+
+//Reads a variant manifest: one variant per line in the spelling above, '#' starts a comment
+bool ULoadShaderManifest(const char* fileName, std::vector<ShaderVariant>& variants);
+
+//Reads both templates from directory. On failure the templates read before are kept
+bool ULoadShaderTemplates(const std::string& directory);
+
+//Template sources with the variant's #defines inserted after the #version line
+void UShaderVariantSources(const ShaderVariant& variant, std::string& vertexSource, std::string& fragmentSource);
+
+//Where queued variants compile: on driver threads with KHR_parallel_shader_compile, on a worker thread with a
+//shared context, or on the main thread one per poll so a frame never waits on more than one. Auto picks the first
+//one available
+enum ShaderCompileMode {
+	SHADER_COMPILE_AUTO,
+	SHADER_COMPILE_DRIVER,
+	SHADER_COMPILE_WORKER,
+	SHADER_COMPILE_MAIN
+};
+
+const char* UShaderCompileModeName(ShaderCompileMode mode);
+
+//One variant's program and how its compile went. A rebuild (after its sources changed) keeps drawing with the
+//program it has until the new one links, and keeps it if the new one fails
+struct GLShaderVariant {
+	ShaderVariant variant;
+	std::string vertexSource;
+	std::string fragmentSource;
+	GLShaderProgram program;		//id stays 0 until the variant is ready
+	GLPendingProgram pending;
+	int ticket = -1;				//Job on the compile worker
+	bool queued = true;				//Waiting for a build of the current sources
+	bool building = false;
+	bool ready = false;
+	bool failed = false;			//The last build failed and there is no program from an earlier one
+	bool cached = false;			//Came from the program cache
+	int builds = 0;
+	double compileMs = 0.0;			//Queued to ready, as seen by polling
+	std::chrono::steady_clock::time_point startTime;
+};
+
+//Every variant requested this run
+struct GLShaderVariants {
+	std::vector<GLShaderVariant> variants;
+	ShaderCompileMode mode = SHADER_COMPILE_MAIN;
+	std::unique_ptr<ShaderCompileWorker> worker;
+	int builds = 0;			//Builds finished, linked or not; changes whenever a program may have been swapped
+};
+
+//Resolves mode against the driver. The worker mode starts the compile thread, which runs makeWorkerContextCurrent
+//and releaseWorkerContext; without them, or when the context cannot be made current, compiles fall back to the main
+//thread
+void UCreateShaderVariants(GLShaderVariants& set, ShaderCompileMode mode, const std::function<bool()>& makeWorkerContextCurrent,
+	const std::function<void()>& releaseWorkerContext);
+void UDestroyShaderVariants(GLShaderVariants& set);
+
+//Rereads the templates and queues a rebuild of every variant whose sources changed, returning how many
+int UReloadShaderVariants(GLShaderVariants& set, const std::string& directory);
+
+//Index of the variant, queued for compiling if it is new
+int URequestShaderVariant(GLShaderVariants& set, const ShaderVariant& variant);
+
+//Compiles and links a queued variant now on this thread, for the fallback the first frame needs
+bool UBuildShaderVariant(GLShaderVariants& set, int index);
+
+//Starts queued variants and finishes the ones the driver is done with; wait blocks until none is left. Returns the
+//number still compiling
+int UPollShaderVariants(GLShaderVariants& set, bool wait);
+
+//The variant's program once ready, otherwise the fallback's
+const GLShaderProgram& UShaderVariantProgram(const GLShaderVariants& set, int index, int fallback);
+
+#endif
@@ -0,0 +1,466 @@
+#include "Simplify.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+	const uint32_t NONE = ~0u;
+	const uint32_t MANY = ~0u - 1;
+
+	//Open edges are held in place this many times harder than the surface they bound
+	const float BORDER_WEIGHT = 10.0f;
+
+	//A collapse may shrink a neighbouring triangle to no less than this fraction of its area
+	const float FLIP_MIN_AREA = 0.05f;
+
+	//How a vertex position may move. Every vertex sharing a position gets the same kind
+	enum VertexKind : uint8_t {
+		KIND_MANIFOLD,	//One set of attributes, surrounded by triangles: collapses onto any neighbour
+		KIND_BORDER,	//One set of attributes on one open border: collapses along the border
+		KIND_SEAM,		//Two sets of attributes split along one seam: collapses along the seam, both sides at once
+		KIND_LOCKED		//Anything else (corners of seams, non-manifold fans) stays where it is
+	};
+
+	//Sum of squared distances to weighted planes, as the symmetric matrix A, vector b and constant c of
+	//p'Ap + 2b'p + c, with the summed weight so errors come out as a mean squared distance
+	struct Quadric {
+		double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+		double weight = 0.0;
+	};
+
+	//Plane through point with unit normal, weighted
+	Quadric PlaneQuadric(const glm::vec3& normal, const glm::vec3& point, double weight) {
+		const double d = -glm::dot(normal, point);
+		Quadric q;
+		q.a00 = normal.x * normal.x * weight;
+		q.a11 = normal.y * normal.y * weight;
+		q.a22 = normal.z * normal.z * weight;
+		q.a01 = normal.x * normal.y * weight;
+		q.a02 = normal.x * normal.z * weight;
+		q.a12 = normal.y * normal.z * weight;
+		q.b0 = normal.x * d * weight;
+		q.b1 = normal.y * d * weight;
+		q.b2 = normal.z * d * weight;
+		q.c = d * d * weight;
+		q.weight = weight;
+		return q;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& r) {
+		q.a00 += r.a00;
+		q.a11 += r.a11;
+		q.a22 += r.a22;
+		q.a01 += r.a01;
+		q.a02 += r.a02;
+		q.a12 += r.a12;
+		q.b0 += r.b0;
+		q.b1 += r.b1;
+		q.b2 += r.b2;
+		q.c += r.c;
+		q.weight += r.weight;
+	}
+
+	//Weighted mean squared distance from p to the quadric's planes. Doubles, because the terms are the size of the
+	//squared distance to the origin while the result is the squared distance to a nearby surface
+	float QuadricError(const Quadric& q, const glm::vec3& p) {
+		const double rx = q.a00 * p.x + q.a01 * p.y + q.a02 * p.z + q.b0;
+		const double ry = q.a01 * p.x + q.a11 * p.y + q.a12 * p.z + q.b1;
+		const double rz = q.a02 * p.x + q.a12 * p.y + q.a22 * p.z + q.b2;
+		const double error = rx * p.x + ry * p.y + rz * p.z + q.b0 * p.x + q.b1 * p.y + q.b2 * p.z + q.c;
+		return q.weight > 0.0 ? static_cast<float>(fabs(error) / q.weight) : 0.0f;
+	}
+
+	uint32_t HashBits(uint32_t h) {
+		h ^= h >> 16;
+		h *= 0x85ebca6bu;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35u;
+		h ^= h >> 16;
+		return h;
+	}
+
+	size_t TableSize(size_t entries) {
+		size_t size = 16;
+		while (size < entries * 2)
+			size *= 2;
+		return size;
+	}
+
+	//For every vertex the first vertex with a bit-identical position, the id the quadrics and kinds are kept under
+	vector<uint32_t> BuildPositionRemap(const vector<MeshVertex>& vertices) {
+		const size_t size = TableSize(vertices.size());
+		vector<uint32_t> table(size, NONE);
+		vector<uint32_t> remap(vertices.size());
+		for (uint32_t i = 0; i < vertices.size(); ++i) {
+			uint32_t bits[3];
+			memcpy(bits, &vertices[i].position, sizeof(bits));
+			size_t slot = HashBits(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u) & (size - 1);
+			while (table[slot] != NONE && memcmp(&vertices[table[slot]].position, &vertices[i].position, sizeof(glm::vec3)) != 0)
+				slot = (slot + 1) & (size - 1);
+			if (table[slot] == NONE)
+				table[slot] = i;
+			remap[i] = table[slot];
+		}
+		return remap;
+	}
+
+	//Lists of an index per key, packed: entries of key k are items[offsets[k]] to items[offsets[k + 1]]
+	struct Adjacency {
+		vector<uint32_t> offsets;
+		vector<uint32_t> items;
+
+		//keyOf(i) and itemOf(i) for i in [0, count)
+		template<typename Key, typename Item>
+		void Build(size_t keys, size_t count, Key keyOf, Item itemOf) {
+			offsets.assign(keys + 1, 0);
+			for (size_t i = 0; i < count; ++i)
+				++offsets[keyOf(i) + 1];
+			for (size_t k = 1; k < offsets.size(); ++k)
+				offsets[k] += offsets[k - 1];
+			items.resize(count);
+			fill.assign(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < count; ++i)
+				items[fill[keyOf(i)]++] = itemOf(i);
+		}
+
+	private:
+		vector<uint32_t> fill;
+	};
+
+	//State shared by the passes of one simplification
+	struct Simplifier {
+		const vector<MeshVertex>& vertices;
+		vector<uint32_t> indices;
+		vector<uint32_t> position;		//Vertex to its position id
+		vector<uint32_t> wedge;			//Next vertex with the same position, circular
+		vector<uint32_t> openOut;		//Per vertex: the end of its one outgoing edge without a twin, NONE or MANY
+		vector<uint32_t> openIn;
+		vector<VertexKind> kind;
+		vector<uint32_t> partner;		//For seam vertices, the vertex on the other side of the seam
+		vector<Quadric> quadrics;		//By position id
+		Adjacency outgoing;				//Per vertex, the far ends of its half-edges
+		Adjacency triangles;			//Per position id, the triangles around it
+
+		explicit Simplifier(const MeshData& mesh) : vertices(mesh.vertices), indices(mesh.indices) {}
+
+		const glm::vec3& At(uint32_t vertex) const { return vertices[vertex].position; }
+
+		void BuildWedges() {
+			wedge.resize(vertices.size());
+			for (uint32_t i = 0; i < vertices.size(); ++i)
+				wedge[i] = i;
+			//Splice every vertex into its position id's ring
+			for (uint32_t i = 0; i < vertices.size(); ++i) {
+				const uint32_t p = position[i];
+				if (p != i) {
+					wedge[i] = wedge[p];
+					wedge[p] = i;
+				}
+			}
+		}
+
+		bool HasEdge(uint32_t from, uint32_t to) const {
+			for (uint32_t k = outgoing.offsets[from]; k < outgoing.offsets[from + 1]; ++k)
+				if (outgoing.items[k] == to)
+					return true;
+			return false;
+		}
+
+		//Finds the open edges of the current triangles and derives every position's kind from them
+		void Classify() {
+			//Corner i starts the half-edge to the next corner of its triangle
+			auto next = [](size_t i) { return i - i % 3 + (i % 3 + 1) % 3; };
+			outgoing.Build(vertices.size(), indices.size(), [&](size_t i) { return indices[i]; }, [&](size_t i) { return indices[next(i)]; });
+			triangles.Build(vertices.size(), indices.size(), [&](size_t i) { return position[indices[i]]; }, [](size_t i) { return static_cast<uint32_t>(i / 3); });
+
+			openOut.assign(vertices.size(), NONE);
+			openIn.assign(vertices.size(), NONE);
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				for (int e = 0; e < 3; ++e) {
+					const uint32_t a = indices[i + e];
+					const uint32_t b = indices[i + (e + 1) % 3];
+					if (HasEdge(b, a))
+						continue;
+					openOut[a] = openOut[a] == NONE ? b : MANY;
+					openIn[b] = openIn[b] == NONE ? a : MANY;
+				}
+			}
+
+			//Collapsed vertices stay in their position's ring; only those still referenced count
+			vector<uint8_t> referenced(vertices.size(), 0);
+			for (uint32_t index : indices)
+				referenced[index] = 1;
+
+			kind.assign(vertices.size(), KIND_LOCKED);
+			partner.assign(vertices.size(), NONE);
+			for (uint32_t p = 0; p < vertices.size(); ++p) {
+				if (position[p] != p)
+					continue;
+
+				uint32_t live[3];
+				int liveCount = 0;
+				uint32_t i = p;
+				do {
+					if (referenced[i] && liveCount < 3)
+						live[liveCount++] = i;
+					i = wedge[i];
+				} while (i != p);
+
+				VertexKind k = KIND_LOCKED;
+				if (liveCount == 1) {
+					const uint32_t v = live[0];
+					if (openOut[v] == NONE && openIn[v] == NONE)
+						k = KIND_MANIFOLD;
+					else if (openOut[v] < MANY && openIn[v] < MANY)
+						k = KIND_BORDER;
+				}
+				else if (liveCount == 2) {
+					const uint32_t v = live[0];
+					const uint32_t w = live[1];
+					if (openOut[v] < MANY && openIn[v] < MANY && openOut[w] < MANY && openIn[w] < MANY
+						&& position[openOut[v]] == position[openIn[w]] && position[openOut[w]] == position[openIn[v]]) {
+						k = KIND_SEAM;
+						partner[v] = w;
+						partner[w] = v;
+					}
+				}
+
+				for (int j = 0; j < liveCount; ++j)
+					kind[live[j]] = k;
+			}
+		}
+
+		//Area-weighted planes of every triangle, plus planes at right angles to every open edge so borders and seams
+		//keep their outline
+		void BuildQuadrics() {
+			quadrics.assign(vertices.size(), Quadric());
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				const uint32_t v[3] = { indices[i], indices[i + 1], indices[i + 2] };
+				const glm::vec3 cross = glm::cross(At(v[1]) - At(v[0]), At(v[2]) - At(v[0]));
+				const float length = glm::length(cross);
+				if (length <= 0.0f)
+					continue;
+				const glm::vec3 normal = cross / length;
+				const Quadric q = PlaneQuadric(normal, At(v[0]), length * 0.5f);
+				for (uint32_t vertex : v)
+					AddQuadric(quadrics[position[vertex]], q);
+
+				for (int e = 0; e < 3; ++e) {
+					const uint32_t a = v[e];
+					const uint32_t b = v[(e + 1) % 3];
+					if (openOut[a] != b)
+						continue;
+					const glm::vec3 edge = At(b) - At(a);
+					const float edgeLength = glm::length(edge);
+					if (edgeLength <= 0.0f)
+						continue;
+					const Quadric border = PlaneQuadric(glm::normalize(glm::cross(edge, normal)), At(a), edgeLength * edgeLength * BORDER_WEIGHT);
+					AddQuadric(quadrics[position[a]], border);
+					AddQuadric(quadrics[position[b]], border);
+				}
+			}
+		}
+
+		//Whether u may move onto v along the edge u -> v or v -> u of a triangle
+		bool CanCollapse(uint32_t u, uint32_t v) const {
+			switch (kind[u]) {
+			case KIND_MANIFOLD:
+				return true;
+			case KIND_BORDER:
+				return (kind[v] == KIND_BORDER || kind[v] == KIND_LOCKED) && (openOut[u] == v || openIn[u] == v);
+			case KIND_SEAM:
+				return (kind[v] == KIND_SEAM || kind[v] == KIND_LOCKED) && (openOut[u] == v || openIn[u] == v);
+			default:
+				return false;
+			}
+		}
+	};
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		float error;
+	};
+
+	//Whether moving position u onto v turns any triangle around u that survives the collapse by more than about 75
+	//degrees. Corners are looked up through this pass's remap, so earlier collapses in the pass are accounted for
+	bool FlipsTriangle(const Simplifier& s, const vector<uint32_t>& remap, uint32_t u, uint32_t v) {
+		const glm::vec3& target = s.At(v);
+		for (uint32_t k = s.triangles.offsets[u]; k < s.triangles.offsets[u + 1]; ++k) {
+			const uint32_t triangle = s.triangles.items[k];
+			uint32_t corner[3];
+			for (int c = 0; c < 3; ++c)
+				corner[c] = remap[s.indices[triangle * 3 + c]];
+			const uint32_t p[3] = { s.position[corner[0]], s.position[corner[1]], s.position[corner[2]] };
+			if (p[0] == s.position[v] || p[1] == s.position[v] || p[2] == s.position[v])
+				continue;
+
+			const int moved = p[0] == u ? 0 : p[1] == u ? 1 : 2;
+			const glm::vec3& a = s.At(corner[(moved + 1) % 3]);
+			const glm::vec3& b = s.At(corner[(moved + 2) % 3]);
+			const glm::vec3 before = glm::cross(a - s.At(corner[moved]), b - s.At(corner[moved]));
+			const glm::vec3 after = glm::cross(a - target, b - target);
+			const float beforeArea = glm::length(before);
+			const float afterArea = glm::length(after);
+			//A triangle that is already a sliver has no normal to compare against, so it stays as it is
+			if (beforeArea <= FLT_EPSILON * glm::dot(a - b, a - b))
+				return true;
+			//Squashing a triangle flat is the first half of folding it over, and a zero cross product passes the normal test
+			if (afterArea < FLIP_MIN_AREA * beforeArea || glm::dot(before, after) < 0.25f * beforeArea * afterArea)
+				return true;
+		}
+		return false;
+	}
+}
+
+MeshData USimplifyMesh(const MeshData& mesh, size_t targetTriangles, float maxError, SimplifyStats* stats) {
+	Simplifier s(mesh);
+	s.position = BuildPositionRemap(mesh.vertices);
+	s.BuildWedges();
+
+	SimplifyStats result;
+	result.sourceTriangles = mesh.indices.size() / 3;
+	const float maxErrorSquared = maxError < sqrt(FLT_MAX) ? maxError * maxError : FLT_MAX;
+	float largestError = 0.0f;
+
+	vector<Collapse> collapses;
+	vector<uint32_t> remap(mesh.vertices.size());
+	vector<uint8_t> locked(mesh.vertices.size());
+
+	//Each pass collapses a batch of the cheapest independent edges, then rebuilds the triangle list
+	while (s.indices.size() / 3 > targetTriangles) {
+		s.Classify();
+		if (result.passes == 0)
+			s.BuildQuadrics();
+		++result.passes;
+
+		//The cheaper allowed direction of every edge, once per edge where it has a twin
+		collapses.clear();
+		for (size_t i = 0; i < s.indices.size(); i += 3) {
+			for (int e = 0; e < 3; ++e) {
+				const uint32_t a = s.indices[i + e];
+				const uint32_t b = s.indices[i + (e + 1) % 3];
+				const uint32_t pa = s.position[a];
+				const uint32_t pb = s.position[b];
+				if (pa > pb && s.openOut[a] != b)
+					continue;
+
+				const float errorAB = s.CanCollapse(a, b) ? QuadricError(s.quadrics[pa], s.At(b)) : FLT_MAX;
+				const float errorBA = s.CanCollapse(b, a) ? QuadricError(s.quadrics[pb], s.At(a)) : FLT_MAX;
+				if (errorAB == FLT_MAX && errorBA == FLT_MAX)
+					continue;
+				collapses.push_back(errorAB <= errorBA ? Collapse{ a, b, errorAB } : Collapse{ b, a, errorBA });
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		//Only the cheapest are sorted: a collapse removes two triangles (one on a border), but locking and the flip
+		//test reject many, most of all near the end where the cheap edges left are the ones that keep failing
+		const size_t triangles = s.indices.size() / 3;
+		const size_t needed = triangles - targetTriangles;
+		const size_t considered = min(collapses.size(), max(needed * 2, collapses.size() / 8));
+		auto byError = [](const Collapse& x, const Collapse& y) { return x.error < y.error; };
+		nth_element(collapses.begin(), collapses.begin() + (considered - 1), collapses.end(), byError);
+		sort(collapses.begin(), collapses.begin() + considered, byError);
+
+		for (uint32_t i = 0; i < remap.size(); ++i)
+			remap[i] = i;
+		fill(locked.begin(), locked.end(), 0);
+
+		//Collapses in a pass never share a position, so none can invalidate another's cost
+		size_t removed = 0;
+		size_t applied = 0;
+		for (size_t c = 0; c < considered && removed < needed; ++c) {
+			const Collapse& collapse = collapses[c];
+			if (collapse.error > maxErrorSquared)
+				break;
+			const uint32_t u = s.position[collapse.from];
+			const uint32_t v = s.position[collapse.to];
+			if (locked[u] || locked[v])
+				continue;
+			if (FlipsTriangle(s, remap, u, collapse.to))
+				continue;
+
+			if (s.kind[collapse.from] == KIND_SEAM) {
+				//The other side of the seam follows its own half of the seam edge
+				const uint32_t otherFrom = s.partner[collapse.from];
+				const uint32_t otherTo = s.openOut[collapse.from] == collapse.to ? s.openIn[otherFrom] : s.openOut[otherFrom];
+				if (otherTo >= MANY || s.position[otherTo] != v)
+					continue;
+				remap[otherFrom] = otherTo;
+			}
+			remap[collapse.from] = collapse.to;
+
+			AddQuadric(s.quadrics[v], s.quadrics[u]);
+			locked[u] = locked[v] = 1;
+			removed += s.kind[collapse.from] == KIND_BORDER ? 1 : 2;
+			largestError = max(largestError, collapse.error);
+			++applied;
+		}
+		if (applied == 0)
+			break;
+
+		//Triangles that lost an edge are gone
+		size_t write = 0;
+		for (size_t i = 0; i < s.indices.size(); i += 3) {
+			const uint32_t a = remap[s.indices[i]];
+			const uint32_t b = remap[s.indices[i + 1]];
+			const uint32_t c = remap[s.indices[i + 2]];
+			const uint32_t pa = s.position[a];
+			const uint32_t pb = s.position[b];
+			const uint32_t pc = s.position[c];
+			if (pa == pb || pb == pc || pa == pc)
+				continue;
+			s.indices[write++] = a;
+			s.indices[write++] = b;
+			s.indices[write++] = c;
+		}
+		s.indices.resize(write);
+	}
+
+	//Keep the referenced vertices in their source order
+	MeshData simplified;
+	vector<uint32_t> newIndex(mesh.vertices.size(), NONE);
+	for (uint32_t index : s.indices)
+		newIndex[index] = 0;
+	for (uint32_t i = 0; i < newIndex.size(); ++i) {
+		if (newIndex[i] == NONE)
+			continue;
+		newIndex[i] = static_cast<uint32_t>(simplified.vertices.size());
+		simplified.vertices.push_back(mesh.vertices[i]);
+	}
+	simplified.indices.resize(s.indices.size());
+	for (size_t i = 0; i < s.indices.size(); ++i)
+		simplified.indices[i] = newIndex[s.indices[i]];
+
+	result.triangles = simplified.indices.size() / 3;
+	result.error = sqrt(largestError);
+	if (stats)
+		*stats = result;
+	return simplified;
+}
+
+vector<MeshData> USimplifyLodChain(const MeshData& mesh, int levels, float ratio, float maxError, vector<SimplifyStats>* stats) {
+	vector<MeshData> chain;
+	chain.push_back(mesh);
+	for (int level = 1; level < levels; ++level) {
+		const size_t triangles = chain.back().indices.size() / 3;
+		SimplifyStats levelStats;
+		MeshData next = USimplifyMesh(chain.back(), static_cast<size_t>(triangles * ratio), maxError, &levelStats);
+		if (levelStats.triangles + triangles / 20 >= triangles)
+			break;
+		chain.push_back(move(next));
+		if (stats)
+			stats->push_back(levelStats);
+	}
+	return chain;
+}
@@ -0,0 +1,30 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <cstddef>
+#include <vector>
+
+#include "MeshBuilder.h"
+
+//What a simplification did
+struct SimplifyStats {
+	size_t sourceTriangles = 0;
+	size_t triangles = 0;
+	float error = 0.0f;		//Largest distance a collapse moved the surface, object space
+	int passes = 0;
+};
+
+//Quadric error metric simplification (Garland and Heckbert) by half-edge collapse. Collapses the cheapest edges
+//until the mesh has at most targetTriangles triangles or the next collapse would move the surface by more than
+//maxError. A vertex only ever moves onto a neighbour, so the normals and texture coordinates that survive are the
+//source's own. Vertices where the attributes split (UV seams, hard edges) only slide along the seam and open
+//borders only along the border; collapses that would flip a triangle's normal or squash it flat are refused. The
+//result is indexed with unreferenced vertices removed, in source order
+MeshData USimplifyMesh(const MeshData& mesh, size_t targetTriangles, float maxError, SimplifyStats* stats = nullptr);
+
+//Level of detail chain: entry 0 is the mesh itself and each further level has about ratio times the triangles of
+//the one before, simplified from it. Ends early once a level barely shrinks. stats, when given, gets what each
+//simplification did, one entry per level after the first
+std::vector<MeshData> USimplifyLodChain(const MeshData& mesh, int levels, float ratio, float maxError, std::vector<SimplifyStats>* stats = nullptr);
+
+#endif
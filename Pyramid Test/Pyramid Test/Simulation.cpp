@@ -0,0 +1,153 @@
+#include "Simulation.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+	//Ticks the simulation may run back to back to catch up before it gives up on the time it lost, e.g. while the
+	//process was suspended
+	const int MAX_CATCH_UP_TICKS = 8;
+
+	SimulationState StateOf(const Camera& camera, bool perspective) {
+		SimulationState state;
+		state.position = camera.Position;
+		state.yaw = camera.Yaw;
+		state.pitch = camera.Pitch;
+		state.zoom = camera.Zoom;
+		state.perspective = perspective;
+		return state;
+	}
+}
+
+bool operator==(const SimulationState& a, const SimulationState& b) {
+	return a.position == b.position && a.yaw == b.yaw && a.pitch == b.pitch && a.zoom == b.zoom && a.perspective == b.perspective;
+}
+
+Simulation::~Simulation() {
+	Stop();
+}
+
+void Simulation::Start(const Camera& startCamera, bool startPerspective, int ticksPerSecond, const function<void()>& onChange) {
+	Stop();
+
+	camera = startCamera;
+	perspective = startPerspective;
+	state = StateOf(camera, perspective);
+	rate = max(ticksPerSecond, 1);
+	tickDuration = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / rate));
+	changed = onChange;
+	ticks = 0;
+	movedLastTick = false;
+	heldKeys = 0;
+	mouseLook = glm::vec2(0.0f);
+	projectionToggles = 0;
+
+	//The renderer has a settled state to draw before the first tick
+	SimulationSnapshot& first = snapshots.Back();
+	first.previous = first.current = state;
+	first.tick = 0;
+	first.time = chrono::steady_clock::now();
+	snapshots.Publish();
+
+	running = true;
+	worker = thread(&Simulation::Run, this);
+}
+
+void Simulation::Stop() {
+	running = false;
+	if (worker.joinable())
+		worker.join();
+}
+
+void Simulation::SetHeldKeys(unsigned movementBits) {
+	heldKeys = movementBits;
+}
+
+void Simulation::AddMouseLook(float xoffset, float yoffset) {
+	lock_guard<mutex> lock(inputMutex);
+	mouseLook += glm::vec2(xoffset, yoffset);
+}
+
+void Simulation::ToggleProjection() {
+	lock_guard<mutex> lock(inputMutex);
+	++projectionToggles;
+}
+
+SimulationState Simulation::Interpolate(chrono::steady_clock::time_point time, bool& settled) {
+	snapshots.Update();
+	const SimulationSnapshot& snapshot = snapshots.Front();
+	settled = snapshot.previous == snapshot.current;
+	if (settled)
+		return snapshot.current;
+
+	//How far past the snapshot's tick time is, as a fraction of a tick
+	const double t = chrono::duration<double>(time - snapshot.time).count() * rate;
+	const float alpha = static_cast<float>(min(max(t, 0.0), 1.0));
+
+	SimulationState blended = snapshot.current;
+	blended.position = glm::mix(snapshot.previous.position, snapshot.current.position, alpha);
+	blended.yaw = glm::mix(snapshot.previous.yaw, snapshot.current.yaw, alpha);
+	blended.pitch = glm::mix(snapshot.previous.pitch, snapshot.current.pitch, alpha);
+	blended.zoom = glm::mix(snapshot.previous.zoom, snapshot.current.zoom, alpha);
+	return blended;
+}
+
+void Simulation::Run() {
+	auto nextTick = chrono::steady_clock::now() + tickDuration;
+	while (running) {
+		this_thread::sleep_until(nextTick);
+
+		int caughtUp = 0;
+		const auto now = chrono::steady_clock::now();
+		while (nextTick <= now && caughtUp < MAX_CATCH_UP_TICKS) {
+			Step();
+			nextTick += tickDuration;
+			++caughtUp;
+		}
+		if (nextTick <= now)
+			nextTick = now + tickDuration;
+	}
+}
+
+//One fixed step: applies the input that arrived since the last one, then publishes the before and after states
+void Simulation::Step() {
+	glm::vec2 look;
+	int toggles;
+	{
+		lock_guard<mutex> lock(inputMutex);
+		look = mouseLook;
+		toggles = projectionToggles;
+		mouseLook = glm::vec2(0.0f);
+		projectionToggles = 0;
+	}
+
+	const SimulationState before = state;
+	if (look != glm::vec2(0.0f))
+		camera.ProcessMouseMovement(look.x, look.y);
+
+	const float seconds = 1.0f / rate;
+	const unsigned held = heldKeys;
+	for (Camera_Movement direction : { FORWARD, BACKWARD, LEFT, RIGHT, UP, DOWN }) {
+		if ((held & UMovementBit(direction)) != 0)
+			camera.ProcessKeyboard(direction, seconds);
+	}
+	if (toggles % 2 != 0)
+		perspective = !perspective;
+
+	state = StateOf(camera, perspective);
+	++ticks;
+
+	SimulationSnapshot& snapshot = snapshots.Back();
+	snapshot.previous = before;
+	snapshot.current = state;
+	snapshot.tick = ticks;
+	snapshot.time = chrono::steady_clock::now();
+	snapshots.Publish();
+
+	//The tick after the last change is worth a wake-up too: it settles the state
+	const bool moved = before != state;
+	if (changed && (moved || movedLastTick))
+		changed();
+	movedLastTick = moved;
+}
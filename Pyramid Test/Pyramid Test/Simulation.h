@@ -0,0 +1,87 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "camera.h"
+#include "TripleBuffer.h"
+
+//View state the simulation owns, as of one tick
+struct SimulationState {
+	glm::vec3 position = glm::vec3(0.0f);
+	float yaw = 0.0f;
+	float pitch = 0.0f;
+	float zoom = 0.0f;
+	bool perspective = true;
+};
+
+bool operator==(const SimulationState& a, const SimulationState& b);
+inline bool operator!=(const SimulationState& a, const SimulationState& b) { return !(a == b); }
+
+//One tick's result: the state before and after it, so the renderer can draw anywhere in between
+struct SimulationSnapshot {
+	SimulationState previous;
+	SimulationState current;
+	long long tick = 0;
+	std::chrono::steady_clock::time_point time;		//When current became the simulation's state
+};
+
+//Bits of the held movement keys, one per Camera_Movement
+inline unsigned UMovementBit(Camera_Movement direction) { return 1u << direction; }
+
+//Moves the camera at a fixed rate on a thread of its own, so movement is the same whatever the frame rate and a slow
+//frame does not hold it up. GLFW only reports input on the main thread, which forwards it here; the newest
+//snapshot goes back through a triple buffer
+class Simulation {
+public:
+	~Simulation();
+
+	//onChange runs on the simulation thread after a tick that changed the state, to wake a sleeping render loop
+	void Start(const Camera& camera, bool perspective, int ticksPerSecond, const std::function<void()>& onChange);
+	void Stop();
+
+	//Input, from the main thread. Applied at the next tick
+	void SetHeldKeys(unsigned movementBits);
+	void AddMouseLook(float xoffset, float yoffset);
+	void ToggleProjection();
+
+	//Render thread: the state at time, interpolated between the newest snapshot's two states. It trails the
+	//simulation by up to a tick. settled is false while the state is still changing
+	SimulationState Interpolate(std::chrono::steady_clock::time_point time, bool& settled);
+
+	long long Ticks() const { return ticks; }
+	int TicksPerSecond() const { return rate; }
+
+private:
+	void Run();
+	void Step();
+
+	std::thread worker;
+	std::atomic<bool> running{ false };
+	std::function<void()> changed;
+	int rate = 0;
+	std::chrono::steady_clock::duration tickDuration{};
+
+	//Simulation thread only
+	Camera camera;
+	bool perspective = true;
+	SimulationState state;
+	bool movedLastTick = false;
+	std::atomic<long long> ticks{ 0 };
+	TripleBuffer<SimulationSnapshot> snapshots;
+
+	//Input waiting for the next tick
+	std::atomic<unsigned> heldKeys{ 0 };
+	std::mutex inputMutex;
+	glm::vec2 mouseLook = glm::vec2(0.0f);
+	int projectionToggles = 0;
+};
+
+#endif
@@ -0,0 +1,253 @@
+#include "TextureArray.h"
+
+#include "ShaderProgram.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version " core \n" #Source
+#endif
+
+namespace {
+	//Fullscreen triangle made from gl_VertexID, no vertex buffer needed
+	const GLchar* resampleVertexShaderSource = GLSL(440,
+	void main()
+	{
+		vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+		gl_Position = vec4(corner * 2.0f - 1.0f, 0.0f, 1.0f);
+	}
+	);
+
+	//Samples the source at each layer texel's centre, so a same-sized source is copied texel for texel
+	const GLchar* resampleFragmentShaderSource = GLSL(440,
+	uniform sampler2D source;
+	uniform vec2 layerSize;
+	out vec4 color;
+
+	void main()
+	{
+		color = texture(source, gl_FragCoord.xy / layerSize);
+	}
+	);
+
+	struct SourceInfo {
+		int width = 0;
+		int height = 0;
+		int levels = 0;
+		GLint internalFormat = 0;
+		bool compressed = false;
+		double megabytes = 0.0;
+	};
+
+	//Size, format and defined mip levels of a 2D texture, read back from GL
+	SourceInfo QuerySource(GLuint texture) {
+		SourceInfo info;
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &info.width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &info.height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &info.internalFormat);
+		GLint compressed = GL_FALSE;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+		info.compressed = compressed == GL_TRUE;
+
+		for (GLint width = info.width; width > 0; ++info.levels) {
+			GLint height = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, info.levels, GL_TEXTURE_HEIGHT, &height);
+			if (info.compressed) {
+				GLint bytes = 0;
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, info.levels, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &bytes);
+				info.megabytes += bytes / (1024.0 * 1024.0);
+			}
+			else {
+				//Drivers store RGB8 as RGBA8
+				info.megabytes += width * static_cast<double>(height) * 4.0 / (1024.0 * 1024.0);
+			}
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, info.levels + 1, GL_TEXTURE_WIDTH, &width);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return info;
+	}
+
+	int FullMipLevels(int width, int height) {
+		int levels = 1;
+		for (int size = max(width, height); size > 1; size /= 2)
+			++levels;
+		return levels;
+	}
+
+	//Copies every level of a source into its layer, compressed blocks included
+	void CopyLayer(GLuint texture, int layer, const GLTextureArray& array) {
+		int width = array.width;
+		int height = array.height;
+		for (int level = 0; level < array.levels; ++level) {
+			glCopyImageSubData(texture, GL_TEXTURE_2D, level, 0, 0, 0, array.id, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1);
+			width = max(1, width / 2);
+			height = max(1, height / 2);
+		}
+	}
+
+	//Draws the sources into their layers through a fullscreen triangle, once per mip level. The sampler is
+	//trilinear, so every level reads the source mip nearest its own size and no mipmap pass is needed afterwards
+	bool RenderLayers(const vector<GLuint>& textures, const vector<bool>& render, GLTextureArray& array) {
+		GLShaderProgram program;
+		if (!UCreateShaderProgram(resampleVertexShaderSource, resampleFragmentShaderSource, program))
+			return false;
+		glUniform1i(glGetUniformLocation(program.id, "source"), 0);
+		const GLint layerSizeLoc = glGetUniformLocation(program.id, "layerSize");
+
+		//Whatever the caller had bound comes back afterwards (the headless target is an FBO)
+		GLint previousFramebuffer = 0;
+		GLint previousViewport[4];
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		glGetIntegerv(GL_VIEWPORT, previousViewport);
+		const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+		//Same wrapping as the sources, so texels at the layer edges blend with the opposite edge as before
+		GLuint sampler = 0;
+		glGenSamplers(1, &sampler);
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindSampler(0, sampler);
+
+		GLuint vao = 0;
+		GLuint fbo = 0;
+		glGenVertexArrays(1, &vao);
+		glGenFramebuffers(1, &fbo);
+		glBindVertexArray(vao);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glDisable(GL_DEPTH_TEST);
+		glActiveTexture(GL_TEXTURE0);
+
+		bool success = true;
+		for (int layer = 0; layer < array.layers && success; ++layer) {
+			if (!render[layer])
+				continue;
+
+			glBindTexture(GL_TEXTURE_2D, textures[layer]);
+			int width = array.width;
+			int height = array.height;
+			for (int level = 0; level < array.levels; ++level) {
+				glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array.id, level, layer);
+				if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+					cout << "Texture array layer " << layer << " cannot be rendered to" << endl;
+					success = false;
+					break;
+				}
+				glViewport(0, 0, width, height);
+				glUniform2f(layerSizeLoc, static_cast<float>(width), static_cast<float>(height));
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+				width = max(1, width / 2);
+				height = max(1, height / 2);
+			}
+		}
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindSampler(0, 0);
+		glBindVertexArray(0);
+		glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+		glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+		if (depthTest)
+			glEnable(GL_DEPTH_TEST);
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteVertexArrays(1, &vao);
+		glDeleteSamplers(1, &sampler);
+		UDestroyShaderProgram(program);
+		glUseProgram(0);
+		return success;
+	}
+}
+
+bool UPackTextureArray(const vector<GLuint>& textures, int maxLayerSize, GLTextureArray& array) {
+	array = GLTextureArray();
+	if (textures.empty())
+		return true;
+
+	GLint maxLayers = 0;
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	if (static_cast<GLint>(textures.size()) > maxLayers) {
+		cout << "The scene has " << textures.size() << " textures, more than the " << maxLayers << " layers a texture array can hold" << endl;
+		return false;
+	}
+
+	vector<SourceInfo> sources;
+	for (GLuint texture : textures)
+		sources.push_back(QuerySource(texture));
+
+	//Layers take the largest size among the textures, within the cap
+	const int sizeCap = maxLayerSize > 0 ? min<int>(maxLayerSize, maxSize) : maxSize;
+	for (const SourceInfo& source : sources) {
+		array.width = max(array.width, source.width);
+		array.height = max(array.height, source.height);
+	}
+	array.width = min(array.width, sizeCap);
+	array.height = min(array.height, sizeCap);
+	array.levels = FullMipLevels(array.width, array.height);
+	array.layers = static_cast<int>(textures.size());
+
+	//The array takes the format of the first texture already at layer size; textures matching it in format and mip
+	//chain are copied, the rest are drawn. Compressed formats cannot be drawn into, so mixing falls back to RGBA8
+	array.internalFormat = GL_RGBA8;
+	bool compressed = false;
+	for (const SourceInfo& source : sources) {
+		if (source.width == array.width && source.height == array.height && source.levels == array.levels) {
+			array.internalFormat = source.internalFormat;
+			compressed = source.compressed;
+			break;
+		}
+	}
+
+	vector<bool> render(array.layers);
+	int rendered = 0;
+	for (int i = 0; i < array.layers; ++i) {
+		const SourceInfo& source = sources[i];
+		render[i] = source.width != array.width || source.height != array.height || source.internalFormat != static_cast<GLint>(array.internalFormat)
+			|| source.levels != array.levels;
+		rendered += render[i] ? 1 : 0;
+	}
+	if (compressed && rendered > 0) {
+		cout << "INFO: Scene textures differ in size or format, the compressed ones are expanded to RGBA8 in the texture array"
+			<< " (bake them at one size with texbake --size=N to keep them compressed)" << endl;
+		array.internalFormat = GL_RGBA8;
+		compressed = false;
+		render.assign(array.layers, true);
+		rendered = array.layers;
+	}
+	array.resampled = rendered;
+
+	if (compressed)
+		array.megabytes = sources[0].megabytes * array.layers;
+	else
+		array.megabytes = array.width * static_cast<double>(array.height) * 4.0 * 4.0 / 3.0 * array.layers / (1024.0 * 1024.0);
+
+	glGenTextures(1, &array.id);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, array.levels, array.internalFormat, array.width, array.height, array.layers);
+
+	//Same sampling the individual textures had
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	for (int i = 0; i < array.layers; ++i)
+		if (!render[i])
+			CopyLayer(textures[i], i, array);
+	if (rendered > 0 && !RenderLayers(textures, render, array)) {
+		UDestroyTextureArray(array);
+		return false;
+	}
+	return true;
+}
+
+void UDestroyTextureArray(GLTextureArray& array) {
+	glDeleteTextures(1, &array.id);
+	array = GLTextureArray();
+}
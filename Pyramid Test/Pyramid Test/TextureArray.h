@@ -0,0 +1,29 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <GL/glew.h>
+
+#include <vector>
+
+//Every scene texture as one layer of a GL_TEXTURE_2D_ARRAY, so a frame binds a single texture and draws that only
+//differ in texture can share an instanced draw
+struct GLTextureArray {
+	GLuint id = 0;
+	int width = 0;
+	int height = 0;
+	int layers = 0;
+	int levels = 0;
+	GLenum internalFormat = 0;
+	int resampled = 0;			//Layers drawn from their texture rather than copied
+	double megabytes = 0.0;
+};
+
+//Packs textures[i] into layer i. Layers are as large as the largest texture (maxLayerSize > 0 caps them) and have a
+//full mip chain. Textures already of that size, format and chain are copied level by level, compressed blocks
+//included; the others are drawn into their layer at every level, sampled with repeat wrapping like the originals.
+//A compressed array cannot be drawn into, so a mix of compressed and other textures packs as RGBA8. The source
+//textures are left alone; callers delete them once packed
+bool UPackTextureArray(const std::vector<GLuint>& textures, int maxLayerSize, GLTextureArray& array);
+void UDestroyTextureArray(GLTextureArray& array);
+
+#endif
@@ -0,0 +1,256 @@
+#include "TextureLoader.h"
+
+#include "ImageFlip.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace {
+	double MillisecondsSince(chrono::steady_clock::time_point start) {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+
+	//Streams the pixels through the pixel unpack buffer, orphaning it per image so the copy never waits on the previous transfer
+	void UploadImage(GLuint pbo, const unsigned char* pixels, int width, int height, int channels, GLuint& textureId) {
+		const size_t bytes = static_cast<size_t>(width) * height * channels;
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+		void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		memcpy(mapped, pixels, bytes);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		glGenTextures(1, &textureId);
+		glBindTexture(GL_TEXTURE_2D, textureId);
+
+		//Texture wrapping parameters
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		//Texture filtering parameters
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		//Rows of three-channel images are tightly packed, not padded to four bytes
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (channels == 3)
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+		else
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	//BC1 and BC3 come with GL_EXT_texture_compression_s3tc, which every desktop driver exposes but core GL does not promise
+	bool S3tcSupported() {
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; ++i) {
+			const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (name && strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+				return true;
+		}
+		return false;
+	}
+
+	//Hands every level of a validated baked file to GL as-is, straight from the mapping; returns the bytes uploaded
+	size_t UploadBakedImage(const MappedFile& file, GLuint& textureId) {
+		const BakedTextureHeader* header = nullptr;
+		const BakedTextureLevel* levels = nullptr;
+		string error;
+		UValidateBakedTexture(file.Data(), file.Size(), header, levels, error);
+		const GLenum internalFormat = header->format == BAKED_FORMAT_BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+		glGenTextures(1, &textureId);
+		glBindTexture(GL_TEXTURE_2D, textureId);
+
+		//Same sampling as decoded textures
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(header->levelCount) - 1);
+
+		size_t bytes = 0;
+		for (uint32_t i = 0; i < header->levelCount; ++i) {
+			const BakedTextureLevel& level = levels[i];
+			glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), internalFormat, static_cast<GLsizei>(level.width),
+				static_cast<GLsizei>(level.height), 0, static_cast<GLsizei>(level.size), file.Data() + level.offset);
+			bytes += static_cast<size_t>(level.size);
+		}
+		return bytes;
+	}
+}
+
+TextureLoader::~TextureLoader() {
+	//Startup can bail out before Finish(); decodes still in flight are waited for and dropped
+	Join();
+	for (DecodedImage& image : decoded)
+		stbi_image_free(image.pixels);
+}
+
+void TextureLoader::Start(const vector<string>& files, bool useBaked, TextureFlip flipMode) {
+	paths = files;
+	flip = flipMode;
+	decoded.clear();
+	baked.clear();
+	decodeIndices.clear();
+	nextFile = 0;
+	startTime = chrono::steady_clock::now();
+
+	const bool compressedSupported = useBaked && S3tcSupported();
+	if (useBaked && !compressedSupported)
+		cout << "INFO: GL_EXT_texture_compression_s3tc is not supported, decoding every texture" << endl;
+	for (int i = 0; i < static_cast<int>(paths.size()); ++i) {
+		baked.push_back(compressedSupported ? MapBaked(i) : nullptr);
+		if (!baked.back())
+			decodeIndices.push_back(i);
+	}
+
+	//stb_image keeps no shared state while decoding, so each worker pulls the next file and decodes it independently
+	const int threadCount = max(1, min(static_cast<int>(decodeIndices.size()), static_cast<int>(thread::hardware_concurrency())));
+	for (int t = 0; t < threadCount && !decodeIndices.empty(); ++t)
+		workers.emplace_back(&TextureLoader::DecodeLoop, this);
+}
+
+unique_ptr<MappedFile> TextureLoader::MapBaked(int index) const {
+	const string bakedPath = UBakedTexturePath(paths[index]);
+	unique_ptr<MappedFile> file(new MappedFile());
+	if (!file->Open(bakedPath))
+		return nullptr;
+
+	const BakedTextureHeader* header = nullptr;
+	const BakedTextureLevel* levels = nullptr;
+	string error;
+	if (!UValidateBakedTexture(file->Data(), file->Size(), header, levels, error)) {
+		cout << "INFO: Ignoring " << bakedPath << " (" << error << "), decoding " << paths[index] << " instead" << endl;
+		return nullptr;
+	}
+	return file;
+}
+
+void TextureLoader::DecodeLoop() {
+	//The flag is per thread, so workers can disagree with whatever the rest of the program set
+	stbi_set_flip_vertically_on_load_thread(flip == TEXTURE_FLIP_STB ? 1 : 0);
+
+	const int count = static_cast<int>(decodeIndices.size());
+	for (int next = nextFile++; next < count; next = nextFile++) {
+		const int index = decodeIndices[next];
+		const auto decodeStart = chrono::steady_clock::now();
+		DecodedImage image;
+		image.index = index;
+		image.pixels = stbi_load(paths[index].c_str(), &image.width, &image.height, &image.channels, 0);
+		if (image.pixels && flip == TEXTURE_FLIP_ROWS) {
+			const auto flipStart = chrono::steady_clock::now();
+			flipImageVertically(image.pixels, image.width, image.height, image.channels);
+			image.flipMs = MillisecondsSince(flipStart);
+		}
+		image.decodeMs = MillisecondsSince(decodeStart);
+
+		{
+			lock_guard<mutex> lock(queueMutex);
+			decoded.push_back(image);
+		}
+		ready.notify_one();
+	}
+}
+
+void TextureLoader::Join() {
+	for (thread& worker : workers)
+		worker.join();
+	workers.clear();
+}
+
+bool TextureLoader::Finish(vector<GLuint>& ids, TextureLoadStats& stats) {
+	const int count = static_cast<int>(paths.size());
+	ids.assign(count, 0);
+	topDown.assign(count, false);
+	stats = TextureLoadStats();
+	stats.textures = count;
+	stats.threads = static_cast<int>(workers.size());
+
+	//Baked files are ready to go, upload them while the first decodes finish
+	for (int index = 0; index < count; ++index) {
+		if (!baked[index])
+			continue;
+
+		const auto uploadStart = chrono::steady_clock::now();
+		const size_t bytes = UploadBakedImage(*baked[index], ids[index]);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		const double uploadMs = MillisecondsSince(uploadStart);
+		baked[index].reset();
+
+		++stats.baked;
+		stats.uploadMs += uploadMs;
+		stats.megabytes += bytes / (1024.0 * 1024.0);
+
+		ostringstream report;
+		report << "INFO: Texture " << UBakedTexturePath(paths[index]) << ": baked, " << fixed << setprecision(2) << bytes / (1024.0 * 1024.0)
+			<< " MB, upload " << uploadMs << " ms";
+		cout << report.str() << endl;
+	}
+
+	//Every decoded file produces exactly one entry, failed or not
+	GLuint pbo = 0;
+	glGenBuffers(1, &pbo);
+	bool success = true;
+	const int decodeCount = static_cast<int>(decodeIndices.size());
+	for (int received = 0; received < decodeCount; ++received) {
+		DecodedImage image;
+		{
+			const auto waitStart = chrono::steady_clock::now();
+			unique_lock<mutex> lock(queueMutex);
+			ready.wait(lock, [&]() { return !decoded.empty(); });
+			image = decoded.back();
+			decoded.pop_back();
+			stats.waitMs += MillisecondsSince(waitStart);
+		}
+		stats.decodeMs += image.decodeMs;
+		stats.flipMs += image.flipMs;
+
+		if (!image.pixels) {
+			cout << "Failed to load texture " << paths[image.index] << endl;
+			success = false;
+			continue;
+		}
+		if (image.channels != 3 && image.channels != 4) {
+			cout << "Not implemented to handle image with " << image.channels << " channels (" << paths[image.index] << ")" << endl;
+			stbi_image_free(image.pixels);
+			success = false;
+			continue;
+		}
+
+		auto stepStart = chrono::steady_clock::now();
+		UploadImage(pbo, image.pixels, image.width, image.height, image.channels, ids[image.index]);
+		double uploadMs = MillisecondsSince(stepStart);
+
+		stepStart = chrono::steady_clock::now();
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture.
+		double mipmapMs = MillisecondsSince(stepStart);
+
+		stbi_image_free(image.pixels);
+		topDown[image.index] = flip == TEXTURE_FLIP_NONE;
+		stats.uploadMs += uploadMs;
+		stats.mipmapMs += mipmapMs;
+		stats.megabytes += image.width * static_cast<double>(image.height) * 4.0 * 4.0 / 3.0 / (1024.0 * 1024.0);
+
+		ostringstream report;
+		report << "INFO: Texture " << paths[image.index] << ": " << image.width << "x" << image.height << "x" << image.channels
+			<< fixed << setprecision(2) << ", decode " << image.decodeMs << " ms (flip " << image.flipMs << " ms), upload " << uploadMs << " ms, mipmap " << mipmapMs << " ms";
+		cout << report.str() << endl;
+	}
+
+	Join();
+	glDeleteBuffers(1, &pbo);
+
+	stats.wallMs = MillisecondsSince(startTime);
+	return success;
+}
@@ -0,0 +1,88 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <GL/glew.h>
+
+#include "BakedTexture.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Where texture loading spent its time, for the startup report. Decode time is summed over the worker
+//threads; upload and mipmap times are CPU time on the GL thread
+struct TextureLoadStats {
+	int textures = 0;
+	int baked = 0;			//Uploaded from a .btx file, no decode or mipmap step
+	int threads = 0;
+	double wallMs = 0.0;		//Start() to the last upload
+	double waitMs = 0.0;		//Time Finish() spent blocked on decodes that were not done yet
+	double decodeMs = 0.0;
+	double flipMs = 0.0;		//Part of decodeMs spent in flipImageVertically (TEXTURE_FLIP_ROWS only)
+	double uploadMs = 0.0;		//Copy into the pixel buffer and glTexImage2D
+	double mipmapMs = 0.0;
+	double megabytes = 0.0;		//Texture memory: exact for baked files, 4 bytes per texel plus mips for decoded ones
+};
+
+//How decoded images get GL's bottom-up row order
+enum TextureFlip {
+	TEXTURE_FLIP_ROWS = 0,	//Decode, then swap rows with flipImageVertically
+	TEXTURE_FLIP_STB,		//stb_image writes the rows bottom-up while decoding
+	TEXTURE_FLIP_NONE		//Upload top-down and let the shader mirror v (SceneTexture::rowsTopDown)
+};
+
+//Decodes image files on worker threads while the GL thread does other startup work, then uploads each one
+//through a pixel buffer object as soon as its decode is done. Files with a baked copy (see texbake) skip all of
+//that: the copy is memory mapped and its compressed levels go straight to glCompressedTexImage2D
+class TextureLoader {
+public:
+	~TextureLoader();
+
+	//Maps the baked copies that exist, starts decoding every other file and returns. Call with a current GL
+	//context, it checks the compressed formats are supported
+	void Start(const std::vector<std::string>& paths, bool useBaked = true, TextureFlip flip = TEXTURE_FLIP_ROWS);
+
+	//Uploads on the calling (GL) thread in completion order, blocking until every file is handled. ids receives
+	//one texture per path, 0 for files that failed; returns false if any did
+	bool Finish(std::vector<GLuint>& ids, TextureLoadStats& stats);
+
+	//After Finish(): whether paths[index] was uploaded with its first file row at v = 0. Baked files never are
+	bool RowsTopDown(int index) const { return topDown[index]; }
+
+private:
+	//One decoded file handed from a worker to the GL thread
+	struct DecodedImage {
+		int index = 0;
+		unsigned char* pixels = nullptr;	//Null if stb_image could not read the file
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		double decodeMs = 0.0;
+		double flipMs = 0.0;
+	};
+
+	void DecodeLoop();
+	void Join();
+
+	//Maps the baked copy of paths[index] if there is a usable one
+	std::unique_ptr<MappedFile> MapBaked(int index) const;
+
+	std::vector<std::string> paths;
+	std::vector<std::unique_ptr<MappedFile>> baked;	//Per path, null for files that are decoded
+	std::vector<int> decodeIndices;
+	std::vector<bool> topDown;
+	TextureFlip flip = TEXTURE_FLIP_ROWS;
+	std::vector<std::thread> workers;
+	std::mutex queueMutex;
+	std::condition_variable ready;
+	std::vector<DecodedImage> decoded;
+	std::atomic<int> nextFile{ 0 };
+	std::chrono::steady_clock::time_point startTime;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+//Hands the newest value from one writer thread to one reader thread without locks. The writer fills its back slot
+//and publishes it by swapping it with the middle slot; the reader swaps the middle slot into its front slot when it
+//holds something newer. Neither side ever waits, the reader always sees a whole value, and values the reader was too
+//slow to take are dropped
+template <typename T>
+class TripleBuffer {
+public:
+	//Writer side
+	T& Back() { return slots[back]; }
+	void Publish() { back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+	//Reader side. Update takes the newest published value, if there is one, and returns whether it did
+	bool Update() {
+		if ((middle.load(std::memory_order_acquire) & FRESH) == 0)
+			return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+	const T& Front() const { return slots[front]; }
+
+private:
+	static const unsigned INDEX = 3;	//Low bits of middle: the slot it names
+	static const unsigned FRESH = 4;	//Set while the middle slot holds a value the reader has not taken
+
+	T slots[3] = {};
+	std::atomic<unsigned> middle{ 1 };
+	unsigned back = 0;
+	unsigned front = 2;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "WorkerPool.h"
+
+using namespace std;
+
+WorkerPool::~WorkerPool() {
+	Stop();
+}
+
+void WorkerPool::Start(int threadCount) {
+	Stop();
+
+	if (threadCount <= 0)
+		threadCount = static_cast<int>(thread::hardware_concurrency()) - 1;
+
+	stopping = false;
+	for (int i = 0; i < threadCount; ++i)
+		threads.emplace_back(&WorkerPool::WorkerLoop, this);
+}
+
+void WorkerPool::Stop() {
+	{
+		lock_guard<mutex> lock(jobMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (thread& worker : threads)
+		worker.join();
+	threads.clear();
+}
+
+void WorkerPool::ParallelFor(int count, const function<void(int)>& job) {
+	if (count <= 0)
+		return;
+
+	//Not worth a wake-up
+	if (threads.empty() || count == 1) {
+		for (int i = 0; i < count; ++i)
+			job(i);
+		return;
+	}
+
+	{
+		//A worker that woke late for the previous job may still be draining it
+		unique_lock<mutex> lock(jobMutex);
+		done.wait(lock, [this] { return activeWorkers == 0; });
+
+		currentJob = &job;
+		jobCount = count;
+		nextIndex = 0;
+		remaining = count;
+		++generation;
+	}
+	wake.notify_all();
+
+	RunJobs();
+
+	//Workers still inside RunJobs hold the job pointer, so wait for them to leave as well
+	unique_lock<mutex> lock(jobMutex);
+	done.wait(lock, [this] { return remaining == 0 && activeWorkers == 0; });
+	currentJob = nullptr;
+}
+
+void WorkerPool::WorkerLoop() {
+	unsigned seen = 0;
+	for (;;) {
+		{
+			unique_lock<mutex> lock(jobMutex);
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+			++activeWorkers;
+		}
+
+		RunJobs();
+
+		{
+			lock_guard<mutex> lock(jobMutex);
+			--activeWorkers;
+		}
+		done.notify_all();
+	}
+}
+
+void WorkerPool::RunJobs() {
+	for (;;) {
+		int index = nextIndex++;
+		if (index >= jobCount)
+			return;
+
+		(*currentJob)(index);
+
+		if (--remaining == 0) {
+			lock_guard<mutex> lock(jobMutex);
+			done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Persistent worker threads for splitting per-frame CPU work. Threads are started once and sleep
+//between jobs, so a frame only pays for a wake-up instead of thread creation
+class WorkerPool {
+public:
+	~WorkerPool();
+
+	//threadCount 0 uses one worker per hardware thread, minus the calling thread
+	void Start(int threadCount = 0);
+	void Stop();
+
+	int ThreadCount() const { return static_cast<int>(threads.size()) + 1; }
+
+	//Runs job(index) for every index in [0, count) on the workers and the calling thread, returning when all are done
+	void ParallelFor(int count, const std::function<void(int)>& job);
+
+private:
+	void WorkerLoop();
+	void RunJobs();
+
+	std::vector<std::thread> threads;
+	std::mutex jobMutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	const std::function<void(int)>* currentJob = nullptr;
+	int jobCount = 0;
+	std::atomic<int> nextIndex{ 0 };
+	std::atomic<int> remaining{ 0 };
+	int activeWorkers = 0;		//Workers that picked up the current generation and have not finished it
+	unsigned generation = 0;
+	bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,315 @@
+//meshsimplify: builds level of detail chains for imported meshes with the quadric simplifier of Simplify.h. Run it
+//from the Pyramid Test directory:
+//  meshsimplify [--levels=N] [--ratio=R] [--error=E] mesh.obj ...
+//writes mesh_lod1.obj, mesh_lod2.obj ... next to each source, each level about R (default 0.5) times the triangles
+//of the one before, for up to N (default 5) levels including the source. --error=E stops a level early once a
+//collapse would move the surface by more than E times the mesh's bounding radius.
+//  meshsimplify --benchmark[=N]
+//times simplification of a generated N triangle sphere (default a million) to every level of the chain and reports
+//triangles per second instead.
+//  meshsimplify --check [--levels=N] [--ratio=R]
+//simplifies a flat 60 x 60 grid down the chain and fails if any level has lost area or holds a degenerate or
+//reversed triangle.
+
+#include "MeshBuilder.h"
+#include "Primitives.h"
+#include "Simplify.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	//Wavefront OBJ: positions, texture coordinates and normals, polygons fanned into triangles. Every distinct
+	//position/uv/normal triple becomes one vertex, so seams stay split the way the file has them
+	bool LoadObj(const string& path, MeshData& mesh) {
+		ifstream in(path);
+		if (!in) {
+			cout << "Failed to open " << path << endl;
+			return false;
+		}
+
+		vector<glm::vec3> positions;
+		vector<glm::vec2> uvs;
+		vector<glm::vec3> normals;
+		map<tuple<int, int, int>, uint32_t> vertexOf;
+		string line;
+		while (getline(in, line)) {
+			istringstream tokens(line);
+			string type;
+			tokens >> type;
+			if (type == "v") {
+				glm::vec3 p;
+				tokens >> p.x >> p.y >> p.z;
+				positions.push_back(p);
+			}
+			else if (type == "vt") {
+				glm::vec2 uv;
+				tokens >> uv.x >> uv.y;
+				uvs.push_back(uv);
+			}
+			else if (type == "vn") {
+				glm::vec3 n;
+				tokens >> n.x >> n.y >> n.z;
+				normals.push_back(n);
+			}
+			else if (type == "f") {
+				vector<uint32_t> polygon;
+				string corner;
+				while (tokens >> corner) {
+					//v, v/vt, v//vn or v/vt/vn; negative indices count back from the end
+					int index[3] = { 0, 0, 0 };
+					size_t start = 0;
+					for (int k = 0; k < 3 && start <= corner.size(); ++k) {
+						const size_t slash = corner.find('/', start);
+						const string field = corner.substr(start, slash == string::npos ? string::npos : slash - start);
+						if (!field.empty())
+							index[k] = atoi(field.c_str());
+						if (slash == string::npos)
+							break;
+						start = slash + 1;
+					}
+					const int counts[3] = { static_cast<int>(positions.size()), static_cast<int>(uvs.size()), static_cast<int>(normals.size()) };
+					for (int k = 0; k < 3; ++k)
+						index[k] = index[k] < 0 ? counts[k] + index[k] : index[k] - 1;
+					if (index[0] < 0 || index[0] >= counts[0] || index[1] >= counts[1] || index[2] >= counts[2]) {
+						cout << "Bad face index in " << path << ": " << line << endl;
+						return false;
+					}
+
+					auto key = make_tuple(index[0], index[1], index[2]);
+					auto found = vertexOf.find(key);
+					if (found == vertexOf.end()) {
+						MeshVertex vertex;
+						vertex.position = positions[index[0]];
+						vertex.uv = index[1] >= 0 ? uvs[index[1]] : glm::vec2(0.0f);
+						vertex.normal = index[2] >= 0 ? normals[index[2]] : glm::vec3(0.0f);
+						found = vertexOf.emplace(key, static_cast<uint32_t>(mesh.vertices.size())).first;
+						mesh.vertices.push_back(vertex);
+					}
+					polygon.push_back(found->second);
+				}
+				for (size_t k = 2; k < polygon.size(); ++k) {
+					mesh.indices.push_back(polygon[0]);
+					mesh.indices.push_back(polygon[k - 1]);
+					mesh.indices.push_back(polygon[k]);
+				}
+			}
+		}
+
+		if (mesh.indices.empty()) {
+			cout << path << " has no faces" << endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool SaveObj(const string& path, const MeshData& mesh) {
+		ofstream out(path);
+		if (!out) {
+			cout << "Failed to open " << path << " for writing" << endl;
+			return false;
+		}
+
+		out << setprecision(7);
+		for (const MeshVertex& vertex : mesh.vertices)
+			out << "v " << vertex.position.x << " " << vertex.position.y << " " << vertex.position.z << "\n";
+		for (const MeshVertex& vertex : mesh.vertices)
+			out << "vt " << vertex.uv.x << " " << vertex.uv.y << "\n";
+		for (const MeshVertex& vertex : mesh.vertices)
+			out << "vn " << vertex.normal.x << " " << vertex.normal.y << " " << vertex.normal.z << "\n";
+		for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+			out << "f";
+			for (size_t k = 0; k < 3; ++k) {
+				const uint32_t index = mesh.indices[i + k] + 1;
+				out << " " << index << "/" << index << "/" << index;
+			}
+			out << "\n";
+		}
+		return static_cast<bool>(out);
+	}
+
+	//Distance from the middle of the bounding box to the farthest vertex
+	float BoundingRadius(const MeshData& mesh) {
+		glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+		for (const MeshVertex& vertex : mesh.vertices) {
+			low = glm::min(low, vertex.position);
+			high = glm::max(high, vertex.position);
+		}
+		const glm::vec3 center = (low + high) * 0.5f;
+		float radius = 0.0f;
+		for (const MeshVertex& vertex : mesh.vertices)
+			radius = max(radius, glm::length(vertex.position - center));
+		return radius;
+	}
+
+	bool SimplifyFile(const string& path, int levels, float ratio, float relativeError) {
+		MeshData mesh;
+		if (!LoadObj(path, mesh))
+			return false;
+
+		const float maxError = relativeError > 0.0f ? relativeError * BoundingRadius(mesh) : FLT_MAX;
+		const string stem = path.size() > 4 && path.compare(path.size() - 4, 4, ".obj") == 0 ? path.substr(0, path.size() - 4) : path;
+		vector<SimplifyStats> stats;
+		const auto start = chrono::steady_clock::now();
+		const vector<MeshData> chain = USimplifyLodChain(mesh, levels, ratio, maxError, &stats);
+		const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		for (size_t i = 1; i < chain.size(); ++i) {
+			const string output = stem + "_lod" + to_string(i) + ".obj";
+			if (!SaveObj(output, chain[i]))
+				return false;
+			ostringstream report;
+			report << "INFO: " << output << ": " << stats[i - 1].sourceTriangles << " -> " << stats[i - 1].triangles << " triangles, "
+				<< chain[i].vertices.size() << " vertices, error " << scientific << setprecision(2) << stats[i - 1].error;
+			cout << report.str() << endl;
+		}
+		if (static_cast<int>(chain.size()) < levels)
+			cout << "INFO: " << path << " stops at level " << chain.size() - 1 << ", " << chain.back().indices.size() / 3 << " triangles" << endl;
+		ostringstream report;
+		report << "INFO: " << path << ": " << chain.size() - 1 << " levels in " << fixed << setprecision(1) << seconds * 1000.0 << " ms";
+		cout << report.str() << endl;
+		return true;
+	}
+
+	//Flat square of cells x cells quads in the XZ plane facing +Y, one unit across
+	MeshData FlatGrid(int cells) {
+		MeshData mesh;
+		for (int i = 0; i <= cells; ++i)
+			for (int j = 0; j <= cells; ++j) {
+				MeshVertex vertex;
+				vertex.position = glm::vec3(static_cast<float>(i) / cells, 0.0f, static_cast<float>(j) / cells);
+				vertex.uv = glm::vec2(vertex.position.x, vertex.position.z);
+				vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+				mesh.vertices.push_back(vertex);
+			}
+		for (int i = 0; i < cells; ++i)
+			for (int j = 0; j < cells; ++j) {
+				const uint32_t corner = static_cast<uint32_t>(i * (cells + 1) + j);
+				const uint32_t next = corner + static_cast<uint32_t>(cells + 1);
+				const uint32_t quad[6] = { corner, corner + 1, next, next, corner + 1, next + 1 };
+				mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+			}
+		return mesh;
+	}
+
+	//Every collapse on a flat grid costs nothing except those cutting a corner off, which the error bound refuses, so
+	//the area stays the same through every level unless a collapse folded a triangle over or squashed it flat
+	bool Check(int levels, float ratio) {
+		const int CELLS = 60;
+		const vector<MeshData> chain = USimplifyLodChain(FlatGrid(CELLS), levels, ratio, 1e-4f);
+		const float smallest = 1e-3f / (CELLS * CELLS);
+		bool passed = true;
+		for (size_t i = 0; i < chain.size(); ++i) {
+			const MeshData& mesh = chain[i];
+			double area = 0.0;
+			size_t degenerate = 0, reversed = 0;
+			for (size_t k = 0; k < mesh.indices.size(); k += 3) {
+				const glm::vec3& a = mesh.vertices[mesh.indices[k]].position;
+				const glm::vec3 normal = glm::cross(mesh.vertices[mesh.indices[k + 1]].position - a, mesh.vertices[mesh.indices[k + 2]].position - a);
+				area += glm::length(normal) * 0.5;
+				if (glm::length(normal) * 0.5f < smallest)
+					++degenerate;
+				else if (normal.y < 0.0f)
+					++reversed;
+			}
+
+			const bool ok = degenerate == 0 && reversed == 0 && fabs(area - 1.0) < 1e-4;
+			ostringstream report;
+			report << (ok ? "INFO: " : "ERROR: ") << "lod" << i << ": " << mesh.indices.size() / 3 << " triangles, area " << fixed << setprecision(4) << area
+				<< ", " << degenerate << " degenerate, " << reversed << " reversed";
+			cout << report.str() << endl;
+			passed = passed && ok;
+		}
+		return passed;
+	}
+
+	//Simplifies a generated sphere level by level, each time from the full mesh so every figure is measured over
+	//the same input
+	bool Benchmark(size_t triangles, int levels, float ratio) {
+		//A sphere of s segments and s / 2 rings has about s * s triangles
+		PrimitiveDesc desc;
+		desc.shape = PRIMITIVE_SPHERE;
+		desc.size = glm::vec3(1.0f, 0.0f, 0.0f);
+		desc.segments = max(8, static_cast<int>(sqrt(static_cast<double>(triangles))));
+		desc.rings = desc.segments / 2;
+		const MeshData mesh = UGeneratePrimitive(desc);
+		cout << "INFO: Sphere of " << mesh.indices.size() / 3 << " triangles, " << mesh.vertices.size() << " vertices" << endl;
+
+		size_t target = mesh.indices.size() / 3;
+		for (int i = 1; i < levels; ++i) {
+			target = static_cast<size_t>(target * ratio);
+			SimplifyStats stats;
+			const auto start = chrono::steady_clock::now();
+			USimplifyMesh(mesh, target, FLT_MAX, &stats);
+			const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			ostringstream report;
+			report << "INFO: " << stats.sourceTriangles << " -> " << stats.triangles << " triangles in " << fixed << setprecision(1) << seconds * 1000.0
+				<< " ms (" << stats.passes << " passes), " << setprecision(2) << stats.sourceTriangles / seconds / 1e6 << " M input triangles/s, error "
+				<< scientific << stats.error;
+			cout << report.str() << endl;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	int levels = 5;
+	float ratio = 0.5f;
+	float relativeError = 0.0f;
+	size_t benchmarkTriangles = 0;
+	bool check = false;
+	vector<string> inputs;
+	for (int i = 1; i < argc; ++i) {
+		if (strncmp(argv[i], "--levels=", 9) == 0 && atoi(argv[i] + 9) > 1)
+			levels = atoi(argv[i] + 9);
+		else if (strncmp(argv[i], "--ratio=", 8) == 0 && atof(argv[i] + 8) > 0.0 && atof(argv[i] + 8) < 1.0)
+			ratio = static_cast<float>(atof(argv[i] + 8));
+		else if (strncmp(argv[i], "--error=", 8) == 0 && atof(argv[i] + 8) > 0.0)
+			relativeError = static_cast<float>(atof(argv[i] + 8));
+		else if (strcmp(argv[i], "--benchmark") == 0)
+			benchmarkTriangles = 1000000;
+		else if (strncmp(argv[i], "--benchmark=", 12) == 0 && atoi(argv[i] + 12) > 0)
+			benchmarkTriangles = static_cast<size_t>(atoi(argv[i] + 12));
+		else if (strcmp(argv[i], "--check") == 0)
+			check = true;
+		else if (argv[i][0] == '-') {
+			cout << "Unknown option " << argv[i] << endl;
+			cout << "Usage: " << argv[0] << " [--levels=N] [--ratio=R] [--error=E] mesh.obj ..." << endl;
+			cout << "       " << argv[0] << " --benchmark[=N] [--levels=N] [--ratio=R]" << endl;
+			cout << "       " << argv[0] << " --check [--levels=N] [--ratio=R]" << endl;
+			return EXIT_FAILURE;
+		}
+		else
+			inputs.push_back(argv[i]);
+	}
+
+	if (check)
+		return Check(levels, ratio) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (benchmarkTriangles > 0)
+		return Benchmark(benchmarkTriangles, levels, ratio) ? EXIT_SUCCESS : EXIT_FAILURE;
+	if (inputs.empty()) {
+		cout << "Usage: " << argv[0] << " [--levels=N] [--ratio=R] [--error=E] mesh.obj ..." << endl;
+		return EXIT_FAILURE;
+	}
+
+	int failed = 0;
+	for (const string& input : inputs)
+		if (!SimplifyFile(input, levels, ratio, relativeError))
+			++failed;
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
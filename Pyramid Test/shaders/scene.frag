@@ -0,0 +1,146 @@
+#version 440 core
+// Scene fragment shader template: Phong shading of the unbounded lights, then the clustered ones. The feature
+// #defines of each variant (see ShaderVariants.h) are inserted after the #version line
+in vec3 vertexNormal; // For incoming normals
+in vec3 vertexFragmentPos; // For incoming fragment position
+#if TEXTURED
+in vec2 vertexTextureCoordinate; // Already multiplied by the instance's UV scale
+#endif
+flat in uvec2 vertexTexture; // Layer in the scene's texture array or packed colour, INSTANCE_ flags
+
+out vec4 fragmentColor; // For outgoing cube color to the GPU
+
+// Camera/view position and light cluster layout come from the per-frame block
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	vec3 viewPosition;
+	ivec4 clusterGrid;
+	vec2 clusterDepth;
+	int globalLightCount;
+};
+
+// Every light in the scene, unbounded ones first (see GpuLight)
+struct Light
+{
+	vec4 positionRange; // Position (travel direction for directional lights), range (0 = unbounded)
+	vec4 colorType; // Color, type (0 point, 1 directional)
+	vec4 shading; // Ambient strength, specular strength, specular highlight size
+};
+
+layout(std430, binding = 1) readonly buffer LightBuffer
+{
+	Light lights[];
+};
+
+#if CLUSTERED_LIGHTS
+// Offset and count into lightIndices for every cluster (screen tile x depth slice)
+layout(std430, binding = 2) readonly buffer LightClusterBuffer
+{
+	uvec2 lightClusters[];
+};
+
+layout(std430, binding = 3) readonly buffer LightIndexBuffer
+{
+	uint lightIndices[];
+};
+#endif
+
+#if TEXTURED
+uniform sampler2DArray uTexture; // Every scene texture, one per layer
+#endif
+
+/*Phong lighting model calculations to generate ambient, diffuse, and specular components of one light*/
+vec3 PhongLight(Light light, vec3 norm, vec3 viewDir)
+{
+	vec3 lightColor = light.colorType.rgb;
+
+	vec3 lightDirection; // Direction from the fragment towards the light
+	float attenuation = 1.0f;
+	if (light.colorType.w == 1.0f) {
+		lightDirection = normalize(-light.positionRange.xyz);
+	}
+	else {
+		vec3 toLight = light.positionRange.xyz - vertexFragmentPos;
+		lightDirection = normalize(toLight); // Calculate distance (light direction) between light source and fragments/pixels on cube
+
+		// Bounded lights fade smoothly to zero at their range
+		if (light.positionRange.w > 0.0f) {
+			float falloff = clamp(1.0f - dot(toLight, toLight) / (light.positionRange.w * light.positionRange.w), 0.0f, 1.0f);
+			attenuation = falloff * falloff;
+		}
+	}
+
+	//Calculate Ambient lighting*/
+	vec3 ambient = light.shading.x * lightColor; // Generate ambient light color
+
+	//Calculate Diffuse lighting*/
+	float impact = max(dot(norm, lightDirection), 0.0);// Calculate diffuse impact by generating dot product of normal and light
+	vec3 diffuse = impact * lightColor; // Generate diffuse light color
+	vec3 lighting = ambient + diffuse;
+
+#if SPECULAR
+#if GENERIC
+	if ((vertexTexture.y & INSTANCE_NO_SPECULAR) == 0u) {
+#endif
+	//Calculate Specular lighting*/
+	vec3 reflectDir = reflect(-lightDirection, norm);// Calculate reflection vector
+
+	//Calculate specular component
+	float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), light.shading.z);
+	lighting += light.shading.y * specularComponent * lightColor;
+#if GENERIC
+	}
+#endif
+#endif
+
+	return lighting * attenuation;
+}
+
+// Texture colour, or the flat colour untextured instances carry
+vec3 BaseColor()
+{
+#if GENERIC
+	if ((vertexTexture.y & INSTANCE_UNTEXTURED) != 0u)
+		return unpackUnorm4x8(vertexTexture.x).rgb;
+#endif
+#if TEXTURED
+	vec2 uv = vertexTextureCoordinate;
+	if ((vertexTexture.y & INSTANCE_ROWS_TOP_DOWN) != 0u)
+		uv.y = 1.0f - uv.y;
+	return texture(uTexture, vec3(uv, float(vertexTexture.x))).xyz;
+#else
+	return unpackUnorm4x8(vertexTexture.x).rgb;
+#endif
+}
+
+void main()
+{
+	vec3 norm = normalize(vertexNormal); // Normalize vectors to 1 unit
+	vec3 viewDir = normalize(viewPosition - vertexFragmentPos); // Calculate view direction
+
+	// Unbounded lights reach every fragment; a fixed count unrolls
+	vec3 lighting = vec3(0.0f);
+#if LIGHT_COUNT < 0
+	for (int i = 0; i < globalLightCount; ++i)
+#else
+	for (int i = 0; i < LIGHT_COUNT; ++i)
+#endif
+		lighting += PhongLight(lights[i], norm, viewDir);
+
+#if CLUSTERED_LIGHTS
+	// Bounded lights only where the CPU found them touching this fragment's cluster
+	float viewDepth = -(view * vec4(vertexFragmentPos, 1.0f)).z;
+	ivec2 tile = min(ivec2(gl_FragCoord.xy) / clusterGrid.w, clusterGrid.xy - 1);
+	int slice = clamp(int(log(max(viewDepth, 0.0001f) / clusterDepth.x) * clusterDepth.y), 0, clusterGrid.z - 1);
+	uvec2 cluster = lightClusters[(slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x];
+	for (uint i = 0u; i < cluster.y; ++i)
+		lighting += PhongLight(lights[lightIndices[cluster.x + i]], norm, viewDir);
+#endif
+
+	// Calculate phong result
+	vec3 phong = lighting * BaseColor();
+
+	fragmentColor = vec4(phong, 1.0); // Send lighting results to GPU
+}
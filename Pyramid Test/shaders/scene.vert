@@ -0,0 +1,86 @@
+#version 440 core
+// Scene vertex shader template. The feature #defines of each variant (see ShaderVariants.h) are inserted after the
+// #version line. Per-instance data comes from the instance buffer through the index attribute, so plain and indirect
+// draws address it the same way
+layout(location = 0) in vec3 position; // VAP position 0 for vertex position data
+layout(location = 1) in vec4 normal; // VAP position 1 for normals
+layout(location = 2) in vec2 textureCoordinate;
+layout(location = 3) in uint instanceIndex;
+
+out vec3 vertexNormal; // For outgoing normals to fragment shader
+out vec3 vertexFragmentPos; // For outgoing color / pixels to fragment shader
+#if TEXTURED
+out vec2 vertexTextureCoordinate;
+#endif
+flat out uvec2 vertexTexture;
+
+//Per-frame values shared with the fragment shader (see FrameData)
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 view;
+	mat4 projection;
+	vec3 viewPosition;
+	ivec4 clusterGrid;
+	vec2 clusterDepth;
+	int globalLightCount;
+};
+
+//Per-instance model matrix, normal matrix, texture array layer (or flat colour) with its flags and UV scale (see InstanceData)
+struct Instance
+{
+	mat4 model;
+	vec4 normalMatrix[3];
+	uvec2 textureLayer;
+	vec2 uvScale;
+};
+
+layout(std430, binding = 4) readonly buffer InstanceBuffer
+{
+	Instance instances[];
+};
+
+#if GENERIC
+//Compact meshes store normals octahedral encoded in x and y (see CompactVertex), full meshes as xyz
+uniform bool octahedralNormals;
+#endif
+
+#if GENERIC || COMPACT_NORMALS
+vec3 OctahedralDecode(vec2 e)
+{
+	vec3 n = vec3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+#endif
+
+void main()
+{
+	Instance instance = instances[instanceIndex];
+	mat4 model = instance.model;
+
+	gl_Position = projection * view * model * vec4(position, 1.0f); // Transforms vertices into clip coordinates
+
+	vertexFragmentPos = vec3(model * vec4(position, 1.0f)); // Gets fragment / pixel position in world space only (exclude view and projection)
+
+#if GENERIC
+	vec3 objectNormal = octahedralNormals ? OctahedralDecode(normal.xy) : normal.xyz;
+#elif COMPACT_NORMALS
+	vec3 objectNormal = OctahedralDecode(normal.xy);
+#else
+	vec3 objectNormal = normal.xyz;
+#endif
+
+#if SHADER_NORMALS
+	vertexNormal = mat3(transpose(inverse(model))) * objectNormal;
+#else
+	mat3 normalMatrix = mat3(instance.normalMatrix[0].xyz, instance.normalMatrix[1].xyz, instance.normalMatrix[2].xyz);
+	vertexNormal = normalMatrix * objectNormal; // get normal vectors in world space only and exclude normal translation properties
+#endif
+
+#if TEXTURED
+	vertexTextureCoordinate = textureCoordinate * instance.uvScale;
+#endif
+	vertexTexture = instance.textureLayer;
+}
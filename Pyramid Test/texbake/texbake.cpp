@@ -0,0 +1,585 @@
+//texbake: converts the images the scenes use into mipmapped, block-compressed .btx files (see BakedTexture.h)
+//that Pyramid Test maps and uploads without decoding. Run it from the Pyramid Test directory after changing a
+//texture:
+//  texbake [--force] [--size=N] [directory or image ...]
+//With no paths it bakes every image in textures/. Each output is written next to its source and skipped while it is
+//newer than the source, unless --force is given (also needed after changing --size). --size=N resamples every image
+//to NxN first; textures of one size pack into the scene's texture array without leaving block compression (see
+//TextureArray.h).
+//  texbake --flip-benchmark [directory or image ...]
+//times the row flip methods of ImageFlip.h and stb_image's flip on load over the same images instead of baking.
+
+#include "BakedTexture.h"
+#include "ImageFlip.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+	//Decoded image as floats, one to four channels, rows in GL order (bottom-up)
+	struct Image {
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		vector<float> texels;
+
+		const float* At(int x, int y) const { return &texels[(static_cast<size_t>(y) * width + x) * channels]; }
+	};
+
+	//Halves each dimension (rounding down, never below 1) with a 2x2 box filter, matching the level sizes of glGenerateMipmap
+	Image Downsample(const Image& source) {
+		Image result;
+		result.width = max(1, source.width / 2);
+		result.height = max(1, source.height / 2);
+		result.channels = source.channels;
+		result.texels.resize(static_cast<size_t>(result.width) * result.height * result.channels);
+
+		for (int y = 0; y < result.height; ++y) {
+			const int y0 = min(2 * y, source.height - 1);
+			const int y1 = min(2 * y + 1, source.height - 1);
+			for (int x = 0; x < result.width; ++x) {
+				const int x0 = min(2 * x, source.width - 1);
+				const int x1 = min(2 * x + 1, source.width - 1);
+				float* out = &result.texels[(static_cast<size_t>(y) * result.width + x) * result.channels];
+				for (int c = 0; c < result.channels; ++c)
+					out[c] = 0.25f * (source.At(x0, y0)[c] + source.At(x1, y0)[c] + source.At(x0, y1)[c] + source.At(x1, y1)[c]);
+			}
+		}
+		return result;
+	}
+
+	//Bilinear sample with repeat wrapping, the way the texture is sampled at run time; x and y in texels
+	void SampleBilinear(const Image& image, float x, float y, float* out) {
+		const float fx = x - 0.5f, fy = y - 0.5f;
+		const int x0 = static_cast<int>(floor(fx)), y0 = static_cast<int>(floor(fy));
+		const float tx = fx - x0, ty = fy - y0;
+		auto wrap = [](int v, int size) { return ((v % size) + size) % size; };
+		const float* a = image.At(wrap(x0, image.width), wrap(y0, image.height));
+		const float* b = image.At(wrap(x0 + 1, image.width), wrap(y0, image.height));
+		const float* c = image.At(wrap(x0, image.width), wrap(y0 + 1, image.height));
+		const float* d = image.At(wrap(x0 + 1, image.width), wrap(y0 + 1, image.height));
+		for (int i = 0; i < image.channels; ++i)
+			out[i] = (a[i] * (1.0f - tx) + b[i] * tx) * (1.0f - ty) + (c[i] * (1.0f - tx) + d[i] * tx) * ty;
+	}
+
+	//Resamples to width x height: halving with the box filter while the image is more than twice too large, then
+	//bilinear for the rest
+	Image Resize(Image image, int width, int height) {
+		while (image.width >= 2 * width && image.height >= 2 * height)
+			image = Downsample(image);
+		if (image.width == width && image.height == height)
+			return image;
+
+		Image result;
+		result.width = width;
+		result.height = height;
+		result.channels = image.channels;
+		result.texels.resize(static_cast<size_t>(width) * height * image.channels);
+		const float scaleX = static_cast<float>(image.width) / width;
+		const float scaleY = static_cast<float>(image.height) / height;
+		for (int y = 0; y < height; ++y)
+			for (int x = 0; x < width; ++x)
+				SampleBilinear(image, (x + 0.5f) * scaleX, (y + 0.5f) * scaleY, &result.texels[(static_cast<size_t>(y) * width + x) * image.channels]);
+		return result;
+	}
+
+	uint16_t PackRgb565(const float color[3]) {
+		const int r = static_cast<int>(std::round(min(max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f));
+		const int g = static_cast<int>(std::round(min(max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f));
+		const int b = static_cast<int>(std::round(min(max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f));
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRgb565(uint16_t packed, float color[3]) {
+		const int r = (packed >> 11) & 31;
+		const int g = (packed >> 5) & 63;
+		const int b = packed & 31;
+		color[0] = static_cast<float>((r << 3) | (r >> 2));
+		color[1] = static_cast<float>((g << 2) | (g >> 4));
+		color[2] = static_cast<float>((b << 3) | (b >> 2));
+	}
+
+	float DistanceSquared(const float a[3], const float b[3]) {
+		const float dr = a[0] - b[0], dg = a[1] - b[1], db = a[2] - b[2];
+		return dr * dr + dg * dg + db * db;
+	}
+
+	//Picks the nearest of the four palette entries for every texel and returns the summed squared error
+	float AssignColorIndices(const float block[16][3], uint16_t color0, uint16_t color1, uint8_t indices[16]) {
+		float palette[4][3];
+		UnpackRgb565(color0, palette[0]);
+		UnpackRgb565(color1, palette[1]);
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+
+		float error = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			int best = 0;
+			float bestDistance = DistanceSquared(block[i], palette[0]);
+			for (int p = 1; p < 4; ++p) {
+				const float distance = DistanceSquared(block[i], palette[p]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices[i] = static_cast<uint8_t>(best);
+			error += bestDistance;
+		}
+		return error;
+	}
+
+	//Least squares endpoints for fixed indices: each texel is a*e0 + b*e1 with weights 1, 0, 2/3, 1/3
+	bool RefitEndpoints(const float block[16][3], const uint8_t indices[16], float endpoint0[3], float endpoint1[3]) {
+		static const float WEIGHT[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[3] = {}, bx[3] = {};
+		for (int i = 0; i < 16; ++i) {
+			const float a = WEIGHT[indices[i]];
+			const float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < 3; ++c) {
+				ax[c] += a * block[i][c];
+				bx[c] += b * block[i][c];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (fabs(determinant) < 1e-6f)
+			return false;
+		for (int c = 0; c < 3; ++c) {
+			endpoint0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+			endpoint1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+		}
+		return true;
+	}
+
+	//Four-colour BC1 block: endpoints from the principal axis of the block's colours, indices by nearest palette
+	//entry, then one least squares refit of the endpoints kept if it lowers the error
+	void EncodeColorBlock(const float block[16][3], unsigned char* out) {
+		float mean[3] = {};
+		for (int i = 0; i < 16; ++i)
+			for (int c = 0; c < 3; ++c)
+				mean[c] += block[i][c] / 16.0f;
+
+		float covariance[6] = {};
+		for (int i = 0; i < 16; ++i) {
+			const float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+			covariance[0] += r * r;
+			covariance[1] += r * g;
+			covariance[2] += r * b;
+			covariance[3] += g * g;
+			covariance[4] += g * b;
+			covariance[5] += b * b;
+		}
+
+		//Power iteration converges on the dominant eigenvector in a few steps for 3x3
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; ++iteration) {
+			const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+			const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+			const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+			const float length = sqrt(x * x + y * y + z * z);
+			if (length < 1e-6f)
+				break;
+			axis[0] = x / length;
+			axis[1] = y / length;
+			axis[2] = z / length;
+		}
+
+		float minProjection = 1e30f, maxProjection = -1e30f;
+		for (int i = 0; i < 16; ++i) {
+			const float projection = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+			minProjection = min(minProjection, projection);
+			maxProjection = max(maxProjection, projection);
+		}
+
+		float endpoint0[3], endpoint1[3];
+		for (int c = 0; c < 3; ++c) {
+			endpoint0[c] = mean[c] + axis[c] * maxProjection;
+			endpoint1[c] = mean[c] + axis[c] * minProjection;
+		}
+
+		uint16_t color0 = PackRgb565(endpoint0);
+		uint16_t color1 = PackRgb565(endpoint1);
+		uint8_t indices[16];
+		float error = AssignColorIndices(block, color0, color1, indices);
+
+		float refit0[3], refit1[3];
+		if (color0 != color1 && RefitEndpoints(block, indices, refit0, refit1)) {
+			const uint16_t refitColor0 = PackRgb565(refit0);
+			const uint16_t refitColor1 = PackRgb565(refit1);
+			uint8_t refitIndices[16];
+			const float refitError = AssignColorIndices(block, refitColor0, refitColor1, refitIndices);
+			if (refitError < error) {
+				color0 = refitColor0;
+				color1 = refitColor1;
+				memcpy(indices, refitIndices, sizeof(indices));
+			}
+		}
+
+		//color0 > color1 selects four-colour mode; swapping the endpoints swaps indices 0<->1 and 2<->3
+		if (color0 < color1) {
+			swap(color0, color1);
+			for (int i = 0; i < 16; ++i)
+				indices[i] ^= 1;
+		}
+		else if (color0 == color1) {
+			memset(indices, 0, sizeof(indices));
+		}
+
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+			bits |= static_cast<uint32_t>(indices[i]) << (2 * i);
+		out[0] = static_cast<unsigned char>(color0 & 0xFF);
+		out[1] = static_cast<unsigned char>(color0 >> 8);
+		out[2] = static_cast<unsigned char>(color1 & 0xFF);
+		out[3] = static_cast<unsigned char>(color1 >> 8);
+		for (int i = 0; i < 4; ++i)
+			out[4 + i] = static_cast<unsigned char>(bits >> (8 * i));
+	}
+
+	//BC3 alpha block in eight-value mode, endpoints at the block's alpha range
+	void EncodeAlphaBlock(const float alpha[16], unsigned char* out) {
+		float low = 255.0f, high = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			low = min(low, alpha[i]);
+			high = max(high, alpha[i]);
+		}
+		const int alpha0 = static_cast<int>(std::round(min(max(high, 0.0f), 255.0f)));
+		const int alpha1 = static_cast<int>(std::round(min(max(low, 0.0f), 255.0f)));
+
+		//Palette order of eight-value mode: alpha0, alpha1, then six steps from alpha0 towards alpha1
+		float palette[8] = { static_cast<float>(alpha0), static_cast<float>(alpha1) };
+		for (int step = 1; step < 7; ++step)
+			palette[step + 1] = ((7 - step) * alpha0 + step * alpha1) / 7.0f;
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 16 && alpha0 != alpha1; ++i) {
+			int best = 0;
+			for (int p = 1; p < 8; ++p)
+				if (fabs(alpha[i] - palette[p]) < fabs(alpha[i] - palette[best]))
+					best = p;
+			bits |= static_cast<uint64_t>(best) << (3 * i);
+		}
+
+		out[0] = static_cast<unsigned char>(alpha0);
+		out[1] = static_cast<unsigned char>(alpha1);
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+	}
+
+	//Compresses one level; blocks that hang over the right or top edge repeat the last column or row
+	vector<unsigned char> CompressLevel(const Image& image, BakedFormat format) {
+		const int blocksWide = (image.width + 3) / 4;
+		const int blocksHigh = (image.height + 3) / 4;
+		const size_t blockBytes = UBakedBlockBytes(format);
+		vector<unsigned char> result(static_cast<size_t>(blocksWide) * blocksHigh * blockBytes);
+
+		for (int by = 0; by < blocksHigh; ++by) {
+			for (int bx = 0; bx < blocksWide; ++bx) {
+				float colors[16][3];
+				float alpha[16];
+				for (int i = 0; i < 16; ++i) {
+					const int x = min(bx * 4 + i % 4, image.width - 1);
+					const int y = min(by * 4 + i / 4, image.height - 1);
+					const float* texel = image.At(x, y);
+					for (int c = 0; c < 3; ++c)
+						colors[i][c] = texel[image.channels >= 3 ? c : 0];
+					alpha[i] = image.channels == 4 || image.channels == 2 ? texel[image.channels - 1] : 255.0f;
+				}
+
+				unsigned char* out = &result[(static_cast<size_t>(by) * blocksWide + bx) * blockBytes];
+				if (format == BAKED_FORMAT_BC3) {
+					EncodeAlphaBlock(alpha, out);
+					out += 8;
+				}
+				EncodeColorBlock(colors, out);
+			}
+		}
+		return result;
+	}
+
+	bool IsImage(const fs::path& path) {
+		string extension = path.extension().string();
+		transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+		return extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".tga" || extension == ".bmp";
+	}
+
+	bool UpToDate(const string& source, const string& baked) {
+		error_code error;
+		const auto bakedTime = fs::last_write_time(baked, error);
+		if (error)
+			return false;
+		return bakedTime >= fs::last_write_time(source, error) && !error;
+	}
+
+	//Decodes, flips, builds the mip chain and writes the .btx file
+	bool BakeTexture(const string& sourcePath, const string& bakedPath, int size) {
+		const auto start = chrono::steady_clock::now();
+
+		int width = 0, height = 0, channels = 0;
+		unsigned char* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, 0);
+		if (!pixels) {
+			cout << "Failed to load texture " << sourcePath << endl;
+			return false;
+		}
+
+		//Row 0 of the file is the top of the image; GL expects the bottom first, so the flip happens here once
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.channels = channels;
+		image.texels.resize(static_cast<size_t>(width) * height * channels);
+		const size_t rowLength = static_cast<size_t>(width) * channels;
+		for (int y = 0; y < height; ++y) {
+			const unsigned char* row = pixels + (height - 1 - y) * rowLength;
+			for (size_t i = 0; i < rowLength; ++i)
+				image.texels[y * rowLength + i] = row[i];
+		}
+		stbi_image_free(pixels);
+
+		if (size > 0) {
+			image = Resize(image, size, size);
+			width = size;
+			height = size;
+		}
+
+		const BakedFormat format = channels == 2 || channels == 4 ? BAKED_FORMAT_BC3 : BAKED_FORMAT_BC1;
+
+		vector<vector<unsigned char>> levels;
+		while (true) {
+			levels.push_back(CompressLevel(image, format));
+			if ((image.width == 1 && image.height == 1) || levels.size() == BAKED_TEXTURE_MAX_LEVELS)
+				break;
+			image = Downsample(image);
+		}
+
+		BakedTextureHeader header;
+		header.format = format;
+		header.width = static_cast<uint32_t>(width);
+		header.height = static_cast<uint32_t>(height);
+		header.levelCount = static_cast<uint32_t>(levels.size());
+		header.sourceChannels = static_cast<uint32_t>(channels);
+
+		vector<BakedTextureLevel> table(levels.size());
+		uint64_t offset = sizeof(BakedTextureHeader) + table.size() * sizeof(BakedTextureLevel);
+		uint32_t levelWidth = header.width, levelHeight = header.height;
+		for (size_t i = 0; i < levels.size(); ++i) {
+			offset = (offset + 15) & ~static_cast<uint64_t>(15);
+			table[i].width = levelWidth;
+			table[i].height = levelHeight;
+			table[i].offset = offset;
+			table[i].size = levels[i].size();
+			offset += levels[i].size();
+			levelWidth = max(1u, levelWidth / 2);
+			levelHeight = max(1u, levelHeight / 2);
+		}
+
+		ofstream out(bakedPath, ios::binary | ios::trunc);
+		if (!out) {
+			cout << "Could not write " << bakedPath << endl;
+			return false;
+		}
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(BakedTextureLevel));
+		const char padding[16] = {};
+		for (size_t i = 0; i < levels.size(); ++i) {
+			out.write(padding, static_cast<streamsize>(table[i].offset - static_cast<uint64_t>(out.tellp())));
+			out.write(reinterpret_cast<const char*>(levels[i].data()), levels[i].size());
+		}
+		out.close();
+		if (!out) {
+			cout << "Could not write " << bakedPath << endl;
+			return false;
+		}
+
+		//What the same texture costs uncompressed: RGBA8 texels (drivers pad RGB8) plus a third for the mip chain
+		const double rawMegabytes = width * static_cast<double>(height) * 4.0 * 4.0 / 3.0 / (1024.0 * 1024.0);
+		ostringstream report;
+		report << "INFO: Baked " << sourcePath << " -> " << bakedPath << ": " << width << "x" << height << "x" << channels << ", "
+			<< (format == BAKED_FORMAT_BC3 ? "BC3" : "BC1") << ", " << levels.size() << " levels, " << fixed << setprecision(2)
+			<< offset / (1024.0 * 1024.0) << " MB (" << rawMegabytes << " MB uncompressed) in "
+			<< chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms";
+		cout << report.str() << endl;
+		return true;
+	}
+
+	double MillisecondsSince(chrono::steady_clock::time_point start) {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+
+	double Median(vector<double> values) {
+		sort(values.begin(), values.end());
+		return values[values.size() / 2];
+	}
+
+	//Extra decode time when stb_image flips while writing the rows: median over runs that alternate with and
+	//without the flag, so both see the same cache and clock state
+	double TimeStbFlip(const string& path) {
+		vector<double> differences;
+		for (int run = 0; run < 5; ++run) {
+			double ms[2];
+			for (int flipOnLoad = 0; flipOnLoad < 2; ++flipOnLoad) {
+				stbi_set_flip_vertically_on_load(flipOnLoad);
+				const auto start = chrono::steady_clock::now();
+				int width = 0, height = 0, channels = 0;
+				unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+				ms[flipOnLoad] = MillisecondsSince(start);
+				stbi_image_free(pixels);
+			}
+			differences.push_back(ms[1] - ms[0]);
+		}
+		stbi_set_flip_vertically_on_load(0);
+		return Median(differences);
+	}
+
+	//Times each flip method on every image and checks they all agree with the scalar loop. Flips run in pairs, so
+	//the image is back to its decoded state between methods
+	bool BenchmarkFlips(const vector<string>& sources) {
+		const FlipMethod METHODS[] = { FLIP_SCALAR, FLIP_MEMCPY, FLIP_SIMD };
+		const int METHOD_COUNT = 3;
+		const int FLIP_PAIRS = 5;
+
+		vector<unsigned char> scratch;
+		double totalMs[METHOD_COUNT] = {};
+		double totalStbMs = 0.0;
+		double totalMegabytes = 0.0;
+		bool success = true;
+		for (const string& source : sources) {
+			int width = 0, height = 0, channels = 0;
+			unsigned char* pixels = stbi_load(source.c_str(), &width, &height, &channels, 0);
+			if (!pixels) {
+				cout << "Failed to load texture " << source << endl;
+				success = false;
+				continue;
+			}
+			const size_t bytes = static_cast<size_t>(width) * height * channels;
+			const double megabytes = bytes / (1024.0 * 1024.0);
+
+			vector<unsigned char> expected(pixels, pixels + bytes);
+			UFlipImageRows(expected.data(), width, height, channels, FLIP_SCALAR, scratch);
+
+			ostringstream report;
+			report << "INFO: Flip " << source << " " << width << "x" << height << "x" << channels << fixed << setprecision(2) << " (" << megabytes << " MB):";
+			for (int m = 0; m < METHOD_COUNT; ++m) {
+				vector<double> times;
+				for (int pair = 0; pair < FLIP_PAIRS; ++pair) {
+					for (int flip = 0; flip < 2; ++flip) {
+						const auto start = chrono::steady_clock::now();
+						UFlipImageRows(pixels, width, height, channels, METHODS[m], scratch);
+						times.push_back(MillisecondsSince(start));
+						if (flip == 0 && memcmp(pixels, expected.data(), bytes) != 0) {
+							cout << "ERROR: " << UFlipMethodName(METHODS[m]) << " flip of " << source << " differs from the scalar loop" << endl;
+							success = false;
+						}
+					}
+				}
+				const double ms = Median(times);
+				totalMs[m] += ms;
+				report << " " << UFlipMethodName(METHODS[m]) << " " << ms << " ms (" << megabytes / 1024.0 / (ms / 1000.0) << " GB/s),";
+			}
+			stbi_image_free(pixels);
+
+			//What flipping costs when stb_image does it while writing the decoded rows
+			const double stbMs = TimeStbFlip(source);
+			totalStbMs += stbMs;
+			totalMegabytes += megabytes;
+			report << " stb flip on load " << showpos << stbMs << noshowpos << " ms";
+			cout << report.str() << endl;
+		}
+
+		ostringstream summary;
+		summary << "INFO: Flip total over " << sources.size() << " images (" << fixed << setprecision(2) << totalMegabytes << " MB):";
+		for (int m = 0; m < METHOD_COUNT; ++m)
+			summary << " " << UFlipMethodName(METHODS[m]) << " " << totalMs[m] << " ms (" << totalMs[FLIP_SCALAR] / max(totalMs[m], 1e-9) << "x),";
+		summary << " stb flip on load " << showpos << totalStbMs << noshowpos << " ms";
+		cout << summary.str() << endl;
+		return success;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	bool force = false;
+	int size = 0;
+	bool flipBenchmark = false;
+	vector<string> inputs;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--force") == 0)
+			force = true;
+		else if (strncmp(argv[i], "--size=", 7) == 0 && atoi(argv[i] + 7) > 0)
+			size = atoi(argv[i] + 7);
+		else if (strcmp(argv[i], "--flip-benchmark") == 0)
+			flipBenchmark = true;
+		else if (argv[i][0] == '-') {
+			cout << "Unknown option " << argv[i] << endl;
+			cout << "Usage: " << argv[0] << " [--force] [--size=N] [directory or image ...]" << endl;
+			cout << "       " << argv[0] << " --flip-benchmark [directory or image ...]" << endl;
+			return EXIT_FAILURE;
+		}
+		else
+			inputs.push_back(argv[i]);
+	}
+	if (inputs.empty())
+		inputs.push_back("textures");
+
+	//Directories contribute every image directly inside them, in name order
+	vector<string> sources;
+	for (const string& input : inputs) {
+		error_code error;
+		if (fs::is_directory(input, error)) {
+			vector<string> found;
+			for (const fs::directory_entry& entry : fs::directory_iterator(input, error))
+				if (entry.is_regular_file() && IsImage(entry.path()))
+					found.push_back(entry.path().generic_string());
+			sort(found.begin(), found.end());
+			sources.insert(sources.end(), found.begin(), found.end());
+		}
+		else if (fs::is_regular_file(input, error)) {
+			sources.push_back(input);
+		}
+		else {
+			cout << "No such file or directory " << input << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (flipBenchmark)
+		return BenchmarkFlips(sources) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	int baked = 0, skipped = 0, failed = 0;
+	for (const string& source : sources) {
+		const string bakedPath = UBakedTexturePath(source);
+		if (!force && UpToDate(source, bakedPath)) {
+			cout << "INFO: " << bakedPath << " is up to date" << endl;
+			++skipped;
+		}
+		else if (BakeTexture(source, bakedPath, size))
+			++baked;
+		else
+			++failed;
+	}
+
+	cout << "INFO: " << baked << " baked, " << skipped << " up to date, " << failed << " failed" << endl;
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}